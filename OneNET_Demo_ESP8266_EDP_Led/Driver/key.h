@@ -2,6 +2,9 @@
 #define   KEY_H_H
 
 extern  void mDelay(uint32_t i);
+extern  void SystickTime_Init(void);
+extern  void SystickTime_Increase(void);
+extern  uint32_t SystickTime_Get(void);   //上电以来的毫秒数
 extern  void KEY_Init(void);
 
 
@@ -109,6 +109,17 @@ typedef struct Buffer
  *          ֵΪ Bufferʧ, ڴ治
  */
 EDPKIT_DLL Buffer* NewBuffer();
+/* 
+ * :  NewBufferSize
+ * :    ɳʼΪsizeֽڵBuffer
+ * ˵:    ֪ܳʱһ뵽λ, BUFFER_SIZEʼ
+ *          ɱݺͿ; ͬҪDeleteBuffer
+ * :    size    Bufferĳʼ
+ * ֵ:   (Buffer*)
+ *          ֵǿ Bufferɹ, Bufferָ
+ *          ֵΪ Bufferʧ, ڴ治
+ */
+EDPKIT_DLL Buffer* NewBufferSize(uint32 size);
 /* 
  * :  DeleteBuffer
  * :    Buffer
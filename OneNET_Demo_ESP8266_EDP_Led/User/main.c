@@ -32,6 +32,7 @@
 int main(void)
 {	
 		//SystemInit();
+		SystickTime_Init(); //1ms节拍, mDelay按它计时
 		LED_Init();    //LED指示灯初始化函数
 		KEY_Init();	   //按键初始化函数
 		USART1_Init(); //USART1串口初始化函数
@@ -140,8 +140,7 @@ void PendSV_Handler(void)
   */
 void SysTick_Handler(void)
 {
-    //SystickTime_Increase();
-    //SystickTime++;
+    SystickTime_Increase();
 }
 
 /******************************************************************************/
@@ -3,16 +3,30 @@
 
 #include <stm32f10x.h>
 #include <stdint.h>
-#define MAX_RCV_LEN  1024
+#include "ring.h"
+#define MAX_RCV_LEN  1024           //查找AT应答时最多看的字节数
+#define USART2_RCV_RING_LEN  1024   //接收环形缓冲区, 必须是2的幂
+
+#define USART2_BAUD_DEFAULT  115200 //模组上电后的波特率
+//与模组协商时依次尝试的波特率, APB1为36MHz, 这几个都能精确分频
+#define USART2_BAUD_LIST     {921600, 460800, 230400}
+//1: 启用RTS/CTS硬件流控, PA1(RTS)接模组GPIO13(CTS), PA0(CTS)接模组GPIO15(RTS)
+#ifndef USART2_FLOW_CTRL
+#define USART2_FLOW_CTRL     0
+#endif
 
 extern void USART2_Config(void);
-extern void USART2_Write(USART_TypeDef* USARTx, uint8_t *Data,uint8_t len);
+extern void USART2_SetBaud(uint32_t baud, uint8_t flow);
+extern void USART2_Write(USART_TypeDef* USARTx, uint8_t *Data,uint32_t len);
 extern void USART2_Clear(void);
 extern volatile unsigned char  gprs_ready_flag;
 extern volatile unsigned char  gprs_ready_count;
 
-extern unsigned char  usart2_rcv_buf[MAX_RCV_LEN];
-extern volatile unsigned int   usart2_rcv_len;
+//接收数据: 中断写入, 主循环读取. usart2_rcv_ring.overflow为缓冲区满被丢掉的字节数
+extern Ring usart2_rcv_ring;
+extern char *USART2_RcvFind(const char *str);
+extern uint32_t USART2_GetRcvNum(void);
+extern void USART2_GetRcvData(uint8_t *buf, uint32_t rcv_len);
 void SendCmd(char* cmd, char* result, int timeOut);
 #endif
 
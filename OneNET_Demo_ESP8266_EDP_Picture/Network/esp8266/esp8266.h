@@ -1,3 +1,5 @@
+#include <stdint.h>
+
 #define AT          "AT\r\n"	
 #define CWMODE      "AT+CWMODE=3\r\n"		//STA+AP模式
 #define RST         "AT+RST\r\n"
@@ -8,6 +10,11 @@
 #define CIPMODE1    "AT+CIPMODE=1\r\n"		//透传模式
 #define CIPSEND     "AT+CIPSEND\r\n"
 #define CIPSTATUS   "AT+CIPSTATUS\r\n"		//网络状态查询
+//回显测试: 模组(ATE1)原样回显后报ERROR, 内容覆盖0x55/0x2A这类交替位型和全部字母数字
+#define ECHO_PATTERN "UUUU****0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz"
+#define ECHO_TEST   "AT+ECHO=" ECHO_PATTERN "\r\n"
+#define ECHO_ROUNDS 3
 
 
-void ESP8266_Init(void);
\ No newline at end of file
+void ESP8266_Init(void);
+uint32_t ESP8266_SetBaud(void);
\ No newline at end of file
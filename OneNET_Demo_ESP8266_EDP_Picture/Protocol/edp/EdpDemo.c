@@ -155,6 +155,10 @@ void Recv_Thread_Func(void)
         }
         printf("rcv_len: %d\r\n", rcv_len);
         mDelay(100);
+        if (rcv_len > sizeof(buffer))
+        {
+            rcv_len = sizeof(buffer);   //其余的留在接收缓冲区, 下一轮再取
+        }
         USART2_GetRcvData(buffer, rcv_len);
         hexdump(buffer, rcv_len);   //打印接收数据
 
@@ -286,13 +286,17 @@ static void FormatAt(char* buffer, int len, time_t now)
 
 /*---------------------------------------------------------------------------*/
 Buffer* NewBuffer()
+{
+    return NewBufferSize(BUFFER_SIZE);
+}
+Buffer* NewBufferSize(uint32_t size)
 {
     Buffer* buf = (Buffer*)malloc(sizeof(Buffer));
     if(buf == NULL)
     {
         return NULL;
     }
-    buf->_data = (uint8_t*)malloc(sizeof(uint8_t) * BUFFER_SIZE);
+    buf->_data = (uint8_t*)malloc(sizeof(uint8_t) * size);
     if(buf->_data == NULL)
     {
         printf("%s %d NewBuffer failed\n", __func__, __LINE__);
@@ -302,7 +306,7 @@ Buffer* NewBuffer()
     }
     buf->_write_pos = 0;
     buf->_read_pos = 0;
-    buf->_capacity = BUFFER_SIZE;
+    buf->_capacity = size;
     return buf;
 }
 void DeleteBuffer(Buffer** buf)
@@ -444,16 +448,22 @@ int32_t WriteBytes(Buffer* buf, const void* bytes, uint32_t count)
 int32_t WriteUint16(Buffer* buf, uint16_t val)
 {
     my_assert(buf->_read_pos == 0);
-    return WriteByte(buf, MOSQ_MSB(val))
-           || WriteByte(buf, MOSQ_LSB(val));
+    if (CheckCapacity(buf, 2))
+        return -1;
+    buf->_data[buf->_write_pos++] = MOSQ_MSB(val);
+    buf->_data[buf->_write_pos++] = MOSQ_LSB(val);
+    return 0;
 }
 int32_t WriteUint32(Buffer* buf, uint32_t val)
 {
     my_assert(buf->_read_pos == 0);
-    return WriteByte(buf, (val >> 24) & 0x00FF)
-           || WriteByte(buf, (val >> 16) & 0x00FF)
-           || WriteByte(buf, (val >> 8) & 0x00FF)
-           || WriteByte(buf, (val) & 0x00FF);
+    if (CheckCapacity(buf, 4))
+        return -1;
+    buf->_data[buf->_write_pos++] = (val >> 24) & 0x00FF;
+    buf->_data[buf->_write_pos++] = (val >> 16) & 0x00FF;
+    buf->_data[buf->_write_pos++] = (val >> 8) & 0x00FF;
+    buf->_data[buf->_write_pos++] = (val) & 0x00FF;
+    return 0;
 }
 int32_t WriteStr(Buffer* buf, const char *str)
 {
@@ -488,33 +498,89 @@ int32_t WriteRemainlen(Buffer* buf, uint32_t len_val)
     return 0;
 }
 /*---------------------------------------------------------------------------*/
+/*
+ * 以下Put*系列只供本文件的打包函数使用:
+ * 包由NewPacket按最终长度一次申请好, 字段写入时不再做容量检查
+ */
+/* remainlen编码后占用的字节数 */
+static uint32_t RemainlenSize(uint32_t len_val)
+{
+    uint32_t len_len = 1;
+
+    while (len_val > 127)
+    {
+        len_val = len_val / 128;
+        len_len++;
+    }
+    return len_len;
+}
+/* 申请恰好 1 + len(remainlen) + remainlen 字节的包, 并写入消息类型和剩余长度 */
+static EdpPacket* NewPacket(uint8_t msg_type, uint32_t remainlen)
+{
+    EdpPacket* pkg = NULL;
+
+    pkg = NewBufferSize(1 + RemainlenSize(remainlen) + remainlen);
+    if (pkg == NULL)
+        return NULL;
+    pkg->_data[pkg->_write_pos++] = msg_type;
+    WriteRemainlen(pkg, remainlen);
+    return pkg;
+}
+static void PutByte(EdpPacket* pkg, uint8_t byte)
+{
+    pkg->_data[pkg->_write_pos++] = byte;
+}
+static void PutUint16(EdpPacket* pkg, uint16_t val)
+{
+    pkg->_data[pkg->_write_pos++] = MOSQ_MSB(val);
+    pkg->_data[pkg->_write_pos++] = MOSQ_LSB(val);
+}
+static void PutUint32(EdpPacket* pkg, uint32_t val)
+{
+    pkg->_data[pkg->_write_pos++] = (val >> 24) & 0x00FF;
+    pkg->_data[pkg->_write_pos++] = (val >> 16) & 0x00FF;
+    pkg->_data[pkg->_write_pos++] = (val >> 8) & 0x00FF;
+    pkg->_data[pkg->_write_pos++] = (val) & 0x00FF;
+}
+static void PutBytes(EdpPacket* pkg, const void* bytes, uint32_t count)
+{
+    memcpy(pkg->_data + pkg->_write_pos, bytes, count);
+    pkg->_write_pos += count;
+}
+/* str_len由调用者在计算remainlen时已经求出, 这里不再重复strlen */
+static void PutStr(EdpPacket* pkg, const char* str, uint16_t str_len)
+{
+    PutUint16(pkg, str_len);
+    PutBytes(pkg, str, str_len);
+}
+/*---------------------------------------------------------------------------*/
 /* connect1 (C->S): devid + apikey */
 EdpPacket* PacketConnect1(const char* devid, const char* auth_key)
 {
     uint32_t remainlen;
-    EdpPacket* pkg = NewBuffer();
+    uint16_t devid_len = strlen(devid);
+    uint16_t key_len = strlen(auth_key);
+    EdpPacket* pkg = NULL;
+
+    /* msg type + remain len */
+    remainlen = (2 + 3) + 1 + 1 + 2 + (2 + devid_len) + (2 + key_len);
+    pkg = NewPacket(CONNREQ, remainlen);
     if(pkg == NULL)
     {
         return NULL;
     }
-
-    /* msg type */
-    WriteByte(pkg, CONNREQ);
-    /* remain len */
-    remainlen = (2 + 3) + 1 + 1 + 2 + (2 + strlen(devid)) + (2 + strlen(auth_key));
-    WriteRemainlen(pkg, remainlen);
     /* protocol desc */
-    WriteStr(pkg, PROTOCOL_NAME);
+    PutStr(pkg, PROTOCOL_NAME, 3);
     /* protocol version */
-    WriteByte(pkg, PROTOCOL_VERSION);
+    PutByte(pkg, PROTOCOL_VERSION);
     /* connect flag */
-    WriteByte(pkg, 0x40);
+    PutByte(pkg, 0x40);
     /* keep time */
-    WriteUint16(pkg, 0x0080);
+    PutUint16(pkg, 0x0080);
     /* DEVID */
-    WriteStr(pkg, devid);
+    PutStr(pkg, devid, devid_len);
     /* auth key */
-    WriteStr(pkg, auth_key);
+    PutStr(pkg, auth_key, key_len);
     return pkg;
 }
 /* connect2 (C->S): userid + auth_info */
@@ -522,28 +588,29 @@ EdpPacket* PacketConnect2(const char* userid, const char* auth_info)
 {
     EdpPacket* pkg = NULL;
     uint32_t remainlen;
+    uint16_t userid_len = strlen(userid);
+    uint16_t info_len = strlen(auth_info);
 
-    pkg = NewBuffer();
-    /* msg type */
-    WriteByte(pkg, CONNREQ);
-    /* remain len */
-    remainlen = (2 + 3) + 1 + 1 + 2 + 2 + (2 + strlen(userid)) + (2 + strlen(auth_info));
-    WriteRemainlen(pkg, remainlen);
+    /* msg type + remain len */
+    remainlen = (2 + 3) + 1 + 1 + 2 + 2 + (2 + userid_len) + (2 + info_len);
+    pkg = NewPacket(CONNREQ, remainlen);
+    if (pkg == NULL)
+        return NULL;
     /* protocol desc */
-    WriteStr(pkg, PROTOCOL_NAME);
+    PutStr(pkg, PROTOCOL_NAME, 3);
     /* protocol version */
-    WriteByte(pkg, PROTOCOL_VERSION);
+    PutByte(pkg, PROTOCOL_VERSION);
     /* connect flag */
-    WriteByte(pkg, 0xC0);
+    PutByte(pkg, 0xC0);
     /* keep time */
-    WriteUint16(pkg, 0x0080);
+    PutUint16(pkg, 0x0080);
     /* devid */
-    WriteByte(pkg, 0x00);
-    WriteByte(pkg, 0x00);
+    PutByte(pkg, 0x00);
+    PutByte(pkg, 0x00);
     /* USERID */
-    WriteStr(pkg, userid);
+    PutStr(pkg, userid, userid_len);
     /* auth info */
-    WriteStr(pkg, auth_info);
+    PutStr(pkg, auth_info, info_len);
     return pkg;
 }
 /* push_data (C->S) */
@@ -551,17 +618,17 @@ EdpPacket* PacketPushdata(const char* dst_devid, const char* data, uint32_t data
 {
     EdpPacket* pkg = NULL;
     uint32_t remainlen;
+    uint16_t devid_len = strlen(dst_devid);
 
-    pkg = NewBuffer();
-    /* msg type */
-    WriteByte(pkg, PUSHDATA);
-    /* remain len */
-    remainlen = (2 + strlen(dst_devid)) + data_len;
-    WriteRemainlen(pkg, remainlen);
+    /* msg type + remain len */
+    remainlen = (2 + devid_len) + data_len;
+    pkg = NewPacket(PUSHDATA, remainlen);
+    if (pkg == NULL)
+        return NULL;
     /* dst devid */
-    WriteStr(pkg, dst_devid);
+    PutStr(pkg, dst_devid, devid_len);
     /* data */
-    WriteBytes(pkg, data, data_len);
+    PutBytes(pkg, data, data_len);
     return pkg;
 }
 /* sava_data (C->S) */
@@ -571,35 +638,42 @@ EdpPacket* PacketSavedataJson(const char* dst_devid, cJSON* json_obj, int type)
     uint32_t remainlen = 0;
     char* json_out = NULL;
     uint32_t json_len = 0;
+    uint16_t devid_len = 0;
 
-    pkg = NewBuffer();
     json_out = cJSON_Print(json_obj);
+    if (json_out == NULL)
+        return NULL;
     json_len = strlen(json_out);
 
-    /* msg type */
-    WriteByte(pkg, SAVEDATA);
+    /* msg type + remain len */
+    remainlen = 1 + 1 + (2 + json_len);
+    if (dst_devid)
+    {
+        devid_len = strlen(dst_devid);
+        remainlen += 2 + devid_len;
+    }
+    pkg = NewPacket(SAVEDATA, remainlen);
+    if (pkg == NULL)
+    {
+        free(json_out);
+        return NULL;
+    }
     if (dst_devid)
     {
-        /* remain len */
-        remainlen = 1 + (2 + strlen(dst_devid)) + 1 + (2 + json_len);
-        WriteRemainlen(pkg, remainlen);
         /* translate address flag */
-        WriteByte(pkg, 0x80);
+        PutByte(pkg, 0x80);
         /* dst devid */
-        WriteStr(pkg, dst_devid);
+        PutStr(pkg, dst_devid, devid_len);
     }
     else
     {
-        /* remain len */
-        remainlen = 1 + 1 + (2 + json_len);
-        WriteRemainlen(pkg, remainlen);
         /* translate address flag */
-        WriteByte(pkg, 0x00);
+        PutByte(pkg, 0x00);
     }
     /* json flag */
-    WriteByte(pkg, type);
+    PutByte(pkg, type);
     /* json */
-    WriteStr(pkg, json_out);
+    PutStr(pkg, json_out, json_len);
     free(json_out);
     return pkg;
 }
@@ -679,6 +753,7 @@ EdpPacket* PacketSavedataBin(const char* dst_devid,
     uint32_t remainlen = 0;
     char* desc_out = NULL;
     uint32_t desc_len = 0;
+    uint16_t devid_len = 0;
 
     /* check arguments */
     desc_out = cJSON_Print(desc_obj);
@@ -691,45 +766,54 @@ EdpPacket* PacketSavedataBin(const char* dst_devid,
         free(desc_out);
         return 0;
     }
-    pkg = NewBuffer();
-    /* msg type */
-    WriteByte(pkg, SAVEDATA);
+    /* msg type + remain len */
+    remainlen = 1 + 1 + (2 + desc_len) + (4 + bin_len);
+    if (dst_devid)
+    {
+        devid_len = strlen(dst_devid);
+        remainlen += 2 + devid_len;
+    }
+    /* 图片数据在包头之后单独发送, 只按包头的长度申请 */
+    pkg = NewBufferSize(1 + RemainlenSize(remainlen) + remainlen - bin_len);
+    if (pkg == NULL)
+    {
+        free(desc_out);
+        return NULL;
+    }
+    PutByte(pkg, SAVEDATA);
+    WriteRemainlen(pkg, remainlen);
     if (dst_devid)
     {
-        /* remain len */
-        remainlen = 1 + (2 + strlen(dst_devid)) + 1 + (2 + desc_len) + (4 + bin_len);
-        WriteRemainlen(pkg, remainlen);
         /* translate address flag */
-        WriteByte(pkg, 0x80);
+        PutByte(pkg, 0x80);
         /* dst devid */
-        WriteStr(pkg, dst_devid);
+        PutStr(pkg, dst_devid, devid_len);
     }
     else
     {
-        /* remain len */
-        remainlen = 1 + 1 + (2 + desc_len) + (4 + bin_len);
-        WriteRemainlen(pkg, remainlen);
         /* translate address flag */
-        WriteByte(pkg, 0x00);
+        PutByte(pkg, 0x00);
     }
     /* bin flag */
-    WriteByte(pkg, 0x02);
+    PutByte(pkg, 0x02);
     /* desc */
-    WriteStr(pkg, desc_out);
+    PutStr(pkg, desc_out, desc_len);
     free(desc_out);
     /* bin data */
-    WriteUint32(pkg, bin_len);
+    PutUint32(pkg, bin_len);
     //WriteBytes(pkg, bin_data, bin_len);		//内存不足，去除图片数据
 												//在发送完包头之后单独发送图片数据
     return pkg;
 }
 
-EdpPacket* PacketSavedataBinStr(const char* dst_devid,
-                                const char* desc_str, const uint8_t* bin_data, uint32_t bin_len)
+/* 打包bin数据包头, 另外预留data_cap字节给紧跟在包头之后的bin数据 */
+static EdpPacket* NewSavedataBinHead(const char* dst_devid,
+                                     const char* desc_str, uint32_t bin_len, uint32_t data_cap)
 {
     EdpPacket* pkg = NULL;
     uint32_t remainlen = 0;
     uint32_t desc_len = 0;
+    uint16_t devid_len = 0;
 
     /* check arguments */
     desc_len = strlen(desc_str);
@@ -738,68 +822,153 @@ EdpPacket* PacketSavedataBinStr(const char* dst_devid,
         /* desc < 2^16 && bin_len < 3M*/
         return 0;
     }
-    pkg = NewBuffer();
-    /* msg type */
-    WriteByte(pkg, SAVEDATA);
+    /* msg type + remain len */
+    remainlen = 1 + 1 + (2 + desc_len) + (4 + bin_len);
+    if (dst_devid)
+    {
+        devid_len = strlen(dst_devid);
+        remainlen += 2 + devid_len;
+    }
+    pkg = NewBufferSize(1 + RemainlenSize(remainlen) + remainlen - bin_len + data_cap);
+    if (pkg == NULL)
+    {
+        return NULL;
+    }
+    PutByte(pkg, SAVEDATA);
+    WriteRemainlen(pkg, remainlen);
     if (dst_devid)
     {
-        /* remain len */
-        remainlen = 1 + (2 + strlen(dst_devid)) + 1 + (2 + desc_len) + (4 + bin_len);
-        WriteRemainlen(pkg, remainlen);
         /* translate address flag */
-        WriteByte(pkg, 0x80);
+        PutByte(pkg, 0x80);
         /* dst devid */
-        WriteStr(pkg, dst_devid);
+        PutStr(pkg, dst_devid, devid_len);
     }
     else
     {
-        /* remain len */
-        remainlen = 1 + 1 + (2 + desc_len) + (4 + bin_len);
-        WriteRemainlen(pkg, remainlen);
         /* translate address flag */
-        WriteByte(pkg, 0x00);
+        PutByte(pkg, 0x00);
     }
     /* bin flag */
-    WriteByte(pkg, 0x02);
+    PutByte(pkg, 0x02);
     /* desc */
-    WriteStr(pkg, desc_str);
+    PutStr(pkg, desc_str, desc_len);
+    /* bin len */
+    PutUint32(pkg, bin_len);
+    return pkg;
+}
+
+EdpPacket* PacketSavedataBinHead(const char* dst_devid,
+                                 const char* desc_str, uint32_t bin_len)
+{
+    /* bin data由调用者紧跟在包头之后写入, 只按包头的长度申请 */
+    return NewSavedataBinHead(dst_devid, desc_str, bin_len, 0);
+}
+
+EdpPacket* PacketSavedataBinStr(const char* dst_devid,
+                                const char* desc_str, const uint8_t* bin_data, uint32_t bin_len)
+{
+    EdpPacket* pkg = NULL;
+
+    pkg = NewSavedataBinHead(dst_devid, desc_str, bin_len, bin_len);
+    if (pkg == NULL)
+    {
+        return NULL;
+    }
     /* bin data */
-    WriteUint32(pkg, bin_len);
-    WriteBytes(pkg, bin_data, bin_len);
+    PutBytes(pkg, bin_data, bin_len);
     return pkg;
 }
 
+int32_t StreamSavedataBin(const char* dst_devid, const char* desc_str,
+                          const uint8_t* bin_data, EdpStreamRead reader, void* reader_arg,
+                          uint32_t bin_len, uint32_t chunk_size,
+                          EdpStreamWrite writer, void* writer_arg)
+{
+    EdpPacket* pkg = NULL;
+    uint8_t* chunk = NULL;
+    const uint8_t* p = NULL;
+    uint32_t offset = 0;
+    uint32_t len = 0;
+    int32_t rc = 0;
+
+    if (writer == NULL || chunk_size == 0 || (bin_data == NULL && reader == NULL))
+        return ERR_STREAM_SAVED_BIN_HEAD;
+
+    /* 包头: type + remainlen + desc + bin_len */
+    pkg = PacketSavedataBinHead(dst_devid, desc_str, bin_len);
+    if (pkg == NULL)
+        return ERR_STREAM_SAVED_BIN_HEAD;
+    rc = writer(writer_arg, pkg->_data, pkg->_write_pos);
+    DeleteBuffer(&pkg);
+    if (rc < 0)
+        return ERR_STREAM_SAVED_BIN_WRITE;
+
+    /* 数据源不可直接寻址时, 只申请一个分片大小的缓冲区 */
+    if (bin_data == NULL)
+    {
+        chunk = (uint8_t*)malloc(chunk_size);
+        if (chunk == NULL)
+            return ERR_STREAM_SAVED_BIN_READ;
+    }
+
+    /* 包体: 按chunk_size分片发送 */
+    while (offset < bin_len)
+    {
+        len = bin_len - offset;
+        if (len > chunk_size)
+            len = chunk_size;
+
+        if (bin_data)
+        {
+            p = bin_data + offset;
+        }
+        else
+        {
+            if (reader(reader_arg, offset, chunk, len) < 0)
+            {
+                rc = ERR_STREAM_SAVED_BIN_READ;
+                break;
+            }
+            p = chunk;
+        }
+
+        if (writer(writer_arg, p, len) < 0)
+        {
+            rc = ERR_STREAM_SAVED_BIN_WRITE;
+            break;
+        }
+        offset += len;
+    }
+
+    if (chunk)
+        free(chunk);
+    return (offset == bin_len) ? 0 : rc;
+}
+
 EdpPacket* PacketCmdResp(const char* cmdid, uint16_t cmdid_len,
                          const char* resp, uint32_t resp_len)
 {
     EdpPacket* send_pkg = NULL;
     unsigned remainlen = 0;
 
-    send_pkg = NewBuffer();
     /* 6 = 2 + 4 = len(cmdid_len) + len(resp_len) */
     remainlen = cmdid_len + resp_len + (resp_len ? 6 : 2);
-    WriteByte(send_pkg, CMDRESP);
-    WriteRemainlen(send_pkg, remainlen);
-    WriteUint16(send_pkg, cmdid_len);
-    WriteBytes(send_pkg, cmdid, cmdid_len);
+    send_pkg = NewPacket(CMDRESP, remainlen);
+    if (send_pkg == NULL)
+        return NULL;
+    PutStr(send_pkg, cmdid, cmdid_len);
     if (resp_len)
     {
-        WriteUint32(send_pkg, resp_len);
-        WriteBytes(send_pkg, resp, resp_len);
+        PutUint32(send_pkg, resp_len);
+        PutBytes(send_pkg, resp, resp_len);
     }
     return send_pkg;
 }
 /* ping (C->S) */
 EdpPacket* PacketPing(void)
 {
-    EdpPacket* pkg = NULL;
-
-    pkg = NewBuffer();
-    /* msg type */
-    WriteByte(pkg, PINGREQ);
-    /* remain len */
-    WriteRemainlen(pkg, 0);
-    return pkg;
+    /* msg type + remain len */
+    return NewPacket(PINGREQ, 0);
 }
 /*---------------------------------------------------------------------------*/
 /* recv stream to a edp packet (S->C) */
@@ -814,7 +983,9 @@ EdpPacket* GetEdpPacket(RecvBuffer* buf)
         printf("%s flag<=0\n", __func__);
         return pkg;
     }
-    pkg = NewBuffer();
+    pkg = NewBufferSize(flag);
+    if (pkg == NULL)
+        return NULL;
     WriteBytes(pkg, buf->_data, flag);
     /* shrink buffer */
     memmove(buf->_data, buf->_data + flag, buf->_write_pos - flag);
@@ -1016,33 +1187,35 @@ EdpPacket* PacketSavedataSimpleString(const char* dst_devid, const char* input)
     EdpPacket* pkg = NULL;
     uint32_t remainlen = 0;
     uint32_t input_len = 0;
+    uint16_t devid_len = 0;
 
-    pkg = NewBuffer();
     input_len = strlen(input);
-    /* msg type */
-    WriteByte(pkg, SAVEDATA);
+    /* msg type + remain len */
+    remainlen = 1 + 1 + (2 + input_len);
+    if (dst_devid)
+    {
+        devid_len = strlen(dst_devid);
+        remainlen += 2 + devid_len;
+    }
+    pkg = NewPacket(SAVEDATA, remainlen);
+    if (pkg == NULL)
+        return NULL;
     if (dst_devid)
     {
-        /* remain len */
-        remainlen = 1 + (2 + strlen(dst_devid)) + 1 + (2 + input_len);
-        WriteRemainlen(pkg, remainlen);
         /* translate address flag */
-        WriteByte(pkg, 0x80);
+        PutByte(pkg, 0x80);
         /* dst devid */
-        WriteStr(pkg, dst_devid);
+        PutStr(pkg, dst_devid, devid_len);
     }
     else
     {
-        /* remain len */
-        remainlen = 1 + 1 + (2 + input_len);
-        WriteRemainlen(pkg, remainlen);
         /* translate address flag */
-        WriteByte(pkg, 0x00);
+        PutByte(pkg, 0x00);
     }
     /* json flag */
-    WriteByte(pkg, kTypeString);
+    PutByte(pkg, kTypeString);
     /* json */
-    WriteStr(pkg, input);
+    PutStr(pkg, input, input_len);
 
     return pkg;
 }
@@ -52,6 +52,9 @@ extern "C" {
 #define ERR_UNPACK_CMDREQ                       -1031
 #define ERR_UNPACK_ENCRYPT_RESP                 -1032
 #define ERR_UNPACK_SAVEDATA_ACK                 -1033
+#define ERR_STREAM_SAVED_BIN_HEAD               -1040
+#define ERR_STREAM_SAVED_BIN_READ               -1041
+#define ERR_STREAM_SAVED_BIN_WRITE              -1042
 
 /*----------------------------消息类型---------------------------------------*/
 /* 连接请求 */
@@ -111,6 +114,17 @@ typedef struct Buffer
  *          返回值为空 生成Buffer失败, 内存不够
  */
 EDPKIT_DLL Buffer* NewBuffer(void);
+/*
+ * 函数名:  NewBufferSize
+ * 功能:    生成初始容量为size字节的Buffer
+ * 说明:    打包函数在已知包总长时用它一次申请到位, 避免从BUFFER_SIZE开始
+ *          成倍扩容和拷贝; 同样需要用DeleteBuffer销毁
+ * 参数:    size    Buffer的初始容量
+ * 返回值:  类型 (Buffer*)
+ *          返回值非空 生成Buffer成功, 返回这个Buffer的指针
+ *          返回值为空 生成Buffer失败, 内存不够
+ */
+EDPKIT_DLL Buffer* NewBufferSize(uint32_t size);
 /*
  * 函数名:  DeleteBuffer
  * 功能:    销毁Buffer
@@ -615,6 +629,57 @@ EdpPacket* PacketSavedataBin(const char* dst_devid,
 EDPKIT_DLL EdpPacket* PacketSavedataBinStr(const char* dst_devid,
         const char* desc_str, const uint8_t* bin_data, uint32_t bin_len);
 
+/*
+ * 流式发送bin数据时使用的回调函数类型
+ * EdpStreamWrite   将len字节数据写入传输通道(串口/socket), 返回<0表示发送失败
+ * EdpStreamRead    从数据源offset处读取len字节数据到buf, 返回<0表示读取失败
+ */
+typedef int32_t (*EdpStreamWrite)(void* arg, const uint8_t* data, uint32_t len);
+typedef int32_t (*EdpStreamRead)(void* arg, uint32_t offset, uint8_t* buf, uint32_t len);
+
+/*
+ * 函数名:  PacketSavedataBinHead
+ * 功能:    打包 设备到设备云的EDP协议包头, 存储数据(bin格式数据)
+ * 说明:    只包含消息类型, remainlen, 目的设备ID, desc和4字节的bin长度,
+ *          不包含bin数据, bin数据需要紧跟在包头之后由调用者发送
+ *          返回的EDP包发送给设备云后, 需要删除这个包
+ * 相关函数:StreamSavedataBin, PacketSavedataBinStr
+ * 参数:    dst_devid   目的设备ID
+ *          desc_str    数据描述 字符串格式
+ *          bin_len     二进制数据长度
+ * 返回值:  类型 (EdpPacket*)
+ *          非空        EDP协议包头
+ *          为空        EDP协议包生成失败
+ */
+EDPKIT_DLL EdpPacket* PacketSavedataBinHead(const char* dst_devid,
+        const char* desc_str, uint32_t bin_len);
+
+/*
+ * 函数名:  StreamSavedataBin
+ * 功能:    流式发送 设备到设备云的EDP协议包, 存储数据(bin格式数据)
+ * 说明:    先发送PacketSavedataBinHead生成的包头, 再将bin数据按chunk_size分片,
+ *          直接交给writer发送, bin数据不会整体拷贝到堆上
+ *          bin_data非空时, 分片直接指向bin_data(如flash中的const数组), 不占用RAM;
+ *          bin_data为空时, 通过reader逐片读取到一个chunk_size大小的临时缓冲区
+ * 相关函数:PacketSavedataBinHead
+ * 参数:    dst_devid   目的设备ID
+ *          desc_str    数据描述 字符串格式
+ *          bin_data    二进制数据, 可为空
+ *          reader      bin_data为空时使用的数据读取回调
+ *          reader_arg  reader的参数
+ *          bin_len     二进制数据长度
+ *          chunk_size  每次交给writer的分片大小
+ *          writer      数据发送回调
+ *          writer_arg  writer的参数
+ * 返回值:  类型 (int32_t)
+ *          =0          发送成功
+ *          <0          发送失败, 具体失败原因见本h文件的错误码
+ */
+EDPKIT_DLL int32_t StreamSavedataBin(const char* dst_devid, const char* desc_str,
+        const uint8_t* bin_data, EdpStreamRead reader, void* reader_arg,
+        uint32_t bin_len, uint32_t chunk_size,
+        EdpStreamWrite writer, void* writer_arg);
+
 /*
  * 函数名:  UnpackSavedata
  * 功能:    解包 由设备云到设备的EDP协议包, 存储数据
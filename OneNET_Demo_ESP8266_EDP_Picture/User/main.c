@@ -37,21 +37,49 @@
 #define DEV_ID      "1078702"                       //设备ID  需要修改为用户自己的对应参数
 #define PKT_SIZE 	200								//图片分包大小，根据模块特性修改，分包过大容易导致模块丢包
 
+#if USART2_FLOW_CTRL
+#define PKT_DELAY   0                                 //模组用RTS/CTS限速, 不用再等
+#else
+#define PKT_DELAY   1000                              //分片发送间隔(ms)
+#endif
+
 #include "image_2k.c"   //图片文件二进制数组
 
+/**
+  * @brief  EDP流式发送回调, 将一个分片直接通过串口发送给模块
+  * @param  arg: 未使用
+  * @param  data: 分片数据, 图片数据时直接指向flash中的image数组
+  * @param  len: 分片长度
+  * @retval 发送的数据长度
+  */
+static int32_t EDP_StreamWrite(void *arg, const uint8_t *data, uint32_t len)
+{
+    USART2_Write(USART2, (uint8_t *)data, len);    //串口发送
+    if(len == PKT_SIZE)
+    {
+        printf(".");
+#if PKT_DELAY
+        mDelay(PKT_DELAY);     //分片发送间隔, 避免模块丢包
+#endif
+    }
+    return len;
+}
+
 /**
   * @brief      实现EDP连接，每5s上传一次图片数据到平台
   * @attention  使用UART2连接ESP8266模块，使用透传模式发送和接收数据
   *			    使用UART1作为调试打印串口，使用printf将从该接口打印消息
   *			    Recv_Thread_Func函数是调用的官方edp_sdk中提供的函数，在其上加以修改
   *			    其中提供了所有的EDP包的解析函数
+  *			    图片数据由StreamSavedataBin从flash中分片直接发送，不拷贝到RAM
   */
 int main(void)
 {
-    cJSON *desc_json;
     char text[] = "{\"ds_id\":\"pic\"}";	//图像属性：数据流ID -> pic
     EdpPacket* send_pkg;
+    int32_t rtn;
 
+    SystickTime_Init();     //1ms节拍, mDelay按它计时
     USART1_Config();        //USART1作为打印串口
     USART2_Config();        //USART2连接ESP8266模块
 
@@ -76,48 +104,24 @@ init:
     mDelay(1000);
 	
 	Recv_Thread_Func();				//查看接收数据，此处只用于解析连接应答
-		
-	desc_json = cJSON_Parse(text);	//图像属性，CJSON格式化
 
 	/* 循环发送图片数据 */
     while(1)
     {
-        uint8_t *p = (uint8_t *)image;
-        int32_t tmp = sizeof(image);
-
         //Recv_Thread_Func();
 
-        /* 上传图片 - 发送EDP包头 */
-		send_pkg = PacketSavedataBin(NULL, desc_json, image, sizeof(image));//创建EDP包头，不包含二进制数据
-		if(send_pkg == NULL)
+        /* 上传图片 - 发送EDP包头，然后从flash分片发送图片 */
+		printf("send pic");
+		rtn = StreamSavedataBin(NULL, text, (const uint8_t *)image, NULL, NULL,
+		                        sizeof(image), PKT_SIZE, EDP_StreamWrite, NULL);
+		if(rtn < 0)
 		{
-			printf("save bin pkt create error\r\n");
-			return;
+			printf("\r\nsave bin stream error: %d\r\n", rtn);
+		}
+		else
+		{
+			printf("\r\npic send over\r\n");
 		}
-		printf("send EDP head\r\n");
-		USART2_Write(USART2, (uint8_t*)(send_pkg->_data), send_pkg->_write_pos);//串口发送
-		hexdump(send_pkg->_data, send_pkg->_write_pos);	//打印发送内容
-		DeleteBuffer(&send_pkg);		//完成发送需要将缓冲区释放
-
-        /* 上传图片 - 图片分片发送 */
-		printf("send pic");
-        while(tmp > 0)
-        {
-            printf(".");
-            if(tmp >= PKT_SIZE)
-            {
-                USART2_Write(USART2, p, PKT_SIZE);	//串口发送分片
-                p += PKT_SIZE;
-                tmp -= PKT_SIZE;
-            }
-            else
-            {
-                USART2_Write(USART2, p, tmp);		//串口发送最后一个分片
-                tmp = 0;
-				printf("\r\npic send over\r\n");
-            }
-            mDelay(1000);	//1s发送一个分片
-        }
 
         USART2_Clear();
         mDelay(5000);
@@ -0,0 +1,191 @@
+#include "stm32f10x.h"
+#include <string.h>
+#include "ring.h"
+
+/*
+ * 数据和下标之间的顺序: 生产者先写数据再更新head, 消费者先读数据再更新tail.
+ * 单核Cortex-M3上只需阻止编译器重排, __DMB()同时起到编译器屏障的作用.
+ */
+#ifndef RING_BARRIER
+#define RING_BARRIER() __DMB()
+#endif
+
+/*
+ *  @brief 初始化, size必须是2的幂
+ */
+void Ring_Init(Ring *r, uint8_t *buf, uint32_t size)
+{
+    r->buf = buf;
+    r->size = size;
+    r->head = 0;
+    r->tail = 0;
+    r->overflow = 0;
+}
+
+/*
+ *  @brief 未读字节数
+ */
+uint32_t Ring_Count(const Ring *r)
+{
+    return r->head - r->tail;
+}
+
+/*
+ *  @brief 空闲字节数
+ */
+uint32_t Ring_Free(const Ring *r)
+{
+    return r->size - (r->head - r->tail);
+}
+
+/*
+ *  @brief 取得可直接写入的连续空间(到缓冲区末尾或已用区为止)
+ *  @retval 连续空间长度, 0表示满
+ */
+uint32_t Ring_WriteSpan(const Ring *r, uint8_t **p)
+{
+    uint32_t head = r->head;
+    uint32_t idx = head & (r->size - 1);
+    uint32_t n = r->size - (head - r->tail);
+
+    if(n > r->size - idx)
+    {
+        n = r->size - idx;
+    }
+    *p = r->buf + idx;
+    return n;
+}
+
+/*
+ *  @brief 提交已写入Ring_WriteSpan空间的len字节
+ */
+void Ring_Commit(Ring *r, uint32_t len)
+{
+    RING_BARRIER();
+    r->head += len;
+}
+
+/*
+ *  @brief 写入数据, 放不下的部分丢掉并计入overflow
+ *  @retval 写入的字节数
+ */
+uint32_t Ring_Put(Ring *r, const uint8_t *data, uint32_t len)
+{
+    uint8_t *p;
+    uint32_t n;
+    uint32_t done = 0;
+
+    while(done < len)
+    {
+        n = Ring_WriteSpan(r, &p);
+        if(n == 0)
+        {
+            r->overflow += len - done;
+            break;
+        }
+        if(n > len - done)
+        {
+            n = len - done;
+        }
+        memcpy(p, data + done, n);
+        Ring_Commit(r, n);
+        done += n;
+    }
+    return done;
+}
+
+/*
+ *  @brief 写入一个字节, 满时丢掉并计入overflow, 接收中断中逐字节调用
+ *  @retval 1写入, 0丢弃
+ */
+uint32_t Ring_PutByte(Ring *r, uint8_t data)
+{
+    uint32_t head = r->head;
+
+    if(head - r->tail >= r->size)
+    {
+        r->overflow++;
+        return 0;
+    }
+    r->buf[head & (r->size - 1)] = data;
+    RING_BARRIER();
+    r->head = head + 1;
+    return 1;
+}
+
+/*
+ *  @brief 取得可直接读取的连续数据(到缓冲区末尾或未读数据末尾为止)
+ *  @retval 连续数据长度, 0表示空
+ */
+uint32_t Ring_ReadSpan(const Ring *r, const uint8_t **p)
+{
+    uint32_t tail = r->tail;
+    uint32_t idx = tail & (r->size - 1);
+    uint32_t n = r->head - tail;
+
+    RING_BARRIER();
+    if(n > r->size - idx)
+    {
+        n = r->size - idx;
+    }
+    *p = r->buf + idx;
+    return n;
+}
+
+/*
+ *  @brief 取走len字节, len不能超过Ring_Count
+ */
+void Ring_Consume(Ring *r, uint32_t len)
+{
+    RING_BARRIER();
+    r->tail += len;
+}
+
+/*
+ *  @brief 从第offset个未读字节开始拷贝最多len字节, 不取走
+ *  @retval 拷贝的字节数
+ */
+uint32_t Ring_Peek(const Ring *r, uint32_t offset, uint8_t *dst, uint32_t len)
+{
+    uint32_t tail = r->tail;
+    uint32_t count = r->head - tail;
+    uint32_t idx, n;
+
+    RING_BARRIER();
+    if(offset >= count)
+    {
+        return 0;
+    }
+    if(len > count - offset)
+    {
+        len = count - offset;
+    }
+    idx = (tail + offset) & (r->size - 1);
+    n = r->size - idx;
+    if(n > len)
+    {
+        n = len;
+    }
+    memcpy(dst, r->buf + idx, n);
+    memcpy(dst + n, r->buf, len - n);   /*绕回的部分*/
+    return len;
+}
+
+/*
+ *  @brief 拷贝并取走最多len字节
+ *  @retval 取走的字节数
+ */
+uint32_t Ring_Get(Ring *r, uint8_t *dst, uint32_t len)
+{
+    len = Ring_Peek(r, 0, dst, len);
+    Ring_Consume(r, len);
+    return len;
+}
+
+/*
+ *  @brief 丢掉全部未读数据
+ */
+void Ring_Flush(Ring *r)
+{
+    r->tail = r->head;
+}
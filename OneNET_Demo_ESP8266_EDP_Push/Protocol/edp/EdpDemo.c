@@ -153,10 +153,16 @@ void Recv_Thread_Func(void)
 		while ((rcv_len = USART2_GetRcvNum()) > 0)
         {
 			printf("rcv_len: %d\r\n", rcv_len);
-			USART2_GetRcvData(buffer, usart2_rcv_len);
-			hexdump(buffer, usart2_rcv_len);   //打印接收数据
 			mDelay(500);
         }
+		rcv_len = Ring_Count(&usart2_rcv_ring);
+		if (rcv_len > sizeof(buffer) - 1)
+		{
+			rcv_len = sizeof(buffer) - 1;	//留一个字节放结束符, uartDataParse按字符串查找
+		}
+		USART2_GetRcvData(buffer, rcv_len);
+		buffer[rcv_len] = 0;
+		hexdump(buffer, rcv_len);   //打印接收数据
         //printf("rcv_len: %d\r\n", rcv_len);
         //mDelay(100);
         //USART2_GetRcvData(buffer, usart2_rcv_len);
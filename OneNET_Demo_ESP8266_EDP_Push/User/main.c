@@ -46,6 +46,7 @@ int main(void)
     EdpPacket* edpPkt;
 	uint32_t timeCount = 0;
 
+    SystickTime_Init();     //1ms节拍, mDelay按它计时
     USART1_Config();        //USART1作为打印串口
     USART2_Config();        //USART2连接ESP8266模块
 
@@ -25,6 +25,7 @@
 #include "stm32f10x_it.h"
 #include "usart1.h"
 #include "usart2.h"
+#include "utils.h"
 
 extern uint32_t SystickTime;
 extern __IO uint32_t TimeDisplay;
@@ -139,8 +140,7 @@ void PendSV_Handler(void)
   */
 void SysTick_Handler(void)
 {
-    //SystickTime_Increase();
-    //SystickTime++;
+    SystickTime_Increase();
 }
 
 /******************************************************************************/
@@ -200,9 +200,7 @@ void USART2_IRQHandler(void)
     {
         //GPIO_SetBits(GPIOC,GPIO_Pin_0|GPIO_Pin_1|GPIO_Pin_2|GPIO_Pin_3);
         data = USART2->DR;
-        usart2_rcv_buf[usart2_rcv_len++] = data;
-		if(usart2_rcv_len >= MAX_RCV_LEN - 1)
-			usart2_rcv_len = 0;
+        Ring_PutByte(&usart2_rcv_ring, data);  //满时丢弃, 计入overflow, 不再绕回开头覆盖
         //usart1_rcv_buf[usart1_rcv_len++]=data;
         //usart1_putrxchar(data);       //Insert received character into buffer
     }
@@ -2,6 +2,7 @@
 #include "stdio.h"
 #include "hal_i2c.h"
 #include "utils.h"
+#include "log.h"
 #define ADXL345_ADDRESS 0x53
 void ADXL345_init(void)
 {
@@ -22,7 +23,7 @@ void ADXL345_init(void)
 #define OFSZ 0x20
     mDelay(20);
     Hal_I2C_ByteRead(I2C2, ADXL345_ADDRESS, 0x00, &devid);
-    printf("\r\ndevice ID=%x,\r\n", devid);
+    LOG_I(LOG_MOD_SENSOR, "ADXL345 device ID=%x", devid);
 #if 0
     mDelay(500);
     Hal_I2C_ByteWrite(I2C2, ADXL345_ADDRESS, POWER_CTL, &pw_ctl); //链接使能,测量模式
@@ -53,7 +54,6 @@ uint8_t data[6];
 void ADXL345_GETXYZ(int16_t data_out[3])
 {
     float f1, f2, f3;
-    ADXL345_init(); //每次读写寄存器之前都要先读device ID
 
     Hal_I2C_MutiRead(I2C2, data, ADXL345_ADDRESS, 0x32, 6);
     data_out[0] = (int16_t)(data[0] + ((uint16_t)data[1] << 8));
@@ -79,5 +79,5 @@ void ADXL345_GETXYZ(int16_t data_out[3])
         printf("%s f3- %f\n", __func__, f3);
     }
 #endif
-    printf("ADXL345 ******X=%d,Y=%d,Z=%d*****\n", data_out[0], data_out[1], data_out[2]);
+    LOG_D(LOG_MOD_SENSOR, "ADXL345 X=%d,Y=%d,Z=%d", data_out[0], data_out[1], data_out[2]);
 }
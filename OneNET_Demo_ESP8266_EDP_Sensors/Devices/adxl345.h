@@ -14,7 +14,8 @@ void ADXL345_init(void);
 
 /**
   * @brief  获取ADXL345传感器数值，各方向LSB RAW数据.X:data_out[0],Y:data_out[1],Z:data_out[2]
+  *         读之前需调用一次ADXL345_init
   * @param  data_out:存储传感器采集结果
   * @retval None
   **/
-void ADXL345_GETXYZ(int16_t data_out[3])；
\ No newline at end of file
+void ADXL345_GETXYZ(int16_t data_out[3]);
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include "stdio.h"
 #include "bh1750fvi.h"
 #include "utils.h"
+#include "log.h"
 
 #define BH1750FVI_ADDR 0x23
 
@@ -69,7 +70,6 @@ uint16_t Read_BH1750(void)
     uint8_t data[2], *buf = data;
     uint16_t result = 0;
     float result_lx = 0;
-    BH1750_Init();
     I2C_AcknowledgeConfig(I2C2, ENABLE);
     /* Send START condition */
     I2C_GenerateSTART(I2C2, ENABLE);/***start *******/
@@ -101,7 +101,7 @@ uint16_t Read_BH1750(void)
     result = (uint16_t)((data[0] << 8) + data[1]); //合成数据，即光照数据
 
     result_lx = (float)result / 1.2;
-    printf("BH1750FVI:%f %d\n", result_lx, (uint16_t)result_lx);
+    LOG_D(LOG_MOD_SENSOR, "BH1750FVI:%f %d", result_lx, (uint16_t)result_lx);
     return  (uint16_t)result_lx;
 }
 
@@ -38,7 +38,7 @@ void BH1750FVI_loop(void);
 void BH1750_Init(void);
 
 /**
-  * @brief  获得传感器数值
+  * @brief  获得传感器数值，读之前需调用一次BH1750_Init
   * @param  None
   * @retval 返回光照，单位lx
   **/
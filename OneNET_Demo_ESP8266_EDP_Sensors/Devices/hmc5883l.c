@@ -3,6 +3,7 @@
 #include "hal_i2c.h"
 #include "stdio.h"
 #include "hmc5883l.h"
+#include "log.h"
 
 #define HMC5883L_ADDR 0x1e
 
@@ -38,10 +39,7 @@ void HMC5883L_Init(void)
 void HMC5883L_GetXYZ(int16_t data_out[3])
 {
     uint8_t data[6];
-    HMC5883L_Init();
-    mDelay(200);
     Hal_I2C_MutiRead(I2C2, data, HMC5883L_ADDR, 0x3, 6);
-    mDelay(10);
     data_out[0] = (int16_t)(data[1] + ((uint16_t)data[0] << 8));
     data_out[1] = (int16_t)(data[3] + ((uint16_t)data[1] << 8));
     data_out[2] = (int16_t)(data[5] + ((uint16_t)data[2] << 8));
@@ -49,19 +47,19 @@ void HMC5883L_GetXYZ(int16_t data_out[3])
     if(data_out[0] < 0)
     {
         data_out[0] = -data_out[0];
-        printf("%s  x %d\n", __func__, data_out[0]);
+        LOG_D(LOG_MOD_SENSOR, "%s  x %d", __func__, data_out[0]);
     }
     if(data_out[1] < 0)
     {
         data_out[1] = -data_out[1];
-        printf("%s z  %d\n", __func__, data_out[1]);
+        LOG_D(LOG_MOD_SENSOR, "%s z  %d", __func__, data_out[1]);
     }
     if(data_out[2] < 0)
     {
         data_out[2] = -data_out[2];
-        printf("%s y %d\n", __func__, data_out[2]);
+        LOG_D(LOG_MOD_SENSOR, "%s y %d", __func__, data_out[2]);
     }
 
-    printf("HMC5883L ******X=0x%x,Z=0x%x,y=0x%x*****\n", (int16_t)data_out[0], (int16_t)data_out[1], (int16_t)data_out[2]);
-    printf("status reg:0x%x\n", HMC5883L_ReadByte(9));
+    LOG_D(LOG_MOD_SENSOR, "HMC5883L X=0x%x,Z=0x%x,y=0x%x", (int16_t)data_out[0], (int16_t)data_out[1], (int16_t)data_out[2]);
+    LOG_D(LOG_MOD_SENSOR, "status reg:0x%x", HMC5883L_ReadByte(HMC58X3_R_STATUS));
 }
\ No newline at end of file
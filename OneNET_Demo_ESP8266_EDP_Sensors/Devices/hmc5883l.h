@@ -23,9 +23,15 @@
 #define HMC58X3_R_IDA 10
 #define HMC58X3_R_IDB 11
 #define HMC58X3_R_IDC 12
+/**
+  * @brief  配置为连续测量模式
+  * @param  None
+  * @retval None
+  **/
 void HMC5883L_Init(void);
 /**
   * @brief  获取HMC5883L传感器数值，各方向 RAW数据X:data_out[0],Z:data_out[1],Y:data_out[2];
+  *         读之前需调用一次HMC5883L_Init
   * @param  data_out:存储传感器采集结果
   * @retval None
   **/
@@ -6,6 +6,7 @@
 #include "hal_i2c.h"
 #include "sht20.h"
 #include "utils.h"
+#include "log.h"
 
 const int16_t POLYNOMIAL = 0x131;
 int8_t SHT2x_CheckCrc(int8_t data[], int8_t nbrOfBytes, int8_t checksum);
@@ -51,12 +52,34 @@ void SHT20_write_user_reg(uint8_t val)
   * @param  pMeasurand：返回结果
   * @retval ret:0,成功，<0 失败
   **/
+/*换算SHT20返回的原始数据，结果取整*/
+static void SHT2x_Convert(uint8_t is_temp, uint8_t data[2], int8_t checksum, uint16_t *pMeasurand)
+{
+    uint16_t tmp;
+    float t;
+
+    tmp = (data[0] << 8) + data[1];
+    if(is_temp)
+    {
+        t = SHT2x_CalcTemperatureC(tmp);
+        LOG_D(LOG_MOD_SENSOR, "%s data[0]=%d,data[1]=%d,checksum=%d,t=%f", __func__, data[0], data[1], SHT2x_CheckCrc(data, 2, checksum), t);
+    }
+    else
+    {
+        t = SHT2x_CalcRH(tmp);
+        LOG_D(LOG_MOD_SENSOR, "%s data[0]=%d,data[1]=%d,checksum=%d,rh=%f%%", __func__, data[0], data[1], SHT2x_CheckCrc(data, 2, checksum), t);
+    }
+    if(pMeasurand)
+    {
+        *pMeasurand = (uint16_t)t;
+        LOG_D(LOG_MOD_SENSOR, "%s %d", __func__, *pMeasurand);
+    }
+}
+
 int8_t SHT2x_MeasureHM(uint8_t cmd, uint16_t *pMeasurand)
 {
     int8_t  checksum, addr;  //checksum
     uint8_t  data[2];    //data array for checksum verification
-    uint16_t tmp;
-    float t;
     //start
     addr = SHT20_ADDRESS << 1;
     I2C_AcknowledgeConfig(I2C2, ENABLE);
@@ -89,23 +112,71 @@ int8_t SHT2x_MeasureHM(uint8_t cmd, uint16_t *pMeasurand)
 
     //I2C_AcknowledgeConfig(I2C2, DISABLE);//如果调用了，那么crc无效
     I2C_GenerateSTOP(I2C2, ENABLE);   /********stop******/
-    SHT2x_CheckCrc(data, 2, checksum);
-    tmp = (data[0] << 8) + data[1];
-    if(cmd == SHT20_Measurement_T_HM)
-    {
-        t = SHT2x_CalcTemperatureC(tmp);
-        printf("%s data[0]=%d,data[1]=%d,checksum=%d,t=%f\n", __func__, data[0], data[1], SHT2x_CheckCrc(data, 2, checksum), t);
-    }
-    else
+    SHT2x_Convert(cmd == SHT20_Measurement_T_HM, data, checksum, pMeasurand);
+    return 0;
+}
+
+/**
+  * @brief  非保持模式启动SHT20测量，发出命令后立即返回，转换期间SHT20不占用总线
+  * @param  cmd：SHT20_Measurement_RH_NHM or SHT20_Measurement_T_NHM
+  * @retval ret:0,成功
+  **/
+int8_t SHT2x_MeasureStart(uint8_t cmd)
+{
+    uint8_t addr = SHT20_ADDRESS << 1;
+
+    I2C_AcknowledgeConfig(I2C2, ENABLE);
+    I2C_GenerateSTART(I2C2, ENABLE);      /**********start**********/
+    while(!I2C_CheckEvent(I2C2, I2C_EVENT_MASTER_MODE_SELECT));
+    I2C_Send7bitAddress(I2C2, addr, I2C_Direction_Transmitter); /*******device addr********/
+    while (!I2C_CheckEvent(I2C2, I2C_EVENT_MASTER_TRANSMITTER_MODE_SELECTED));
+    I2C_SendData(I2C2, cmd);    /*****measure cmd**********/
+    while (!I2C_CheckEvent(I2C2, I2C_EVENT_MASTER_BYTE_TRANSMITTED));
+    I2C_GenerateSTOP(I2C2, ENABLE);   /********stop******/
+    return 0;
+}
+
+/**
+  * @brief  读取SHT2x_MeasureStart启动的测量结果，在转换时间(SHT20_T_CONV_MS/SHT20_RH_CONV_MS)之后调用
+  * @param  cmd：启动测量时的命令
+  * @param  pMeasurand：返回结果
+  * @retval ret:0,成功，-1 转换未完成，SHT20不应答读地址
+  **/
+int8_t SHT2x_MeasureRead(uint8_t cmd, uint16_t *pMeasurand)
+{
+    uint8_t addr = SHT20_ADDRESS << 1;
+    uint8_t data[3], *buf = data, num = 3;
+
+    I2C_AcknowledgeConfig(I2C2, ENABLE);
+    I2C_GenerateSTART(I2C2, ENABLE);      /**********start**********/
+    while(!I2C_CheckEvent(I2C2, I2C_EVENT_MASTER_MODE_SELECT));
+    I2C_Send7bitAddress(I2C2, addr, I2C_Direction_Receiver); /*******device addr********/
+    while (!I2C_CheckEvent(I2C2, I2C_EVENT_MASTER_RECEIVER_MODE_SELECTED))
     {
-        t = SHT2x_CalcRH(tmp);
-        printf("%s data[0]=%d,data[1]=%d,checksum=%d,rh=%f%\n", __func__, data[0], data[1], SHT2x_CheckCrc(data, 2, checksum), t);
+        /*转换未完成时SHT20对读地址回NACK*/
+        if(I2C_GetFlagStatus(I2C2, I2C_FLAG_AF) == SET)
+        {
+            I2C_ClearFlag(I2C2, I2C_FLAG_AF);
+            I2C_GenerateSTOP(I2C2, ENABLE);   /********stop******/
+            return -1;
+        }
     }
-    if(pMeasurand)
+    /*两字节数据加一字节校验，最后一字节前NACK并发STOP*/
+    while(num)
     {
-        *pMeasurand = (uint16_t)t;
+        if(num == 1)
+        {
+            I2C_AcknowledgeConfig(I2C2, DISABLE);
+            I2C_GenerateSTOP(I2C2, ENABLE);   /********stop******/
+        }
+        if(I2C_CheckEvent(I2C2, I2C_EVENT_MASTER_BYTE_RECEIVED))
+        {
+            *buf++ = I2C_ReceiveData(I2C2);
+            num--;
+        }
     }
-    printf("%s %d\n", __func__, *pMeasurand);
+    I2C_AcknowledgeConfig(I2C2, ENABLE);
+    SHT2x_Convert(cmd == SHT20_Measurement_T_NHM, data, (int8_t)data[2], pMeasurand);
     return 0;
 }
 #if 0
@@ -160,7 +231,7 @@ int8_t SHT2x_MeasurePoll(uint8_t cmd, uint16_t *pMeasurand, int32_t timeout)
     while(!I2C_CheckEvent(I2C2, I2C_EVENT_MASTER_BYTE_RECEIVED));
     if (i >= 200)
     {
-        printf("timeout\n");
+        LOG_W(LOG_MOD_SENSOR, "%s timeout", __func__);
         goto timeout_l;
     }
     //-- read two data bytes and one checksum byte --
@@ -177,12 +248,12 @@ int8_t SHT2x_MeasurePoll(uint8_t cmd, uint16_t *pMeasurand, int32_t timeout)
     if(cmd == SHT20_Measurement_T_HM)
     {
         t = SHT2x_CalcTemperatureC(tmp);
-        printf("%s data[0]=%d,data[1]=%d,checksum=%d,t=%f\n", __func__, data[0], data[1], SHT2x_CheckCrc(data, 2, checksum), t);
+        LOG_D(LOG_MOD_SENSOR, "%s data[0]=%d,data[1]=%d,checksum=%d,t=%f", __func__, data[0], data[1], SHT2x_CheckCrc(data, 2, checksum), t);
     }
     else
     {
         t = SHT2x_CalcRH(tmp);
-        printf("%s data[0]=%d,data[1]=%d,checksum=%d,rh=%f%\n", __func__, data[0], data[1], SHT2x_CheckCrc(data, 2, checksum), t);
+        LOG_D(LOG_MOD_SENSOR, "%s data[0]=%d,data[1]=%d,checksum=%d,rh=%f%%", __func__, data[0], data[1], SHT2x_CheckCrc(data, 2, checksum), t);
     }
     if(pMeasurand)
     {
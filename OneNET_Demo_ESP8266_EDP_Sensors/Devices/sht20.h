@@ -34,6 +34,21 @@ void SHT20_write_user_reg(uint8_t val);
   **/
 int8_t SHT2x_MeasureHM(uint8_t cmd, uint16_t *pMeasurand);
 
+/**
+  * @brief  非保持模式启动SHT20测量，发出命令后立即返回，转换期间SHT20不占用总线
+  * @param  cmd：SHT20_Measurement_RH_NHM or SHT20_Measurement_T_NHM
+  * @retval ret:0,成功
+  **/
+int8_t SHT2x_MeasureStart(uint8_t cmd);
+
+/**
+  * @brief  读取SHT2x_MeasureStart启动的测量结果，在转换时间(SHT20_T_CONV_MS/SHT20_RH_CONV_MS)之后调用
+  * @param  cmd：启动测量时的命令
+  * @param  pMeasurand：返回结果
+  * @retval ret:0,成功，-1 转换未完成，SHT20不应答读地址
+  **/
+int8_t SHT2x_MeasureRead(uint8_t cmd, uint16_t *pMeasurand);
+
 /**
   * @brief  非保持模式读SHT20模块温度或湿度
   * @param  cmd：SHT20_Measurement_RH_NHM or SHT20_Measurement_T_NHM
@@ -59,3 +74,7 @@ int8_t SHT2x_GetSerialNumber(uint8_t SerialNumber[]);
 #define SHT20_READ_REG  0XE7
 #define SHT20_WRITE_REG  0XE6
 #define SHT20_SOFT_RESET  0XFE
+
+/*默认分辨率(温度14位、湿度12位)下的最长转换时间(ms)*/
+#define SHT20_T_CONV_MS   85
+#define SHT20_RH_CONV_MS  29
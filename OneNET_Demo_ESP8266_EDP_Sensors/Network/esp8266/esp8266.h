@@ -21,6 +21,10 @@
 #define CIPMODE     "AT+CIPMODE=1\r\n"
 #define CIPSEND     "AT+CIPSEND\r\n"
 #define CIPSTATUS   "AT+CIPSTATUS\r\n"
+/*回显测试: 模组(ATE1)原样回显后报ERROR, 内容覆盖0x55/0x2A这类交替位型和全部字母数字*/
+#define ECHO_PATTERN "UUUU****0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz"
+#define ECHO_TEST   "AT+ECHO=" ECHO_PATTERN "\r\n"
+#define ECHO_ROUNDS 3
 
 /**
   * @brief  通过USART2发送数据.
@@ -37,4 +41,10 @@ uint32_t USART2_SendData(int8_t * buf, uint32_t len);
   * @retval NONE
   **/
 void ESP8266_Init(int8_t * server, int8_t * ssid_pwd);
+
+/**
+  * @brief  用AT+UART_CUR把模组和USART2切到更高的波特率, 回显校验不通过时退回
+  * @retval 最终使用的波特率
+  **/
+uint32_t ESP8266_SetBaud(void);
 #endif
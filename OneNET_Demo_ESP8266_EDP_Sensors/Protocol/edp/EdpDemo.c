@@ -15,7 +15,12 @@
 #include "stm32f10x.h"
 #include "usart2.h"
 #include "utils.h"
+#include "log.h"
+#include "sched.h"
 #include "sht20.h"
+#include "bh1750fvi.h"
+#include "adxl345.h"
+#include "hmc5883l.h"
 #include "EdpDemo.h"
 #include "esp8266.h"
 
@@ -31,8 +36,32 @@ int8_t src_dev[] = "768596";
 int32_t DoSend(int32_t sockfd, const uint8_t *buffer, uint32_t len)
 {
     USART2_SendData((uint8_t *)(buffer), len);
-    /* wululu test print send bytes */
-    hexdump((const uint8_t *)buffer, len);
+    LOG_HEX(LOG_LEVEL_DEBUG, LOG_MOD_EDP, "send", buffer, len);
+    return len;
+}
+
+/* DMA发完后在USART2_TxPoll中释放数据包 */
+static void DoSendPacketDone(void *arg)
+{
+    EdpPacket *pkg = (EdpPacket *)arg;
+
+    DeleteBuffer(&pkg);
+}
+/**
+ * @brief  EDP数据包非阻塞发送, 交给USART2的DMA发送队列后立即返回
+ * @param  pkg: 要发送的数据包, 发完后自动释放, 调用后不能再使用
+ * @retval 发送的数据长度, 失败返回-1(数据包已释放)
+ **/
+int32_t DoSendPacket(EdpPacket *pkg)
+{
+    int32_t len = pkg->_write_pos;
+
+    LOG_HEX(LOG_LEVEL_DEBUG, LOG_MOD_EDP, "send", (const uint8_t *)pkg->_data, len);
+    if(USART2_WriteAsync((const uint8_t *)pkg->_data, len, DoSendPacketDone, pkg) < 0)
+    {
+        DeleteBuffer(&pkg);
+        return -1;
+    }
     return len;
 }
 /*
@@ -44,8 +73,7 @@ void Push_DataToMyself(void)
     int8_t push_data[] = {44};
     printf("%s %d\n", __func__, __LINE__);
     send_pkg = PacketPushdata(src_dev, push_data, sizeof(push_data));
-    DoSend(0, (const uint8_t *)send_pkg->_data, send_pkg->_write_pos);
-    DeleteBuffer(&send_pkg);
+    DoSendPacket(send_pkg);
     mDelay(1000);
 }
 /*
@@ -63,8 +91,7 @@ void Save_TemperatueToOneNet(void)
 
     send_pkg = PacketSavedataInt(kTypeSimpleJsonWithoutTime, NULL, "temperature", (uint32_t)temperature[0], 0, NULL);
 
-    DoSend(0, (const uint8_t *)send_pkg->_data, send_pkg->_write_pos);
-    DeleteBuffer(&send_pkg);
+    DoSendPacket(send_pkg);
     mDelay(1000);
 }
 
@@ -84,8 +111,7 @@ void Save_HumToOneNet(void)
 
     send_pkg = PacketSavedataInt(kTypeSimpleJsonWithoutTime, NULL, "hum", (uint32_t)hum[0], 0, NULL);
 
-    DoSend(0, (const uint8_t *)send_pkg->_data, send_pkg->_write_pos);
-    DeleteBuffer(&send_pkg);
+    DoSendPacket(send_pkg);
     mDelay(1000);
 }
 
@@ -109,8 +135,7 @@ void Save_TempHumToOneNet(void)
     printf("%s %d t:%s\n", __func__, __LINE__, data_string_dst);
     send_pkg = PacketSavedataSimpleString(NULL, data_string_dst);
 
-    DoSend(0, (const uint8_t *)send_pkg->_data, send_pkg->_write_pos);
-    DeleteBuffer(&send_pkg);
+    DoSendPacket(send_pkg);
     mDelay(1000);
 }
 uint8_t data_string_dst[256];
@@ -118,95 +143,510 @@ uint8_t data_string_t[64];
 uint8_t data_string_adxl[64];
 uint8_t data_string_hmc5883l[64];
 
+/*
+ *  @brief  传感器采样任务，最近一次采样的结果供上传使用
+ *          各传感器分步读取，SHT20的转换时间也作为一步返回给调度器，等待期间其他任务照常运行
+ */
+static uint16_t sensor_temperature = 0;
+static uint16_t sensor_hum = 0;
+static uint16_t sensor_lux = 0;
+static int16_t  sensor_adxl[3];
+static int16_t  sensor_hmc5883l[3];
+static uint8_t  sensor_step = 0;
+static uint8_t  sensor_ready = 0;       //已完成至少一轮采样
+
+static uint32_t EDP_SensorTask(void *arg)
+{
+    switch (sensor_step++)
+    {
+        case 0:
+            /*启动温度转换，非保持模式，转换期间不占用I2C总线*/
+            SHT2x_MeasureStart(SHT20_Measurement_T_NHM);
+            return SHT20_T_CONV_MS;
+        case 1:
+            if (SHT2x_MeasureRead(SHT20_Measurement_T_NHM, &sensor_temperature) < 0)
+            {
+                LOG_W(LOG_MOD_SENSOR, "%s %d sht20 temperature not ready", __func__, __LINE__);
+            }
+            SHT2x_MeasureStart(SHT20_Measurement_RH_NHM);
+            return SHT20_RH_CONV_MS;
+        case 2:
+            if (SHT2x_MeasureRead(SHT20_Measurement_RH_NHM, &sensor_hum) < 0)
+            {
+                LOG_W(LOG_MOD_SENSOR, "%s %d sht20 humidity not ready", __func__, __LINE__);
+            }
+            return 400;
+        case 3:
+            /*读取BH1750FVI*/
+            sensor_lux = Read_BH1750();
+            return 400;
+        case 4:
+            /*读取ADXL345，已在EDP_SensorInit中配置为连续测量*/
+            ADXL345_GETXYZ(sensor_adxl);
+            return 400;
+        default:
+            /*读取HMC588CL，已在EDP_SensorInit中配置为连续测量*/
+            HMC5883L_GetXYZ(sensor_hmc5883l);
+            sensor_step = 0;
+            sensor_ready = 1;
+            return EDP_SAMPLE_INTERVAL;
+    }
+}
+
+/*
+ *  @brief  传感器上电配置，启动调度前调用一次；各传感器之后连续测量，采样任务只读结果
+ */
+static void EDP_SensorInit(void)
+{
+    ADXL345_init();
+    HMC5883L_Init();
+    BH1750_Init();
+}
+
+/*
+ *  @brief  EDP协议向Onenet上传最近一次采样的全部传感器数据
+ */
 void Save_AllSensorsToOneNet(void)
 {
     EdpPacket* send_pkg;
-    uint16_t f;
-    uint16_t hum[1], temperature[1];
-    int16_t adxl[3], hmc5883l[3];
-    /*读取温湿度*/
+
     memset(data_string_dst, 0, sizeof(data_string_dst));
-    SHT20_read_user_reg();
-    mDelay(200);//延迟，设备没有那么快的响应时间，否则总线处理忙等
-    SHT2x_MeasureHM(SHT20_Measurement_T_HM, temperature);
-    mDelay(1000);
-    SHT2x_MeasureHM(SHT20_Measurement_RH_HM, hum);
-    mDelay(400);
-    f = (uint16_t)Read_BH1750();
-    snprintf(data_string_t, sizeof(data_string_t), ",;BH1750FVI,%d;SHT20_temperature,%d;SHT20_hum,%d;", (uint16_t)f, (uint16_t)temperature[0], (uint16_t)hum[0]);
-    /*读取BH1750FVI*/
-    printf("%s\n", data_string_t);
-    mDelay(400);
-    /*读取ADXL345*/
-    ADXL345_GETXYZ(adxl);
-    snprintf(data_string_adxl, sizeof(data_string_adxl), "ADXL345_x,0x%x;ADXL345_y,0x%0x;ADXL345_z,0x%x;", (uint16_t)adxl[0], (uint16_t)adxl[1], (uint16_t)adxl[2]);
-    printf("%s\n", data_string_adxl);
-    mDelay(400);
-    /*读取HMC588CL*/
-    HMC5883L_GetXYZ(hmc5883l);
-
-    snprintf(data_string_hmc5883l, sizeof(data_string_hmc5883l), "HMC5883L_x,0x%x;HMC5883L_y,0x%x;HMC5883L_z,0x%x", (uint16_t)hmc5883l[0], (uint16_t)hmc5883l[2], (uint16_t)hmc5883l[1]);
-    printf("%s\n", data_string_hmc5883l);
+    snprintf(data_string_t, sizeof(data_string_t), ",;BH1750FVI,%d;SHT20_temperature,%d;SHT20_hum,%d;", sensor_lux, sensor_temperature, sensor_hum);
+    snprintf(data_string_adxl, sizeof(data_string_adxl), "ADXL345_x,0x%x;ADXL345_y,0x%0x;ADXL345_z,0x%x;", (uint16_t)sensor_adxl[0], (uint16_t)sensor_adxl[1], (uint16_t)sensor_adxl[2]);
+    snprintf(data_string_hmc5883l, sizeof(data_string_hmc5883l), "HMC5883L_x,0x%x;HMC5883L_y,0x%x;HMC5883L_z,0x%x", (uint16_t)sensor_hmc5883l[0], (uint16_t)sensor_hmc5883l[2], (uint16_t)sensor_hmc5883l[1]);
     strcat(data_string_dst, data_string_t);
     strcat(data_string_dst, data_string_adxl);
     strcat(data_string_dst, data_string_hmc5883l);
-    printf("%s\n", data_string_dst);
+    /*日志只保存%s的指针, 缓冲区下次上传会被改写, 所以记录数值而不是拼好的字符串*/
+    LOG_D(LOG_MOD_SENSOR, "upload lux %d t %d hum %d", sensor_lux, sensor_temperature, sensor_hum);
+    LOG_D(LOG_MOD_SENSOR, "upload adxl 0x%x 0x%x 0x%x hmc 0x%x 0x%x 0x%x",
+          (uint16_t)sensor_adxl[0], (uint16_t)sensor_adxl[1], (uint16_t)sensor_adxl[2],
+          (uint16_t)sensor_hmc5883l[0], (uint16_t)sensor_hmc5883l[2], (uint16_t)sensor_hmc5883l[1]);
     send_pkg = PacketSavedataSimpleString(NULL, data_string_dst);
 
-    DoSend(0, (const uint8_t *)send_pkg->_data, send_pkg->_write_pos);
-    DeleteBuffer(&send_pkg);
-    mDelay(1000);
+    DoSendPacket(send_pkg);
+}
+/*
+ *  @brief  命令处理注册表及等待异步响应的命令
+ */
+typedef struct EdpCmdEntry
+{
+    const char    *prefix;
+    uint32_t       prefix_len;
+    EdpCmdHandler  handler;
+} EdpCmdEntry;
+
+static EdpCmdEntry edp_cmd_table[EDP_CMD_HANDLER_MAX];
+static uint32_t    edp_cmd_num = 0;
+static EdpCmdResp  edp_cmd_resp[EDP_CMD_PENDING_MAX];
+
+/* Cortex-M3 DWT周期计数器，用于测量命令从接收到处理、回复的耗时 */
+#define DWT_CTRL        (*(volatile uint32_t *)0xE0001000)
+#define DWT_CYCCNT      (*(volatile uint32_t *)0xE0001004)
+#define CYCLES_TO_US(c) ((c) / (SystemCoreClock / 1000000))
+
+static void EDP_CycleInit(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT_CYCCNT = 0;
+    DWT_CTRL |= 1;
+}
+
+int32_t EDP_RegisterCmd(const char *prefix, EdpCmdHandler handler)
+{
+    if (edp_cmd_num >= EDP_CMD_HANDLER_MAX)
+    {
+        return -1;
+    }
+    edp_cmd_table[edp_cmd_num].prefix = prefix;
+    edp_cmd_table[edp_cmd_num].prefix_len = strlen(prefix);
+    edp_cmd_table[edp_cmd_num].handler = handler;
+    edp_cmd_num++;
+    return 0;
+}
+
+/*
+ *  @brief  CMDRESP发完(DMA完成)后在USART2_TxPoll中调用，释放数据包和响应句柄
+ *          回复耗时从收到命令的数据算到最后一个字节交给串口
+ */
+static void EDP_CmdRespDone(void *arg)
+{
+    EdpCmdResp *resp = (EdpCmdResp *)arg;
+
+    LOG_D(LOG_MOD_EDP, "%s %d cmd resp latency: %d us", __func__, __LINE__,
+          CYCLES_TO_US(USART2_TxDoneCycle() - resp->rcv_cycle));
+    DeleteBuffer(&resp->tx_pkg);
+    resp->in_use = 0;
+}
+
+void EDP_CmdRespond(EdpCmdResp *resp, const char *data, uint32_t len)
+{
+    EdpPacket *send_pkg;
+
+    if (resp == NULL || resp->in_use != 1)
+    {
+        return;
+    }
+    send_pkg = PacketCmdResp(resp->cmdid, resp->cmdid_len, data, len);
+    if (send_pkg == NULL)
+    {
+        resp->in_use = 0;
+        return;
+    }
+    /* 句柄保持占用直到发完，完成回调里用它计算耗时 */
+    resp->tx_pkg = send_pkg;
+    resp->in_use = 2;
+    LOG_HEX(LOG_LEVEL_DEBUG, LOG_MOD_EDP, "send", (const uint8_t *)send_pkg->_data, send_pkg->_write_pos);
+    if (USART2_WriteAsync((const uint8_t *)send_pkg->_data, send_pkg->_write_pos, EDP_CmdRespDone, resp) < 0)
+    {
+        DeleteBuffer(&resp->tx_pkg);
+        resp->in_use = 0;
+    }
 }
+
+/*
+ *  @brief  按命令前缀分发CMDREQ，直接从EDP包中解析，不申请内存
+ *  @param  rcv_cycle: 包所在数据从串口取出时的DWT周期计数
+ */
+static void EDP_DispatchCmd(EdpPacket *pkg, uint32_t rcv_cycle)
+{
+    const char *cmdid;
+    uint16_t cmdid_len;
+    const uint8_t *req;
+    uint32_t req_len;
+    EdpCmdResp *resp = NULL;
+    EdpCmdHandler handler = NULL;
+    uint32_t i;
+    int32_t rtn;
+    uint32_t handle_cycles;
+
+    if (UnpackCmdReqInPlace(pkg, &cmdid, &cmdid_len, &req, &req_len) != 0
+        || cmdid_len > EDP_CMDID_MAX_LEN)
+    {
+        LOG_W(LOG_MOD_EDP, "%s %d bad cmd req", __func__, __LINE__);
+        return;
+    }
+    for (i = 0; i < EDP_CMD_PENDING_MAX; i++)
+    {
+        if (!edp_cmd_resp[i].in_use)
+        {
+            resp = &edp_cmd_resp[i];
+            break;
+        }
+    }
+    if (resp == NULL)
+    {
+        LOG_W(LOG_MOD_EDP, "%s %d too many pending cmds", __func__, __LINE__);
+        return;
+    }
+    memcpy(resp->cmdid, cmdid, cmdid_len);
+    resp->cmdid_len = cmdid_len;
+    resp->rcv_cycle = rcv_cycle;
+    resp->tx_pkg = NULL;
+    resp->in_use = 1;
+
+    for (i = 0; i < edp_cmd_num; i++)
+    {
+        if (req_len >= edp_cmd_table[i].prefix_len
+            && memcmp(req, edp_cmd_table[i].prefix, edp_cmd_table[i].prefix_len) == 0)
+        {
+            handler = edp_cmd_table[i].handler;
+            break;
+        }
+    }
+    if (handler == NULL)
+    {
+        LOG_W(LOG_MOD_EDP, "%s %d unknown cmd, len: %d", __func__, __LINE__, req_len);
+        EDP_CmdRespond(resp, "unknown", 7);
+        return;
+    }
+
+    rtn = handler(resp, req, req_len);
+    handle_cycles = DWT_CYCCNT - rcv_cycle;
+    /* 处理函数未回复时，按处理结果自动回复 */
+    if (rtn != EDP_CMD_ASYNC)
+    {
+        EDP_CmdRespond(resp, rtn < 0 ? "error" : "ok", rtn < 0 ? 5 : 2);
+    }
+    LOG_D(LOG_MOD_EDP, "%s %d cmd handle latency: %d us", __func__, __LINE__, CYCLES_TO_US(handle_cycles));
+}
+
+/*
+ *  @brief  示例命令：原样返回命令内容
+ */
+static int32_t EDP_CmdEcho(EdpCmdResp *resp, const uint8_t *req, uint32_t req_len)
+{
+    EDP_CmdRespond(resp, (const char *)req, req_len);
+    return EDP_CMD_DONE;
+}
+
+/*
+ *  @brief  EDP会话状态，由EDP协议任务驱动，Recv_Thread_Func根据收到的响应更新
+ *          edp_tick为本次运行EDP协议任务时的SysTick毫秒数，用于计算各个超时
+ */
+static EdpState edp_state = EDP_STATE_DISCONNECTED;
+static uint32_t edp_tick = 0;
+static uint32_t edp_state_tick = 0;     //进入当前状态的时间
+static uint32_t edp_traffic_tick = 0;   //最近一次收发EDP包的时间
+static uint32_t edp_upload_tick = 0;    //最近一次上传数据的时间
+static uint32_t edp_ping_tick = 0;      //最近一次发送心跳的时间
+static uint8_t  edp_ping_pending = 0;   //已发送心跳，尚未收到响应
+static uint32_t edp_backoff = EDP_BACKOFF_MIN;     //退避间隔上限，每次失败翻倍
+static uint32_t edp_reconnect_wait = 0;             //本次实际等待的时间，加了随机抖动
+static uint32_t edp_rand = 0;
+
+/* STM32F1的96位芯片唯一ID，用作随机数种子，不同设备的抖动序列不同 */
+#define EDP_UID         ((const volatile uint32_t *)0x1FFFF7E8)
+
+/*
+ *  @brief  xorshift32伪随机数，第一次调用时用芯片ID和DWT周期计数作种子
+ */
+static uint32_t EDP_Random(void)
+{
+    if (edp_rand == 0)
+    {
+        edp_rand = EDP_UID[0] ^ EDP_UID[1] ^ EDP_UID[2] ^ DWT_CYCCNT;
+        if (edp_rand == 0)
+        {
+            edp_rand = 0x2545F491;
+        }
+    }
+    edp_rand ^= edp_rand << 13;
+    edp_rand ^= edp_rand >> 17;
+    edp_rand ^= edp_rand << 5;
+    return edp_rand;
+}
+
+/*
+ *  @brief  在[edp_backoff/2, edp_backoff]中随机取本次重连的等待时间，
+ *          避免服务端故障恢复后所有设备在同一时刻重连
+ */
+static void EDP_BackoffJitter(void)
+{
+    uint32_t half = edp_backoff / 2;
+
+    edp_reconnect_wait = half + EDP_Random() % (edp_backoff - half + 1);
+}
+
+static void EDP_SetState(EdpState state)
+{
+    LOG_I(LOG_MOD_EDP, "%s %d edp state %d -> %d", __func__, __LINE__, edp_state, state);
+    edp_state = state;
+    edp_state_tick = edp_tick;
+}
+
 /*
- *  @brief  EDP协议测试主循环
+ *  @brief  连接失败或断开，回到未连接状态，重连间隔按指数退避
+ */
+static void EDP_Disconnect(void)
+{
+    EDP_SetState(EDP_STATE_DISCONNECTED);
+    edp_ping_pending = 0;
+    edp_backoff <<= 1;
+    if (edp_backoff > EDP_BACKOFF_MAX)
+    {
+        edp_backoff = EDP_BACKOFF_MAX;
+    }
+    EDP_BackoffJitter();
+    LOG_I(LOG_MOD_EDP, "%s %d reconnect in %d ms", __func__, __LINE__, edp_reconnect_wait);
+}
+
+/*
+ *  @brief  收到连接响应，rtn为0表示鉴权成功
+ */
+static void EDP_OnConnResp(int32_t rtn)
+{
+    if (edp_state != EDP_STATE_CONNECTING)
+    {
+        return;
+    }
+    if (rtn == 0)
+    {
+        EDP_SetState(EDP_STATE_CONNECTED);
+        edp_backoff = EDP_BACKOFF_MIN;
+        edp_upload_tick = edp_tick - EDP_UPLOAD_INTERVAL;  //连接成功后立即上传一次
+    }
+    else
+    {
+        EDP_Disconnect();
+    }
+}
+
+/*
+ *  @brief  返回EDP会话当前状态
+ */
+EdpState EDP_GetState(void)
+{
+    return edp_state;
+}
+
+/* 解包/打包时cJSON节点和字符串的arena，double保证8字节对齐 */
+static double edp_json_arena[EDP_JSON_ARENA_SIZE / sizeof(double)];
+
+/*
+ *  @brief  EDP协议任务，每EDP_LOOP_TICK运行一次，有不完整的EDP包时每EDP_RECV_POLL运行一次
+ *  @note   未连接 -> 连接中 -> 已连接 状态机：
+ *          未连接时按退避间隔发送连接请求，连接中超时或鉴权失败则退避重连；
+ *          已连接后按EDP_UPLOAD_INTERVAL上传数据，距离上次通信超过
+ *          EDP_PING_INTERVAL时发送心跳，心跳超时未响应视为断开
+ */
+static uint32_t EDP_ProtocolTask(void *arg)
+{
+    int32_t recv_pending;
+
+    edp_tick = SystickTime_Get();
+    recv_pending = Recv_Thread_Func();
+
+    switch (edp_state)
+    {
+        case EDP_STATE_DISCONNECTED:
+            if (edp_tick - edp_state_tick >= edp_reconnect_wait)
+            {
+                Connect_RequestType1(src_dev, src_api_key);
+                edp_traffic_tick = edp_tick;
+                EDP_SetState(EDP_STATE_CONNECTING);
+            }
+            break;
+        case EDP_STATE_CONNECTING:
+            if (edp_tick - edp_state_tick >= EDP_CONNECT_TIMEOUT)
+            {
+                LOG_W(LOG_MOD_EDP, "%s %d connect resp timeout", __func__, __LINE__);
+                EDP_Disconnect();
+            }
+            break;
+        case EDP_STATE_CONNECTED:
+            if (edp_ping_pending)
+            {
+                if (edp_tick - edp_ping_tick >= EDP_PING_TIMEOUT)
+                {
+                    LOG_W(LOG_MOD_EDP, "%s %d ping resp timeout", __func__, __LINE__);
+                    EDP_Disconnect();
+                    break;
+                }
+            }
+            else if (edp_tick - edp_traffic_tick >= EDP_PING_INTERVAL)
+            {
+                Ping_Server();
+                edp_ping_pending = 1;
+                edp_ping_tick = edp_tick;
+                edp_traffic_tick = edp_tick;
+            }
+            /*还没有采样完成时不上传，等下一个周期*/
+            if (sensor_ready && edp_tick - edp_upload_tick >= EDP_UPLOAD_INTERVAL)
+            {
+                Save_AllSensorsToOneNet();
+                edp_upload_tick = edp_tick;
+                edp_traffic_tick = edp_tick;
+            }
+            break;
+        default:
+            break;
+    }
+    /*EDP包只收到一部分时提前再来，剩余数据到了就能马上处理*/
+    return recv_pending ? EDP_RECV_POLL : EDP_LOOP_TICK;
+}
+
+/*
+ *  @brief  释放已发完的数据包，输出日志
+ */
+static uint32_t EDP_ServiceTask(void *arg)
+{
+    USART2_TxPoll();
+    Log_Poll();
+    return EDP_SERVICE_TICK;
+}
+
+static SchedTask edp_protocol_task;
+static SchedTask edp_sensor_task;
+static SchedTask edp_service_task;
+
+/*
+ *  @brief  EDP协议测试主循环，启动各任务后进入调度，不返回
  */
 void EDP_Loop(void)
 {
+    cJSON_InitArena(edp_json_arena, sizeof(edp_json_arena));
+    EDP_CycleInit();
+    EDP_RegisterCmd("echo", EDP_CmdEcho);
+    EDP_SensorInit();
+
+    edp_tick = SystickTime_Get();
+    /*上电后的第一次连接也加抖动，整批设备同时上电时错开*/
+    edp_state_tick = edp_tick;
+    EDP_BackoffJitter();
+    Sched_Start(&edp_service_task, EDP_ServiceTask, NULL, 0);
+    Sched_Start(&edp_sensor_task, EDP_SensorTask, NULL, 0);
+    /*等待模块就绪后再开始连接*/
+    Sched_Start(&edp_protocol_task, EDP_ProtocolTask, NULL, 2000);
+    Sched_Run();
+}
+
+/*
+ *  @brief  EDP接收上下文，跨越多次Recv_Thread_Func调用保留，
+ *          未收完的EDP包留在其中，等待下一次接收时继续拼接
+ */
+static RecvBuffer *edp_recv_buf = NULL;
+static uint32_t edp_recv_cycle = 0;     //最近一次从串口取出数据时的DWT周期计数，即其中各EDP包收齐的时刻
+
+/*
+ *  @brief  将串口已接收的数据直接追加到EDP接收上下文
+ *  @retval 追加的字节数，<0表示超出EDP_RECV_MAX_LEN或内存不足
+ */
+static int32_t EDP_RecvFill(RecvBuffer *recv_buf)
+{
+    uint32_t rcv_len;
 
-    mDelay(2000);
-    while(1)
+    rcv_len = USART2_GetRcvNum();
+    if (rcv_len == 0)
     {
-        Connect_RequestType1(src_dev, src_api_key);
-        mDelay(1000);
-        mDelay(1000);
-        mDelay(1000);
-        mDelay(1000);
-        printf("%s %d\n", __func__, __LINE__);
-        Recv_Thread_Func();
-        mDelay(1000);
-        mDelay(1000);
-#if 0
-        Ping_Server();
-        printf("%s %d\n", __func__, __LINE__);
-        Recv_Thread_Func();
-        mDelay(1000);
-        Save_TemperatueToOneNet();
-        mDelay(1000);
-        Recv_Thread_Func();
-        mDelay(1000);
-        Save_HumToOneNet();
-        mDelay(1000);
-        Recv_Thread_Func();
-        mDelay(1000);
-        Save_TempHumToOneNet();
-#endif
-        Save_AllSensorsToOneNet();
-        mDelay(1000);
-        Recv_Thread_Func();
-        mDelay(1000);
+        return 0;
+    }
+    if (rcv_len > MAX_RCV_LEN)
+    {
+        rcv_len = MAX_RCV_LEN;
+    }
+    if (recv_buf->_write_pos + rcv_len > EDP_RECV_MAX_LEN
+        || CheckCapacity(recv_buf, rcv_len))
+    {
+        USART2_RcvClear();
+        return -1;
+    }
+    USART2_GetRcvData(recv_buf->_data + recv_buf->_write_pos, rcv_len);
+    edp_recv_cycle = DWT_CYCCNT;
+    LOG_D(LOG_MOD_EDP, "recv from server, bytes: %d", rcv_len);
+    LOG_HEX(LOG_LEVEL_DEBUG, LOG_MOD_EDP, "recv", (const uint8_t *)recv_buf->_data + recv_buf->_write_pos, rcv_len);
+    recv_buf->_write_pos += rcv_len;
+    return rcv_len;
+}
+
+/*
+ *  @brief  清空EDP接收上下文，大包处理完后释放扩展出来的内存
+ */
+static void EDP_RecvReset(void)
+{
+    if (edp_recv_buf != NULL && edp_recv_buf->_capacity > BUFFER_SIZE)
+    {
+        DeleteBuffer(&edp_recv_buf);
+        edp_recv_buf = NewBuffer();
+    }
+    else if (edp_recv_buf != NULL)
+    {
+        edp_recv_buf->_write_pos = 0;
     }
 }
 
 /*
  *  @brief  串口接收处理线程
+ *  @note   只处理串口中已有的数据，不等待；不完整的EDP包保留在edp_recv_buf中，
+ *          下次调用时继续拼接；超过EDP_RECV_MAX_LEN的包直接丢弃
+ *  @retval 1表示有不完整的EDP包等待剩余数据，0表示没有
  */
-void Recv_Thread_Func(void)
+int32_t Recv_Thread_Func(void)
 {
-    int32_t error = 0;
     int32_t rtn;
+    int32_t rcv_len;
+    int32_t pkg_len;
     uint8_t mtype, jsonorbin;
-    uint8_t buffer[128];
-    RecvBuffer *recv_buf = NewBuffer();
     EdpPacket *pkg;
 
     int8_t *src_devid;
@@ -219,191 +659,168 @@ void Recv_Thread_Func(void)
     uint32_t save_binlen;
     int8_t *json_ack;
 
-    int8_t *cmdid;
-    uint16_t cmdid_len;
-    int8_t *cmd_req;
-    uint32_t cmd_req_len;
-    EdpPacket *send_pkg;
     int8_t *ds_id;
     double dValue = 0;
 
     int8_t *simple_str = NULL;
-    int8_t cmd_resp[] = "ok";
-    uint32_t cmd_resp_len = 0;
 
-    printf("\n[%s] recv thread start ...\r\n", __func__);
-
-    while (error == 0)
+    if (edp_recv_buf == NULL && (edp_recv_buf = NewBuffer()) == NULL)
     {
-        /* 试着接收1024个字节的数据 */
-        int32_t rcv_len = 0;
+        return 0;
+    }
 
-        rcv_len = USART2_GetRcvNum();
-        if (rcv_len <= 0)
+    rcv_len = EDP_RecvFill(edp_recv_buf);
+    if (rcv_len < 0)
+    {
+        LOG_W(LOG_MOD_EDP, "%s %d edp packet too large, drop", __func__, __LINE__);
+        EDP_RecvReset();
+        return 0;
+    }
+    /* 没有新数据时，已有的不完整包也拼不出新的EDP包 */
+    if (rcv_len == 0)
+    {
+        return edp_recv_buf->_write_pos > 0;
+    }
+    while (1)
+    {
+        /* 获取一个完成的EDP包 */
+        if ((pkg = GetEdpPacket(edp_recv_buf)) == 0)
         {
-            printf("%s %d No Data\n", __func__, __LINE__);
+            LOG_D(LOG_MOD_EDP, "need more bytes");
             break;
         }
-				mDelay(50);
-				rcv_len = USART2_GetRcvNum();
-        USART2_GetRcvData(buffer, rcv_len);
-        printf("recv from server, bytes: %d\r\n", rcv_len);
-        /* wululu test print send bytes */
-        hexdump((const uint8_t *)buffer, rcv_len);
-        printf("\n");
-        /* 成功接收了n个字节的数据 */
-        WriteBytes(recv_buf, buffer, rcv_len);
-        while (1)
+        edp_traffic_tick = edp_tick;
+        /* 获取这个EDP包的消息类型 */
+        mtype = EdpPacketType(pkg);
+        LOG_D(LOG_MOD_EDP, "mtype=%d", mtype);
+        /* 根据这个EDP包的消息类型, 分别做EDP包解析 */
+        switch (mtype)
         {
-            /* 获取一个完成的EDP包 */
-            if ((pkg = GetEdpPacket(recv_buf)) == 0)
-            {
-                printf("need more bytes...\n");
+            case CONNRESP:
+                /* 解析EDP包 - 连接响应 */
+                rtn = UnpackConnectResp(pkg);
+                LOG_I(LOG_MOD_EDP, "recv connect resp, rtn: %d", rtn);
+                EDP_OnConnResp(rtn);
                 break;
-            }
-            /* 获取这个EDP包的消息类型 */
-            mtype = EdpPacketType(pkg);
-            printf("mtype=%d\n", mtype);
-            /* 根据这个EDP包的消息类型, 分别做EDP包解析 */
-            switch (mtype)
-            {
-                case CONNRESP:
-                    /* 解析EDP包 - 连接响应 */
-                    rtn = UnpackConnectResp(pkg);
-                    printf("recv connect resp, rtn: %d\n", rtn);
-                    break;
-                case PUSHDATA:
-                    /* 解析EDP包 - 数据转发 */
-                    UnpackPushdata(pkg, &src_devid, &push_data,
-                                   &push_datalen);
-                    printf
-                    ("recv push data, src_devid: %s, push_data: %s, len: %d\n",
-                     src_devid, push_data, push_datalen);
-                    free(src_devid);
-                    free(push_data);
-                    break;
-                case SAVEDATA:
-                    /* 解析EDP包 - 数据存储 */
-                    if (UnpackSavedata(pkg, &src_devid, &jsonorbin)
-                        == 0)
-                    {
-                        if (jsonorbin == kTypeFullJson
-                            || jsonorbin ==
-                            kTypeSimpleJsonWithoutTime
-                            || jsonorbin ==
-                            kTypeSimpleJsonWithTime)
-                        {
-                            printf("json type is %d\n",
-                                   jsonorbin);
-                            /* 解析EDP包 - json数据存储 */
-                            /* UnpackSavedataJson(pkg, &save_json); */
-                            /* save_json_str=cJSON_Print(save_json); */
-                            /* printf("recv save data json, src_devid: %s, json: %s\n", */
-                            /*     src_devid, save_json_str); */
-                            /* free(save_json_str); */
-                            /* cJSON_Delete(save_json); */
-
-                            /* UnpackSavedataInt(jsonorbin, pkg, &ds_id, &iValue); */
-                            /* printf("ds_id = %s\nvalue= %d\n", ds_id, iValue); */
-
-                            UnpackSavedataDouble(jsonorbin,
-                                                 pkg,
-                                                 &ds_id,
-                                                 &dValue);
-                            printf
-                            ("ds_id = %s\nvalue = %f\n",
-                             ds_id, dValue);
-
-                            /* UnpackSavedataString(jsonorbin, pkg, &ds_id, &cValue); */
-                            /* printf("ds_id = %s\nvalue = %s\n", ds_id, cValue); */
-                            /* free(cValue); */
-                            free(ds_id);
-                        }
-                        else if (jsonorbin == kTypeBin)     /* 解析EDP包 - bin数据存储 */
-                        {
-                            UnpackSavedataBin(pkg,
-                                              &desc_json,
-                                              (uint8_t **) &
-                                              save_bin,
-                                              &save_binlen);
-                            desc_json_str =
-                                cJSON_Print(desc_json);
-                            printf
-                            ("recv save data bin, src_devid: %s, desc json: %s, bin: %s, binlen: %d\n",
-                             src_devid, desc_json_str,
-                             save_bin, save_binlen);
-                            free(desc_json_str);
-                            cJSON_Delete(desc_json);
-                            free(save_bin);
-                        }
-                        else if (jsonorbin == kTypeString)
-                        {
-                            UnpackSavedataSimpleString(pkg,
-                                                       &simple_str);
-                            printf("%s\n", simple_str);
-                            free(simple_str);
-                        }
-                        free(src_devid);
-                    }
-                    else
+            case PUSHDATA:
+                /* 解析EDP包 - 数据转发 */
+                UnpackPushdata(pkg, &src_devid, &push_data,
+                               &push_datalen);
+                LOG_I(LOG_MOD_EDP, "recv push data, len: %d", push_datalen);
+                LOG_HEX(LOG_LEVEL_DEBUG, LOG_MOD_EDP, "push data", (const uint8_t *)push_data, push_datalen);
+                free(src_devid);
+                free(push_data);
+                break;
+            case SAVEDATA:
+                /* 解析EDP包 - 数据存储 */
+                if (UnpackSavedata(pkg, &src_devid, &jsonorbin)
+                    == 0)
+                {
+                    if (jsonorbin == kTypeFullJson
+                        || jsonorbin ==
+                        kTypeSimpleJsonWithoutTime
+                        || jsonorbin ==
+                        kTypeSimpleJsonWithTime)
                     {
-                        printf("error\n");
+                        LOG_D(LOG_MOD_EDP, "json type is %d", jsonorbin);
+                        /* 解析EDP包 - json数据存储 */
+                        /* UnpackSavedataJson(pkg, &save_json); */
+                        /* save_json_str=cJSON_Print(save_json); */
+                        /* printf("recv save data json, src_devid: %s, json: %s\n", */
+                        /*     src_devid, save_json_str); */
+                        /* free(save_json_str); */
+                        /* cJSON_Delete(save_json); */
+
+                        /* UnpackSavedataInt(jsonorbin, pkg, &ds_id, &iValue); */
+                        /* printf("ds_id = %s\nvalue= %d\n", ds_id, iValue); */
+
+                        UnpackSavedataDouble(jsonorbin,
+                                             pkg,
+                                             &ds_id,
+                                             &dValue);
+                        LOG_I(LOG_MOD_EDP, "recv save data, value = %f", dValue);
+                        LOG_HEX(LOG_LEVEL_DEBUG, LOG_MOD_EDP, "ds_id", (const uint8_t *)ds_id, strlen((const char *)ds_id));
+
+                        /* UnpackSavedataString(jsonorbin, pkg, &ds_id, &cValue); */
+                        /* printf("ds_id = %s\nvalue = %s\n", ds_id, cValue); */
+                        /* free(cValue); */
+                        free(ds_id);
                     }
-                    break;
-                case SAVEACK:
-                    json_ack = NULL;
-                    UnpackSavedataAck(pkg, &json_ack);
-                    printf("save json ack = %s\n", json_ack);
-                    free(json_ack);
-                    break;
-                case CMDREQ:
-                    if (UnpackCmdReq
-                        (pkg, &cmdid, &cmdid_len, &cmd_req,
-                         &cmd_req_len) == 0)
+                    else if (jsonorbin == kTypeBin)     /* 解析EDP包 - bin数据存储 */
                     {
-                        /*
-                         * 用户按照自己的需求处理并返回，响应消息体可以为空，此处假设返回2个字符"ok"。
-                         * 处理完后需要释放
-                         */
-                        cmd_resp_len = strlen(cmd_resp);
-                        send_pkg =
-                            PacketCmdResp(cmdid, cmdid_len,
-                                          cmd_resp,
-                                          cmd_resp_len);
-#ifdef _ENCRYPT
-                        if (g_is_encrypt)
+                        UnpackSavedataBin(pkg,
+                                          &desc_json,
+                                          (uint8_t **) &
+                                          save_bin,
+                                          &save_binlen);
+                        LOG_I(LOG_MOD_EDP, "recv save data bin, binlen: %d", save_binlen);
+                        if (LOG_ON(LOG_LEVEL_DEBUG, LOG_MOD_EDP))
                         {
-                            SymmEncrypt(send_pkg);
+                            desc_json_str = cJSON_PrintUnformatted(desc_json);
+                            if (desc_json_str != NULL)
+                            {
+                                LOG_HEX(LOG_LEVEL_DEBUG, LOG_MOD_EDP, "desc json", (const uint8_t *)desc_json_str, strlen((const char *)desc_json_str));
+                                free(desc_json_str);
+                            }
                         }
-#endif
-                        DoSend(0, (const uint8_t *)
-                               send_pkg->_data,
-                               send_pkg->_write_pos);
-                        DeleteBuffer(&send_pkg);
-
-                        free(cmdid);
-                        free(cmd_req);
+                        cJSON_Delete(desc_json);
+                        free(save_bin);
                     }
-                    break;
-                case PINGRESP:
-                    /* 解析EDP包 - 心跳响应 */
-                    UnpackPingResp(pkg);
-                    printf("recv ping resp\n");
-                    break;
-                default:
-                    /* 未知消息类型 */
-                    error = 1;
-                    printf("recv failed...\n");
-                    break;
-            }
-            DeleteBuffer(&pkg);
+                    else if (jsonorbin == kTypeString)
+                    {
+                        UnpackSavedataSimpleString(pkg,
+                                                   &simple_str);
+                        LOG_HEX(LOG_LEVEL_DEBUG, LOG_MOD_EDP, "simple string", (const uint8_t *)simple_str, strlen((const char *)simple_str));
+                        free(simple_str);
+                    }
+                    free(src_devid);
+                }
+                else
+                {
+                    LOG_W(LOG_MOD_EDP, "%s %d bad save data", __func__, __LINE__);
+                }
+                break;
+            case SAVEACK:
+                json_ack = NULL;
+                UnpackSavedataAck(pkg, &json_ack);
+                if (json_ack != NULL)
+                {
+                    LOG_HEX(LOG_LEVEL_DEBUG, LOG_MOD_EDP, "save ack", (const uint8_t *)json_ack, strlen((const char *)json_ack));
+                }
+                free(json_ack);
+                break;
+            case CMDREQ:
+                /* 解析EDP包 - 命令请求，按命令前缀分发给注册的处理函数 */
+                EDP_DispatchCmd(pkg, edp_recv_cycle);
+                break;
+            case PINGRESP:
+                /* 解析EDP包 - 心跳响应 */
+                UnpackPingResp(pkg);
+                LOG_D(LOG_MOD_EDP, "recv ping resp");
+                edp_ping_pending = 0;
+                break;
+            default:
+                /* 未知消息类型 */
+                LOG_W(LOG_MOD_EDP, "%s %d unknown mtype %d", __func__, __LINE__, mtype);
+                break;
         }
+        DeleteBuffer(&pkg);
     }
-    DeleteBuffer(&recv_buf);
-
-#ifdef _DEBUG
-    printf("[%s] recv thread end ...\n", __func__);
-#endif
+    if (edp_recv_buf->_write_pos == 0)
+    {
+        /* 所有EDP包已处理完 */
+        EDP_RecvReset();
+        return 0;
+    }
+    pkg_len = GetPkgTotalLen(edp_recv_buf);
+    if (pkg_len < 0 || pkg_len > EDP_RECV_MAX_LEN)
+    {
+        LOG_W(LOG_MOD_EDP, "%s %d bad edp packet len %d, drop", __func__, __LINE__, pkg_len);
+        EDP_RecvReset();
+        return 0;
+    }
+    /* EDP包不完整，下次调用时继续拼接 */
+    return 1;
 }
 
 void Connect_RequestType1(int8_t *devid, int8_t *api_key)
@@ -419,11 +836,8 @@ void Connect_RequestType1(int8_t *devid, int8_t *api_key)
     /* send_pkg = PacketConnect2("433223", "{ \"13982031959\" : \"888888\" }"); */
 
     /* 向设备云发送连接请求 */
-    printf("send connect to server, bytes: %d\n", send_pkg->_write_pos);
-    DoSend(0, (const uint8_t *)send_pkg->_data, send_pkg->_write_pos);
-    /* 必须释放这个内存，否则造成泄露 */
-    DeleteBuffer(&send_pkg);
-    mDelay(1000);
+    LOG_I(LOG_MOD_EDP, "send connect to server, bytes: %d", send_pkg->_write_pos);
+    DoSendPacket(send_pkg);
 }
 /*
  *  @brief  发送PING包维持心跳
@@ -431,14 +845,9 @@ void Connect_RequestType1(int8_t *devid, int8_t *api_key)
 void Ping_Server(void)
 {
     EdpPacket *send_pkg;
-    printf("%s %d\n", __func__, __LINE__);
+    LOG_D(LOG_MOD_EDP, "%s %d", __func__, __LINE__);
     /* 组装ping包 */
     send_pkg = PacketPing();
 
-    DoSend(0, (const uint8_t *)send_pkg->_data,
-           send_pkg->_write_pos);
-    mDelay(500);
-    /* 必须释放这个内存，否则造成泄露 */
-    DeleteBuffer(&send_pkg);
-    mDelay(100);
+    DoSendPacket(send_pkg);
 }
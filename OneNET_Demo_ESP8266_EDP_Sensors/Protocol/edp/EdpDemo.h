@@ -28,6 +28,58 @@
 #define ERR_TIMEOUT         -5
 #define ERR_RECV            -6
 
+/*----------------------------接收配置---------------------------------------*/
+#define EDP_RECV_MAX_LEN    2048    //单个EDP包最大长度，超过的包直接丢弃
+#define EDP_RECV_POLL       10      //EDP包不完整时，检查剩余数据的间隔(ms)
+#define EDP_JSON_ARENA_SIZE 1024    //cJSON文档节点和字符串使用的arena大小，不够时退回到堆
+
+/*----------------------------会话配置---------------------------------------*/
+#define EDP_LOOP_TICK       100     //EDP协议任务的运行周期(ms)
+#define EDP_SERVICE_TICK    10      //释放已发完的数据包、输出日志的周期(ms)
+#define EDP_SAMPLE_INTERVAL 5000    //传感器采样周期(ms)，采样分步进行，不阻塞其他任务
+#define EDP_CONNECT_TIMEOUT 5000    //等待连接响应的最长时间(ms)
+#define EDP_PING_INTERVAL   60000   //距离上次通信超过该时间则发送心跳(ms)，需小于连接包中的保活时间128s
+#define EDP_PING_TIMEOUT    10000   //等待心跳响应的最长时间(ms)
+#define EDP_UPLOAD_INTERVAL 10000   //已连接状态下上传传感器数据的周期(ms)
+#define EDP_BACKOFF_MIN     1000    //重连退避的初始间隔(ms)，实际等待在[间隔/2, 间隔]中随机取
+#define EDP_BACKOFF_MAX     64000   //重连退避的最大间隔(ms)
+
+/* EDP会话状态 */
+typedef enum
+{
+    EDP_STATE_DISCONNECTED = 0,     //未连接，等待退避时间后发送连接请求
+    EDP_STATE_CONNECTING,           //已发送连接请求，等待连接响应
+    EDP_STATE_CONNECTED             //鉴权成功，可以上传数据
+} EdpState;
+
+/*----------------------------命令处理---------------------------------------*/
+#define EDP_CMD_HANDLER_MAX 8       //可注册的命令处理函数个数
+#define EDP_CMD_PENDING_MAX 4       //同时等待异步响应的命令个数
+#define EDP_CMDID_MAX_LEN   40      //cmdid最大长度，平台下发的cmdid为36字节的uuid
+
+/* 命令处理函数的返回值 */
+#define EDP_CMD_DONE        0       //处理完成，若处理函数未响应则自动回复"ok"
+#define EDP_CMD_ASYNC       1       //稍后通过EDP_CmdRespond回复，响应句柄保持有效
+
+/* 命令响应句柄，保存cmdid，用于立即或稍后回复CMDRESP */
+typedef struct EdpCmdResp
+{
+    char       cmdid[EDP_CMDID_MAX_LEN];
+    uint16_t   cmdid_len;
+    uint32_t   rcv_cycle;           //命令所在数据从串口取出时的DWT周期计数
+    EdpPacket *tx_pkg;              //正在发送的CMDRESP，发完后释放，句柄随之空闲
+    uint8_t    in_use;
+} EdpCmdResp;
+
+/*
+ *  @brief  命令处理函数
+ *  @param  resp: 响应句柄，返回EDP_CMD_ASYNC时可在之后使用
+ *  @param  req: 命令内容，直接指向EDP包内的数据，不以\0结尾，仅在处理函数内有效
+ *  @param  req_len: 命令内容长度
+ *  @retval EDP_CMD_DONE, EDP_CMD_ASYNC, <0表示处理失败，自动回复"error"
+ */
+typedef int32_t (*EdpCmdHandler)(EdpCmdResp *resp, const uint8_t *req, uint32_t req_len);
+
 /**
  * @brief  EDP登录连接，采用协议中第一种方式登录连接，鉴权信息为deviceid和api key
  * @param  api_key: 该设备的api key或项目master key
@@ -45,6 +97,13 @@ void Connect_RequestType1(int8_t *devid, int8_t *api_key);
  **/
 int32_t DoSend(int32_t sockfd, const uint8_t *buffer, uint32_t len);
 
+/**
+ * @brief  EDP数据包非阻塞发送, 交给USART2的DMA发送队列后立即返回
+ * @param  pkg: 要发送的数据包, 发完后自动释放, 调用后不能再使用
+ * @retval 发送的数据长度, 失败返回-1(数据包已释放)
+ **/
+int32_t DoSendPacket(EdpPacket *pkg);
+
 /*
  *  @brief  EDP协议向自己透传数据，用于测试，将src_dev替换成目标DEVICE ID即可
  */
@@ -63,15 +122,29 @@ void Save_HumToOneNet(void);
  */
 void Save_TempHumToOneNet(void);
 /*
- *  @brief  EDP协议测试主循环
+ *  @brief  EDP协议测试主循环，启动EDP、传感器采样等任务后进入调度，不返回
  */
 void EDP_Loop(void);
 /*
- *  @brief  串口接收处理线程
+ *  @brief  返回EDP会话当前状态
+ */
+EdpState EDP_GetState(void);
+/*
+ *  @brief  串口接收处理线程，只处理已收到的数据，不等待
+ *  @retval 1表示有不完整的EDP包等待剩余数据，0表示没有
  */
-void Recv_Thread_Func(void);
+int32_t Recv_Thread_Func(void);
 /*
  *  @brief  发送PING包维持心跳
  */
 void Ping_Server(void);
+/*
+ *  @brief  注册命令处理函数，命令内容以prefix开头时调用handler
+ *  @retval 0成功，-1注册表已满
+ */
+int32_t EDP_RegisterCmd(const char *prefix, EdpCmdHandler handler);
+/*
+ *  @brief  回复命令响应，回复后响应句柄失效
+ */
+void EDP_CmdRespond(EdpCmdResp *resp, const char *data, uint32_t len);
 #endif
@@ -3,6 +3,7 @@
 #include <string.h>
 #include <time.h>
 #include "EdpKit.h"
+#include "cJSON_Sax.h"
 
 void my_assert(int a)
 {
@@ -128,143 +129,6 @@ void my_assert(int a)
     return pkg;                         \
 }
 
-#define MKFUN_UNPACK_SAVE_DATA(TYPE, NAME)              \
-    int32_t UnpackSavedata##NAME(SaveDataType type,         \
-                 EdpPacket* pkg,            \
-                 char** ds_id,              \
-                 TYPE* value)               \
-    {                                   \
-    int32_t ret = -1;                           \
-    switch (type){                          \
-    case kTypeFullJson:                         \
-    ret = UnpackSavedataType1##NAME(pkg, ds_id, value);     \
-    break;                              \
-    case kTypeSimpleJsonWithoutTime:                    \
-    ret = UnpackSavedataType2##NAME(pkg, ds_id, value);     \
-    break;                              \
-    case kTypeSimpleJsonWithTime:                   \
-    ret = UnpackSavedataType3##NAME(pkg, ds_id, value);     \
-    break;                              \
-    default:                                \
-    break;                              \
-    }                                   \
-                                    \
-    return ret;                             \
-}
-
-#define MKFUN_UNPACK_SAVE_DATA_TYPE1(TYPE, NAME, MED)           \
-    static int32_t UnpackSavedataType1##NAME(EdpPacket* pkg,        \
-                         char** ds_id,      \
-                         TYPE* value)       \
-    {                                   \
-    cJSON* json_obj = NULL;                     \
-    cJSON* ds_array = NULL;                     \
-    cJSON* ds_item = NULL;                      \
-    char* id = NULL;                            \
-    cJSON* dp_array = NULL;                     \
-    cJSON* dp_item = NULL;                      \
-    char* valuestring = NULL;                       \
-                                    \
-    if(0 != UnpackSavedataJson(pkg, &json_obj))             \
-    return ERR_UNPACK_SAVED_JSON;                   \
-                                    \
-    ds_array = cJSON_GetObjectItem(json_obj, "datastreams");        \
-    if((0 == ds_array) || (1 != cJSON_GetArraySize(ds_array)))      \
-    return ERR_UNPACK_SAVED_JSON;                   \
-                                    \
-    ds_item = cJSON_GetArrayItem(ds_array, 0);              \
-    if(0 == ds_item)                            \
-    return ERR_UNPACK_SAVED_JSON;                   \
-                                    \
-    id = cJSON_GetObjectItem(ds_item, "id")->valuestring;       \
-    *ds_id = (char*)malloc(strlen(id)+1);               \
-    memcpy((char*)(*ds_id), id, strlen(id)+1);              \
-                                        \
-    dp_array = cJSON_GetObjectItem(ds_item, "datapoints");      \
-    if((0 == dp_array) || (1 != cJSON_GetArraySize(dp_array)))      \
-    return ERR_UNPACK_SAVED_JSON;                   \
-                                    \
-    dp_item = cJSON_GetArrayItem(dp_array, 0);              \
-
-
-#define UNPACK_SAVE_DATA_TYPE1_END_STRING               \
-    valuestring = cJSON_GetObjectItem(dp_item, "value")->valuestring;   \
-    *value = (char*)malloc(strlen(valuestring)+1);          \
-    memcpy((char*)(*value), valuestring, strlen(valuestring)+1);    \
-    cJSON_Delete(json_obj);                     \
-    return 0;                               \
-}
-
-#define UNPACK_SAVE_DATA_TYPE1_END_NUMBER(TYPE)         \
-    *value = cJSON_GetObjectItem(dp_item, "value")->value##TYPE;    \
-    cJSON_Delete(json_obj);                     \
-    return 0;                               \
-}
-
-#define MKFUN_UNPACK_SAVE_DATA_TYPE2(TYPE, NAME, MED)           \
-    static int32_t UnpackSavedataType2##NAME(EdpPacket* pkg,        \
-                          char** ds_id,     \
-                          TYPE* value)      \
-    {                                   \
-        cJSON* json_obj = NULL;                     \
-    cJSON* json_child = NULL;                   \
-    size_t len = 0;                         \
-    char* valuestring = NULL;                   \
-                                    \
-    if(0 != UnpackSavedataJson(pkg, &json_obj))         \
-        return ERR_UNPACK_SAVED_JSON;               \
-    if (!json_obj->child){                      \
-        cJSON_Delete(json_obj);                 \
-        return ERR_UNPACK_SAVED_JSON;               \
-    }                               \
-    json_child = json_obj->child;                   \
-    len = strlen(json_child->string) + 1;               \
-    *ds_id = (char*)malloc(len);                    \
-    memcpy((char*)(*ds_id), json_child->string, len);       \
-
-#define UNPACK_SAVE_DATA_TYPE23_END_NUMBER(TYPE)            \
-    *value = json_child->value##TYPE;                   \
-    cJSON_Delete(json_obj);                     \
-    return 0;                               \
-}
-
-#define UNPACK_SAVE_DATA_TYPE23_END_STRING()                \
-    valuestring = json_child->valuestring;              \
-    *value = (char*)malloc(strlen(valuestring)+1);          \
-    memcpy((char*)(*value), valuestring, strlen(valuestring)+1);    \
-    cJSON_Delete(json_obj);                     \
-    return 0;                               \
-}
-
-#define MKFUN_UNPACK_SAVE_DATA_TYPE3(TYPE, NAME, MED)           \
-    static int32_t UnpackSavedataType3##NAME(EdpPacket* pkg,        \
-                          char** ds_id,     \
-                          TYPE* value)      \
-{                                   \
-        cJSON* json_obj = NULL;                     \
-    cJSON* json_child = NULL;                   \
-    char* valuestring = NULL;                   \
-    size_t len = 0;                         \
-                                    \
-    if(0 != UnpackSavedataJson(pkg, &json_obj))         \
-        return ERR_UNPACK_SAVED_JSON;               \
-                                    \
-    json_child = json_obj->child;                   \
-    if (!json_child || !json_child->string){            \
-        cJSON_Delete(json_obj);                 \
-        return ERR_UNPACK_SAVED_JSON;               \
-    }                               \
-                                    \
-    len = strlen(json_child->string) + 1;               \
-    *ds_id = (char*)malloc(len);                    \
-    memcpy(*ds_id, json_child->string, len);            \
-                                    \
-    json_child = json_child->child;                 \
-    if (!json_child){                       \
-        cJSON_Delete(json_obj);                 \
-        return ERR_UNPACK_SAVED_JSON;               \
-    }                               \
-
 static void FormatAt(char* buffer, int32_t len, time_t now)
 {
 #if 0
@@ -286,13 +150,17 @@ static void FormatAt(char* buffer, int32_t len, time_t now)
 
 /*---------------------------------------------------------------------------*/
 Buffer* NewBuffer()
+{
+    return NewBufferSize(BUFFER_SIZE);
+}
+Buffer* NewBufferSize(uint32_t size)
 {
     Buffer* buf = (Buffer*)malloc(sizeof(Buffer));
     if(buf == NULL)
     {
         return NULL;
     }
-    buf->_data = (uint8_t*)malloc(sizeof(uint8_t) * BUFFER_SIZE);
+    buf->_data = (uint8_t*)malloc(sizeof(uint8_t) * size);
     if(buf->_data == NULL)
     {
         printf("%s %d NewBuffer failed\n", __func__, __LINE__);
@@ -302,7 +170,7 @@ Buffer* NewBuffer()
     }
     buf->_write_pos = 0;
     buf->_read_pos = 0;
-    buf->_capacity = BUFFER_SIZE;
+    buf->_capacity = size;
     return buf;
 }
 void DeleteBuffer(Buffer** buf)
@@ -347,7 +215,7 @@ int32_t ReadByte(EdpPacket* pkg, uint8_t* val)
 }
 int32_t ReadBytes(EdpPacket* pkg, uint8_t** val, uint32_t count)
 {
-    if (pkg->_read_pos + count > pkg->_write_pos)
+    if (count > pkg->_write_pos - pkg->_read_pos)
         return -1;
     *val = (uint8_t*)malloc(sizeof(uint8_t) * count);
     memcpy(*val, pkg->_data + pkg->_read_pos, count);
@@ -444,16 +312,22 @@ int32_t WriteBytes(Buffer* buf, const void* bytes, uint32_t count)
 int32_t WriteUint16(Buffer* buf, uint16_t val)
 {
     my_assert(buf->_read_pos == 0);
-    return WriteByte(buf, MOSQ_MSB(val))
-           || WriteByte(buf, MOSQ_LSB(val));
+    if (CheckCapacity(buf, 2))
+        return -1;
+    buf->_data[buf->_write_pos++] = MOSQ_MSB(val);
+    buf->_data[buf->_write_pos++] = MOSQ_LSB(val);
+    return 0;
 }
 int32_t WriteUint32(Buffer* buf, uint32_t val)
 {
     my_assert(buf->_read_pos == 0);
-    return WriteByte(buf, (val >> 24) & 0x00FF)
-           || WriteByte(buf, (val >> 16) & 0x00FF)
-           || WriteByte(buf, (val >> 8) & 0x00FF)
-           || WriteByte(buf, (val) & 0x00FF);
+    if (CheckCapacity(buf, 4))
+        return -1;
+    buf->_data[buf->_write_pos++] = (val >> 24) & 0x00FF;
+    buf->_data[buf->_write_pos++] = (val >> 16) & 0x00FF;
+    buf->_data[buf->_write_pos++] = (val >> 8) & 0x00FF;
+    buf->_data[buf->_write_pos++] = (val) & 0x00FF;
+    return 0;
 }
 int32_t WriteStr(Buffer* buf, const char *str)
 {
@@ -488,33 +362,108 @@ int32_t WriteRemainlen(Buffer* buf, uint32_t len_val)
     return 0;
 }
 /*---------------------------------------------------------------------------*/
+/*
+ * 以下Put*系列只供本文件的打包函数使用:
+ * 包由NewPacket按最终长度一次申请好, 字段写入时不再做容量检查
+ */
+/* remainlen编码后占用的字节数 */
+static uint32_t RemainlenSize(uint32_t len_val)
+{
+    uint32_t len_len = 1;
+
+    while (len_val > 127)
+    {
+        len_val = len_val / 128;
+        len_len++;
+    }
+    return len_len;
+}
+/*
+ * 申请恰好 1 + len(remainlen) + remainlen 字节的包, 并写入消息类型和剩余长度
+ * tail为包尾之外额外多留的字节, 供cJSON_PrintToBuffer写结尾的'\0'
+ */
+static EdpPacket* NewPacketTail(uint8_t msg_type, uint32_t remainlen, uint32_t tail)
+{
+    EdpPacket* pkg = NULL;
+
+    pkg = NewBufferSize(1 + RemainlenSize(remainlen) + remainlen + tail);
+    if (pkg == NULL)
+        return NULL;
+    pkg->_data[pkg->_write_pos++] = msg_type;
+    WriteRemainlen(pkg, remainlen);
+    return pkg;
+}
+static EdpPacket* NewPacket(uint8_t msg_type, uint32_t remainlen)
+{
+    return NewPacketTail(msg_type, remainlen, 0);
+}
+static void PutByte(EdpPacket* pkg, uint8_t byte)
+{
+    pkg->_data[pkg->_write_pos++] = byte;
+}
+static void PutUint16(EdpPacket* pkg, uint16_t val)
+{
+    pkg->_data[pkg->_write_pos++] = MOSQ_MSB(val);
+    pkg->_data[pkg->_write_pos++] = MOSQ_LSB(val);
+}
+static void PutUint32(EdpPacket* pkg, uint32_t val)
+{
+    pkg->_data[pkg->_write_pos++] = (val >> 24) & 0x00FF;
+    pkg->_data[pkg->_write_pos++] = (val >> 16) & 0x00FF;
+    pkg->_data[pkg->_write_pos++] = (val >> 8) & 0x00FF;
+    pkg->_data[pkg->_write_pos++] = (val) & 0x00FF;
+}
+static void PutBytes(EdpPacket* pkg, const void* bytes, uint32_t count)
+{
+    memcpy(pkg->_data + pkg->_write_pos, bytes, count);
+    pkg->_write_pos += count;
+}
+/* str_len由调用者在计算remainlen时已经求出, 这里不再重复strlen */
+static void PutStr(EdpPacket* pkg, const char* str, uint16_t str_len)
+{
+    PutUint16(pkg, str_len);
+    PutBytes(pkg, str, str_len);
+}
+/*
+ * json_len为cJSON_PrintToBuffer(json, NULL, 0, 1)量出的长度,
+ * json直接打印进包内, 其后至少要留1字节给'\0'(会被后续字段覆盖或落在tail里)
+ */
+static int PutJson(EdpPacket* pkg, cJSON* json, uint16_t json_len)
+{
+    PutUint16(pkg, json_len);
+    if (cJSON_PrintToBuffer(json, (char*)pkg->_data + pkg->_write_pos, json_len + 1, 1) != json_len)
+        return -1;
+    pkg->_write_pos += json_len;
+    return 0;
+}
+/*---------------------------------------------------------------------------*/
 /* connect1 (C->S): devid + apikey */
 EdpPacket* PacketConnect1(const char* devid, const char* auth_key)
 {
     uint32_t remainlen;
-    EdpPacket* pkg = NewBuffer();
+    uint16_t devid_len = strlen(devid);
+    uint16_t key_len = strlen(auth_key);
+    EdpPacket* pkg = NULL;
+
+    /* msg type + remain len */
+    remainlen = (2 + 3) + 1 + 1 + 2 + (2 + devid_len) + (2 + key_len);
+    pkg = NewPacket(CONNREQ, remainlen);
     if(pkg == NULL)
     {
         return NULL;
     }
-
-    /* msg type */
-    WriteByte(pkg, CONNREQ);
-    /* remain len */
-    remainlen = (2 + 3) + 1 + 1 + 2 + (2 + strlen(devid)) + (2 + strlen(auth_key));
-    WriteRemainlen(pkg, remainlen);
     /* protocol desc */
-    WriteStr(pkg, PROTOCOL_NAME);
+    PutStr(pkg, PROTOCOL_NAME, 3);
     /* protocol version */
-    WriteByte(pkg, PROTOCOL_VERSION);
+    PutByte(pkg, PROTOCOL_VERSION);
     /* connect flag */
-    WriteByte(pkg, 0x40);
+    PutByte(pkg, 0x40);
     /* keep time */
-    WriteUint16(pkg, 0x0080);
+    PutUint16(pkg, 0x0080);
     /* DEVID */
-    WriteStr(pkg, devid);
+    PutStr(pkg, devid, devid_len);
     /* auth key */
-    WriteStr(pkg, auth_key);
+    PutStr(pkg, auth_key, key_len);
     return pkg;
 }
 /* connect2 (C->S): userid + auth_info */
@@ -522,28 +471,29 @@ EdpPacket* PacketConnect2(const char* userid, const char* auth_info)
 {
     EdpPacket* pkg = NULL;
     uint32_t remainlen;
+    uint16_t userid_len = strlen(userid);
+    uint16_t info_len = strlen(auth_info);
 
-    pkg = NewBuffer();
-    /* msg type */
-    WriteByte(pkg, CONNREQ);
-    /* remain len */
-    remainlen = (2 + 3) + 1 + 1 + 2 + 2 + (2 + strlen(userid)) + (2 + strlen(auth_info));
-    WriteRemainlen(pkg, remainlen);
+    /* msg type + remain len */
+    remainlen = (2 + 3) + 1 + 1 + 2 + 2 + (2 + userid_len) + (2 + info_len);
+    pkg = NewPacket(CONNREQ, remainlen);
+    if (pkg == NULL)
+        return NULL;
     /* protocol desc */
-    WriteStr(pkg, PROTOCOL_NAME);
+    PutStr(pkg, PROTOCOL_NAME, 3);
     /* protocol version */
-    WriteByte(pkg, PROTOCOL_VERSION);
+    PutByte(pkg, PROTOCOL_VERSION);
     /* connect flag */
-    WriteByte(pkg, 0xC0);
+    PutByte(pkg, 0xC0);
     /* keep time */
-    WriteUint16(pkg, 0x0080);
+    PutUint16(pkg, 0x0080);
     /* devid */
-    WriteByte(pkg, 0x00);
-    WriteByte(pkg, 0x00);
+    PutByte(pkg, 0x00);
+    PutByte(pkg, 0x00);
     /* USERID */
-    WriteStr(pkg, userid);
+    PutStr(pkg, userid, userid_len);
     /* auth info */
-    WriteStr(pkg, auth_info);
+    PutStr(pkg, auth_info, info_len);
     return pkg;
 }
 /* push_data (C->S) */
@@ -551,17 +501,17 @@ EdpPacket* PacketPushdata(const char* dst_devid, const char* data, uint32_t data
 {
     EdpPacket* pkg = NULL;
     uint32_t remainlen;
+    uint16_t devid_len = strlen(dst_devid);
 
-    pkg = NewBuffer();
-    /* msg type */
-    WriteByte(pkg, PUSHDATA);
-    /* remain len */
-    remainlen = (2 + strlen(dst_devid)) + data_len;
-    WriteRemainlen(pkg, remainlen);
+    /* msg type + remain len */
+    remainlen = (2 + devid_len) + data_len;
+    pkg = NewPacket(PUSHDATA, remainlen);
+    if (pkg == NULL)
+        return NULL;
     /* dst devid */
-    WriteStr(pkg, dst_devid);
+    PutStr(pkg, dst_devid, devid_len);
     /* data */
-    WriteBytes(pkg, data, data_len);
+    PutBytes(pkg, data, data_len);
     return pkg;
 }
 /* sava_data (C->S) */
@@ -569,39 +519,45 @@ EdpPacket* PacketSavedataJson(const char* dst_devid, cJSON* json_obj, int32_t ty
 {
     EdpPacket* pkg = NULL;
     uint32_t remainlen = 0;
-    char* json_out = NULL;
-    uint32_t json_len = 0;
+    int json_len = 0;
+    uint16_t devid_len = 0;
 
-    pkg = NewBuffer();
-    json_out = cJSON_Print(json_obj);
-    json_len = strlen(json_out);
+    /* 先量出json长度, 包按最终大小申请后直接打印进去, 不再另外申请json字符串 */
+    json_len = cJSON_PrintToBuffer(json_obj, NULL, 0, 1);
+    if (json_len < 0 || json_len >= (0x01 << 16))
+        return NULL;
 
-    /* msg type */
-    WriteByte(pkg, SAVEDATA);
+    /* msg type + remain len */
+    remainlen = 1 + 1 + (2 + json_len);
+    if (dst_devid)
+    {
+        devid_len = strlen(dst_devid);
+        remainlen += 2 + devid_len;
+    }
+    pkg = NewPacketTail(SAVEDATA, remainlen, 1);
+    if (pkg == NULL)
+        return NULL;
     if (dst_devid)
     {
-        /* remain len */
-        remainlen = 1 + (2 + strlen(dst_devid)) + 1 + (2 + json_len);
-        WriteRemainlen(pkg, remainlen);
         /* translate address flag */
-        WriteByte(pkg, 0x80);
+        PutByte(pkg, 0x80);
         /* dst devid */
-        WriteStr(pkg, dst_devid);
+        PutStr(pkg, dst_devid, devid_len);
     }
     else
     {
-        /* remain len */
-        remainlen = 1 + 1 + (2 + json_len);
-        WriteRemainlen(pkg, remainlen);
         /* translate address flag */
-        WriteByte(pkg, 0x00);
+        PutByte(pkg, 0x00);
     }
     /* json flag */
-    WriteByte(pkg, type);
+    PutByte(pkg, type);
     /* json */
-    WriteStr(pkg, json_out);
-    printf("%s \n", json_out);
-    free(json_out);
+    if (PutJson(pkg, json_obj, json_len))
+    {
+        DeleteBuffer(&pkg);
+        return NULL;
+    }
+    printf("%s \n", (char*)pkg->_data + pkg->_write_pos - json_len);
     return pkg;
 }
 
@@ -626,30 +582,171 @@ MKFUN_PACKET_SAVE_DATA(double, Double)
 MKFUN_PACKET_SAVE_DATA(const char*, String)
 
 /* 解包函数 */
-MKFUN_UNPACK_SAVE_DATA_TYPE1(int, Int, Number)
-UNPACK_SAVE_DATA_TYPE1_END_NUMBER(int)
-MKFUN_UNPACK_SAVE_DATA_TYPE1(double, Double, Number)
-UNPACK_SAVE_DATA_TYPE1_END_NUMBER(double)
-MKFUN_UNPACK_SAVE_DATA_TYPE1(char*, String, String)
-UNPACK_SAVE_DATA_TYPE1_END_STRING
-
-MKFUN_UNPACK_SAVE_DATA_TYPE2(int, Int, Number)
-UNPACK_SAVE_DATA_TYPE23_END_NUMBER(int)
-MKFUN_UNPACK_SAVE_DATA_TYPE2(double, Double, Number)
-UNPACK_SAVE_DATA_TYPE23_END_NUMBER(double)
-MKFUN_UNPACK_SAVE_DATA_TYPE2(char*, String, String)
-UNPACK_SAVE_DATA_TYPE23_END_STRING()
-
-MKFUN_UNPACK_SAVE_DATA_TYPE3(int, Int, Number)
-UNPACK_SAVE_DATA_TYPE23_END_NUMBER(int)
-MKFUN_UNPACK_SAVE_DATA_TYPE3(double, Double, Number)
-UNPACK_SAVE_DATA_TYPE23_END_NUMBER(double)
-MKFUN_UNPACK_SAVE_DATA_TYPE3(char*, String, String)
-UNPACK_SAVE_DATA_TYPE23_END_STRING()
-
-MKFUN_UNPACK_SAVE_DATA(int, Int)
-MKFUN_UNPACK_SAVE_DATA(double, Double)
-MKFUN_UNPACK_SAVE_DATA(char*, String)
+/*
+ * savedata json的一次遍历解析: 用cJSON_Sax直接扫描包内的json文本,
+ * 只取出第一个数据流的ds_id和value, 不建立cJSON树, 内存占用固定
+ */
+typedef struct SavedataSax
+{
+    SaveDataType type;
+    char* ds_id;            /* malloc出来的数据流ID */
+    int32_t event;          /* value的事件类型, cJSON_SaxNumber等 */
+    double number;          /* 数值, true/false为1/0 */
+    char* string;           /* value为字符串时malloc出来的值 */
+    uint8_t got_value;
+} SavedataSax;
+
+/* 解析器约400字节, 放在栈上太大, 单线程使用 */
+static cJSON_SaxParser savedata_parser;
+
+static char* SaxStrdup(const char* text, size_t len)
+{
+    char* str = (char*)malloc(len + 1);
+    if (str)
+    {
+        memcpy(str, text, len);
+        str[len] = 0;
+    }
+    return str;
+}
+
+/*
+ * 当前事件要取出的内容: 0 不要, 1 数据流ID, 2 value.
+ * 过滤器和处理函数共用, 不要的键和值只计长度, 多长都不会出错
+ */
+static int SavedataSaxPick(const cJSON_SaxParser* p, int event, const SavedataSax* ctx)
+{
+    int is_value = event >= cJSON_SaxString;
+    int match = 0;
+
+    switch (ctx->type)
+    {
+    case kTypeFullJson:
+        /* {"datastreams":[{"id":"ds","datapoints":[{"at":"...","value":v}]}]} */
+        if (event == cJSON_SaxString && !ctx->ds_id
+            && cJSON_SaxPathMatch(p, "datastreams[0].id"))
+            return 1;
+        match = is_value && cJSON_SaxPathMatch(p, "datastreams[0].datapoints[0].value");
+        break;
+    case kTypeSimpleJsonWithoutTime:
+        /* {"ds":v}, 取第一个成员 */
+        if (p->depth == 1 && p->level[0].index > 0)
+            return 0;
+        if (event == cJSON_SaxKey && p->depth == 1)
+            return 1;
+        match = is_value && p->depth == 1;
+        break;
+    case kTypeSimpleJsonWithTime:
+        /* {"ds":{"time":v}}, 取第一个成员的第一个时间点 */
+        if (p->depth >= 1 && p->level[0].index > 0)
+            return 0;
+        if (event == cJSON_SaxKey && p->depth == 1)
+            return 1;
+        match = is_value && cJSON_SaxPathMatch(p, "*.*");
+        break;
+    default:
+        return 0;
+    }
+    return match && !ctx->got_value ? 2 : 0;
+}
+
+static int SavedataSaxFilter(const cJSON_SaxParser* p, int event, void* arg)
+{
+    return SavedataSaxPick(p, event, (const SavedataSax*)arg) != 0;
+}
+
+static int SavedataSaxHandler(cJSON_SaxParser* p, int event,
+                              const char* text, size_t len, void* arg)
+{
+    SavedataSax* ctx = (SavedataSax*)arg;
+
+    switch (SavedataSaxPick(p, event, ctx))
+    {
+    case 1:
+        ctx->ds_id = SaxStrdup(text, len);
+        break;
+    case 2:
+        ctx->got_value = 1;
+        ctx->event = event;
+        ctx->number = (event == cJSON_SaxNumber) ? p->number : (event == cJSON_SaxTrue);
+        if (event == cJSON_SaxString)
+            ctx->string = SaxStrdup(text, len);
+        break;
+    default:
+        break;
+    }
+    /* ds_id和value都拿到后不再继续扫描 */
+    return ctx->got_value && ctx->ds_id;
+}
+
+static int32_t UnpackSavedataSax(SaveDataType type, EdpPacket* pkg, SavedataSax* ctx)
+{
+    uint16_t len = 0;
+    int rc;
+
+    memset(ctx, 0, sizeof(SavedataSax));
+    ctx->type = type;
+    if (type != kTypeFullJson && type != kTypeSimpleJsonWithoutTime
+        && type != kTypeSimpleJsonWithTime)
+        return -1;
+    if (ReadUint16(pkg, &len) || pkg->_read_pos + len > pkg->_write_pos)
+        return ERR_UNPACK_SAVED_JSON;
+
+    cJSON_SaxInit(&savedata_parser, SavedataSaxHandler, ctx);
+    cJSON_SaxSetFilter(&savedata_parser, SavedataSaxFilter);
+    rc = cJSON_SaxFeed(&savedata_parser, (const char*)pkg->_data + pkg->_read_pos, len);
+    pkg->_read_pos += len;
+    if (rc < 0 || !ctx->got_value || !ctx->ds_id)
+    {
+        free(ctx->ds_id);
+        free(ctx->string);
+        return ERR_UNPACK_SAVED_JSON;
+    }
+    return 0;
+}
+
+int32_t UnpackSavedataInt(SaveDataType type, EdpPacket* pkg,
+                          char** ds_id, int* value)
+{
+    SavedataSax ctx;
+    int32_t ret = UnpackSavedataSax(type, pkg, &ctx);
+    if (ret)
+        return ret;
+    free(ctx.string);
+    *ds_id = ctx.ds_id;
+    *value = (int)ctx.number;
+    return 0;
+}
+
+int32_t UnpackSavedataDouble(SaveDataType type, EdpPacket* pkg,
+                             char** ds_id, double* value)
+{
+    SavedataSax ctx;
+    int32_t ret = UnpackSavedataSax(type, pkg, &ctx);
+    if (ret)
+        return ret;
+    free(ctx.string);
+    *ds_id = ctx.ds_id;
+    *value = ctx.number;
+    return 0;
+}
+
+int32_t UnpackSavedataString(SaveDataType type, EdpPacket* pkg,
+                             char** ds_id, char** value)
+{
+    SavedataSax ctx;
+    int32_t ret = UnpackSavedataSax(type, pkg, &ctx);
+    if (ret)
+        return ret;
+    if (ctx.event != cJSON_SaxString)
+    {
+        free(ctx.ds_id);
+        return ERR_UNPACK_SAVED_JSON;
+    }
+    *ds_id = ctx.ds_id;
+    *value = ctx.string;
+    return 0;
+}
 
 int32_t UnpackSavedataAck(EdpPacket* pkg, char** json_ack)
 {
@@ -678,49 +775,51 @@ EdpPacket* PacketSavedataBin(const char* dst_devid,
 {
     EdpPacket* pkg = NULL;
     uint32_t remainlen = 0;
-    char* desc_out = NULL;
-    uint32_t desc_len = 0;
+    int desc_len = 0;
+    uint16_t devid_len = 0;
 
     /* check arguments */
-    desc_out = cJSON_Print(desc_obj);
-    desc_len = strlen(desc_out);
-    if (desc_len > (0x01 << 16) || bin_len > (3 * (0x01 << 20))
+    desc_len = cJSON_PrintToBuffer(desc_obj, NULL, 0, 1);
+    if (desc_len < 0 || desc_len >= (0x01 << 16) || bin_len > (3 * (0x01 << 20))
         /* desc < 2^16 && bin_len < 3M*/
         || cJSON_GetObjectItem(desc_obj, "ds_id") == 0)
         /* desc_obj MUST has ds_id */
     {
-        free(desc_out);
         return 0;
     }
-    pkg = NewBuffer();
-    /* msg type */
-    WriteByte(pkg, SAVEDATA);
+    /* msg type + remain len */
+    remainlen = 1 + 1 + (2 + desc_len) + (4 + bin_len);
+    if (dst_devid)
+    {
+        devid_len = strlen(dst_devid);
+        remainlen += 2 + devid_len;
+    }
+    pkg = NewPacket(SAVEDATA, remainlen);
+    if (pkg == NULL)
+        return NULL;
     if (dst_devid)
     {
-        /* remain len */
-        remainlen = 1 + (2 + strlen(dst_devid)) + 1 + (2 + desc_len) + (4 + bin_len);
-        WriteRemainlen(pkg, remainlen);
         /* translate address flag */
-        WriteByte(pkg, 0x80);
+        PutByte(pkg, 0x80);
         /* dst devid */
-        WriteStr(pkg, dst_devid);
+        PutStr(pkg, dst_devid, devid_len);
     }
     else
     {
-        /* remain len */
-        remainlen = 1 + 1 + (2 + desc_len) + (4 + bin_len);
-        WriteRemainlen(pkg, remainlen);
         /* translate address flag */
-        WriteByte(pkg, 0x00);
+        PutByte(pkg, 0x00);
     }
     /* bin flag */
-    WriteByte(pkg, 0x02);
-    /* desc */
-    WriteStr(pkg, desc_out);
-    free(desc_out);
+    PutByte(pkg, 0x02);
+    /* desc, 结尾的'\0'落在随后的bin_len字段上 */
+    if (PutJson(pkg, desc_obj, desc_len))
+    {
+        DeleteBuffer(&pkg);
+        return NULL;
+    }
     /* bin data */
-    WriteUint32(pkg, bin_len);
-    WriteBytes(pkg, bin_data, bin_len);
+    PutUint32(pkg, bin_len);
+    PutBytes(pkg, bin_data, bin_len);
     return pkg;
 }
 
@@ -730,6 +829,7 @@ EdpPacket* PacketSavedataBinStr(const char* dst_devid,
     EdpPacket* pkg = NULL;
     uint32_t remainlen = 0;
     uint32_t desc_len = 0;
+    uint16_t devid_len = 0;
 
     /* check arguments */
     desc_len = strlen(desc_str);
@@ -738,34 +838,35 @@ EdpPacket* PacketSavedataBinStr(const char* dst_devid,
         /* desc < 2^16 && bin_len < 3M*/
         return 0;
     }
-    pkg = NewBuffer();
-    /* msg type */
-    WriteByte(pkg, SAVEDATA);
+    /* msg type + remain len */
+    remainlen = 1 + 1 + (2 + desc_len) + (4 + bin_len);
+    if (dst_devid)
+    {
+        devid_len = strlen(dst_devid);
+        remainlen += 2 + devid_len;
+    }
+    pkg = NewPacket(SAVEDATA, remainlen);
+    if (pkg == NULL)
+        return NULL;
     if (dst_devid)
     {
-        /* remain len */
-        remainlen = 1 + (2 + strlen(dst_devid)) + 1 + (2 + desc_len) + (4 + bin_len);
-        WriteRemainlen(pkg, remainlen);
         /* translate address flag */
-        WriteByte(pkg, 0x80);
+        PutByte(pkg, 0x80);
         /* dst devid */
-        WriteStr(pkg, dst_devid);
+        PutStr(pkg, dst_devid, devid_len);
     }
     else
     {
-        /* remain len */
-        remainlen = 1 + 1 + (2 + desc_len) + (4 + bin_len);
-        WriteRemainlen(pkg, remainlen);
         /* translate address flag */
-        WriteByte(pkg, 0x00);
+        PutByte(pkg, 0x00);
     }
     /* bin flag */
-    WriteByte(pkg, 0x02);
+    PutByte(pkg, 0x02);
     /* desc */
-    WriteStr(pkg, desc_str);
+    PutStr(pkg, desc_str, desc_len);
     /* bin data */
-    WriteUint32(pkg, bin_len);
-    WriteBytes(pkg, bin_data, bin_len);
+    PutUint32(pkg, bin_len);
+    PutBytes(pkg, bin_data, bin_len);
     return pkg;
 }
 
@@ -775,31 +876,24 @@ EdpPacket* PacketCmdResp(const char* cmdid, uint16_t cmdid_len,
     EdpPacket* send_pkg = NULL;
     unsigned remainlen = 0;
 
-    send_pkg = NewBuffer();
     /* 6 = 2 + 4 = len(cmdid_len) + len(resp_len) */
     remainlen = cmdid_len + resp_len + (resp_len ? 6 : 2);
-    WriteByte(send_pkg, CMDRESP);
-    WriteRemainlen(send_pkg, remainlen);
-    WriteUint16(send_pkg, cmdid_len);
-    WriteBytes(send_pkg, cmdid, cmdid_len);
+    send_pkg = NewPacket(CMDRESP, remainlen);
+    if (send_pkg == NULL)
+        return NULL;
+    PutStr(send_pkg, cmdid, cmdid_len);
     if (resp_len)
     {
-        WriteUint32(send_pkg, resp_len);
-        WriteBytes(send_pkg, resp, resp_len);
+        PutUint32(send_pkg, resp_len);
+        PutBytes(send_pkg, resp, resp_len);
     }
     return send_pkg;
 }
 /* ping (C->S) */
 EdpPacket* PacketPing(void)
 {
-    EdpPacket* pkg = NULL;
-
-    pkg = NewBuffer();
-    /* msg type */
-    WriteByte(pkg, PINGREQ);
-    /* remain len */
-    WriteRemainlen(pkg, 0);
-    return pkg;
+    /* msg type + remain len */
+    return NewPacket(PINGREQ, 0);
 }
 /*---------------------------------------------------------------------------*/
 /* recv stream to a edp packet (S->C) */
@@ -814,7 +908,10 @@ EdpPacket* GetEdpPacket(RecvBuffer* buf)
         printf("%s flag<=0\n", __func__);
         return pkg;
     }
-    pkg = NewBuffer();
+    /* 多留1字节, 包尾字段原地解析(cJSON_ParseInSitu)时用作结束符 */
+    pkg = NewBufferSize(flag + 1);
+    if (pkg == NULL)
+        return NULL;
     WriteBytes(pkg, buf->_data, flag);
     /* shrink buffer */
     memmove(buf->_data, buf->_data + flag, buf->_write_pos - flag);
@@ -823,6 +920,27 @@ EdpPacket* GetEdpPacket(RecvBuffer* buf)
 }
 /* is the recv buffer has a complete edp packet? */
 int32_t IsPkgComplete(RecvBuffer* buf)
+{
+    int32_t pkg_total_len = 0;
+
+    pkg_total_len = GetPkgTotalLen(buf);
+    if (pkg_total_len <= 0)
+    {
+        return pkg_total_len;
+    }
+    /* receive payload */
+    if ((uint32_t)pkg_total_len <= buf->_write_pos)
+    {
+        //printf("a complete packet len:%d\n", pkg_total_len);
+        return pkg_total_len;   /* all data for this pkg is read */
+    }
+    else
+    {
+        return 0;   /* continue receive */
+    }
+}
+/* total len of the first edp packet in the recv buffer, decoded from its header */
+int32_t GetPkgTotalLen(RecvBuffer* buf)
 {
     uint8_t* data = NULL;
     uint32_t data_len = 0;
@@ -830,7 +948,6 @@ int32_t IsPkgComplete(RecvBuffer* buf)
     uint32_t len_val = 0;
     uint32_t len_len = 1;
     uint8_t* pdigit = NULL;
-    uint32_t pkg_total_len = 0;
 
     data = buf->_data;
     data_len = buf->_write_pos;
@@ -859,17 +976,7 @@ int32_t IsPkgComplete(RecvBuffer* buf)
     }
     while(((*pdigit) & 0x80) != 0);
 
-    pkg_total_len = len_len + len_val;
-    /* receive payload */
-    if (pkg_total_len <= (uint32_t)data_len)
-    {
-        //printf("a complete packet len:%d\n", pkg_total_len);
-        return pkg_total_len;   /* all data for this pkg is read */
-    }
-    else
-    {
-        return 0;   /* continue receive */
-    }
+    return len_len + len_val;
 }
 /* get edp packet type, client should use this type to invoke Unpack??? function */
 uint8_t EdpPacketType(EdpPacket* pkg)
@@ -933,13 +1040,24 @@ int32_t UnpackSavedata(EdpPacket* pkg, char** src_devid, uint8_t* jb_flag)
         return ERR_UNPACK_SAVED_DATAFLAG;
     return 0;
 }
+/* 在包内原地解析一个带2字节长度的JSON字符串, 生成的cJSON引用pkg的数据 */
+static int32_t ReadJsonInSitu(EdpPacket* pkg, cJSON** json_obj)
+{
+    uint16_t len = 0;
+    if (ReadUint16(pkg, &len))
+        return -1;
+    /* 需要多1字节作为解析时的结束符 */
+    if (pkg->_read_pos + len > pkg->_write_pos
+        || pkg->_read_pos + len >= pkg->_capacity)
+        return -1;
+    *json_obj = cJSON_ParseInSitu((char*)pkg->_data + pkg->_read_pos, len);
+    pkg->_read_pos += len;
+    return 0;
+}
 int32_t UnpackSavedataJson(EdpPacket* pkg, cJSON** json_obj)
 {
-    char* json_str;
-    if (ReadStr(pkg, &json_str))
+    if (ReadJsonInSitu(pkg, json_obj))
         return ERR_UNPACK_SAVED_JSON;
-    *json_obj = cJSON_Parse(json_str);
-    free(json_str);
     if (*json_obj == 0)
         return ERR_UNPACK_SAVED_PARSEJSON;
     my_assert(pkg->_read_pos == pkg->_write_pos);
@@ -949,11 +1067,8 @@ int32_t UnpackSavedataJson(EdpPacket* pkg, cJSON** json_obj)
 int32_t UnpackSavedataBin(EdpPacket* pkg, cJSON** desc_obj,
                           uint8_t** bin_data, uint32_t* bin_len)
 {
-    char* desc_str;
-    if (ReadStr(pkg, &desc_str))
+    if (ReadJsonInSitu(pkg, desc_obj))
         return ERR_UNPACK_SAVED_BIN_DESC;
-    *desc_obj = cJSON_Parse(desc_str);
-    free(desc_str);
     if (*desc_obj == 0)
         return ERR_UNPACK_SAVED_PARSEDESC;
     if (ReadUint32(pkg, bin_len))
@@ -999,6 +1114,33 @@ int32_t UnpackCmdReq(EdpPacket* pkg, char** cmdid, uint16_t* cmdid_len,
     my_assert(pkg->_read_pos == pkg->_write_pos);
     return 0;
 }
+int32_t UnpackCmdReqInPlace(EdpPacket* pkg, const char** cmdid, uint16_t* cmdid_len,
+                            const uint8_t** req, uint32_t* req_len)
+{
+    uint32_t remainlen;
+    int rc;
+    if (ReadRemainlen(pkg, &remainlen))
+        return ERR_UNPACK_CMDREQ;
+
+    rc = ReadUint16(pkg, cmdid_len);
+    if (rc)
+        return rc;
+    if (*cmdid_len > pkg->_write_pos - pkg->_read_pos)
+        return ERR_UNPACK_CMDREQ;
+    *cmdid = (const char*)(pkg->_data + pkg->_read_pos);
+    pkg->_read_pos += *cmdid_len;
+
+    rc = ReadUint32(pkg, req_len);
+    if (rc)
+        return rc;
+    if (*req_len > pkg->_write_pos - pkg->_read_pos)      //req_len来自网络，相加可能回绕
+        return ERR_UNPACK_CMDREQ;
+    *req = pkg->_data + pkg->_read_pos;
+    pkg->_read_pos += *req_len;
+
+    my_assert(pkg->_read_pos == pkg->_write_pos);
+    return 0;
+}
 
 /* ping_resp (S->C) */
 int32_t UnpackPingResp(EdpPacket* pkg)
@@ -1016,33 +1158,35 @@ EdpPacket* PacketSavedataSimpleString(const char* dst_devid, const char* input)
     EdpPacket* pkg = NULL;
     uint32_t remainlen = 0;
     uint32_t input_len = 0;
+    uint16_t devid_len = 0;
 
-    pkg = NewBuffer();
     input_len = strlen(input);
-    /* msg type */
-    WriteByte(pkg, SAVEDATA);
+    /* msg type + remain len */
+    remainlen = 1 + 1 + (2 + input_len);
+    if (dst_devid)
+    {
+        devid_len = strlen(dst_devid);
+        remainlen += 2 + devid_len;
+    }
+    pkg = NewPacket(SAVEDATA, remainlen);
+    if (pkg == NULL)
+        return NULL;
     if (dst_devid)
     {
-        /* remain len */
-        remainlen = 1 + (2 + strlen(dst_devid)) + 1 + (2 + input_len);
-        WriteRemainlen(pkg, remainlen);
         /* translate address flag */
-        WriteByte(pkg, 0x80);
+        PutByte(pkg, 0x80);
         /* dst devid */
-        WriteStr(pkg, dst_devid);
+        PutStr(pkg, dst_devid, devid_len);
     }
     else
     {
-        /* remain len */
-        remainlen = 1 + 1 + (2 + input_len);
-        WriteRemainlen(pkg, remainlen);
         /* translate address flag */
-        WriteByte(pkg, 0x00);
+        PutByte(pkg, 0x00);
     }
     /* json flag */
-    WriteByte(pkg, kTypeString);
+    PutByte(pkg, kTypeString);
     /* json */
-    WriteStr(pkg, input);
+    PutStr(pkg, input, input_len);
 
     return pkg;
 }
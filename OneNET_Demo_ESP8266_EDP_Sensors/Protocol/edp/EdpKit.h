@@ -115,6 +115,17 @@ typedef struct Buffer
  *          返回值为空 生成Buffer失败, 内存不够
  */
 EDPKIT_DLL Buffer* NewBuffer(void);
+/*
+ * 函数名:  NewBufferSize
+ * 功能:    生成初始容量为size字节的Buffer
+ * 说明:    打包函数在已知包总长时用它一次申请到位, 避免从BUFFER_SIZE开始
+ *          成倍扩容和拷贝; 同样需要用DeleteBuffer销毁
+ * 参数:    size    Buffer的初始容量
+ * 返回值:  类型 (Buffer*)
+ *          返回值非空 生成Buffer成功, 返回这个Buffer的指针
+ *          返回值为空 生成Buffer失败, 内存不够
+ */
+EDPKIT_DLL Buffer* NewBufferSize(uint32_t size);
 /*
  * 函数名:  DeleteBuffer
  * 功能:    销毁Buffer
@@ -277,6 +288,18 @@ EDPKIT_DLL int32_t WriteRemainlen(Buffer* buf, uint32_t len_val);
  *          <0      数据错误, 不符合EDP协议
  */
 EDPKIT_DLL int32_t IsPkgComplete(RecvBuffer* buf);
+/*
+ * 函数名:  GetPkgTotalLen
+ * 功能:    根据接收到的Buffer中第一个EDP包的包头, 获取这个包的总长度
+ * 说明:    只需要收到消息类型和remainlen即可得到总长度, 不要求包体已收完,
+ *          接收方可以据此预先扩展接收缓存, 或丢弃超长的包
+ * 参数:    buf     接收到的Buffer(二进制流)
+ * 返回值:  类型 (int32_t)
+ *          =0      包头还未收完, 需要继续接收
+ *          >0      EDP包总长度(消息类型 + remainlen + 包体)
+ *          <0      数据错误, 不符合EDP协议
+ */
+EDPKIT_DLL int32_t GetPkgTotalLen(RecvBuffer* buf);
 
 /*-----------------------------客户端操作的接口------------------------------*/
 /*
@@ -490,6 +513,7 @@ EDPKIT_DLL EdpPacket* PacketSavedataString(SaveDataType type, const char* dst_de
  * 函数名:  UnpackSavedataInt
  * 功能:    解包 由设备云到设备的EDP协议包, 存储数据
  * 说明:    接收设备云发来的数据,将其中的数据流ID及值解析出来。
+ *          用cJSON_Sax一次扫描包内json, 只取第一个数据流, 不建立cJSON树
  *
  * 相关函数:PacketSavedataInt
  *
@@ -509,6 +533,7 @@ EDPKIT_DLL int32_t UnpackSavedataInt(SaveDataType type, EdpPacket* pkg,
  * 函数名:  UnpackSavedataDouble
  * 功能:    解包 由设备云到设备的EDP协议包, 存储数据
  * 说明:    接收设备云发来的数据,将其中的数据流ID及值解析出来。
+ *          用cJSON_Sax一次扫描包内json, 只取第一个数据流, 不建立cJSON树
  *
  * 相关函数:PacketSavedataDouble
  *
@@ -528,6 +553,7 @@ EDPKIT_DLL int32_t UnpackSavedataDouble(SaveDataType type, EdpPacket* pkg,
  * 函数名:  UnpackSavedataString
  * 功能:    解包 由设备云到设备的EDP协议包, 存储数据
  * 说明:    接收设备云发来的数据,将其中的数据流ID及值解析出来。
+ *          用cJSON_Sax一次扫描包内json, 只取第一个数据流, 不建立cJSON树
  *
  * 相关函数:PacketSavedataString
  *
@@ -641,6 +667,8 @@ EDPKIT_DLL int32_t UnpackSavedata(EdpPacket* pkg, char** src_devid, uint8_t* jb_
  * 函数名:  UnpackSavedataJson
  * 功能:    解包 由设备云到设备的EDP协议包, 存储数据(json格式数据)
  * 说明:    返回的json数据(json_obj)需要客户端释放
+ *          json_obj在pkg内原地解析, 字符串直接指向包内数据,
+ *          必须在DeleteBuffer(pkg)之前cJSON_Delete
  * 相关函数:PacketSavedataJson, GetEdpPacket, EdpPacketType, UnpackSavedata
  * 参数:    pkg         EDP包, 必须是savedata包的json数据包
  *          json_obj    json数据
@@ -654,6 +682,7 @@ int32_t UnpackSavedataJson(EdpPacket* pkg, cJSON** json_obj);
  * 函数名:  UnpackSavedataBin
  * 功能:    解包 由设备云到设备的EDP协议包, 存储数据(bin格式数据)
  * 说明:    返回的数据描述(desc_obj)和bin数据(bin_data)需要客户端释放
+ *          desc_obj在pkg内原地解析, 必须在DeleteBuffer(pkg)之前cJSON_Delete
  * 相关函数:PacketSavedataBin, GetEdpPacket, EdpPacketType, UnpackSavedata
  * 参数:    pkg         EDP包, 必须是savedata包的bin数据包
  *          desc_obj    数据描述 json格式
@@ -715,6 +744,24 @@ EDPKIT_DLL EdpPacket* PacketCmdResp(const char* cmdid, uint16_t cmdid_len,
 EDPKIT_DLL int32_t UnpackCmdReq(EdpPacket* pkg, char** cmdid, uint16_t* cmdid_len,
                                 char** req, uint32_t* req_len);
 
+/*
+ * 函数名:  UnpackCmdReqInPlace
+ * 功能:    解包 由设备云到设备的EDP协议包, 命令请求消息(不申请内存)
+ * 说明:    与UnpackCmdReq相同, 但cmdid和req直接指向pkg中的数据, 不做拷贝,
+ *          cmdid不以\0结尾, 只在pkg被删除之前有效, 不需要释放
+ * 相关函数:UnpackCmdReq, PacketCmdResp
+ * 参数:    pkg         EDP包
+ *          cmdid       获取命令id
+ *          cmdid_len   cmdid的长度
+ *          req         用户命令的起始位置
+ *          req_len     用户命令的长度
+ * 返回值:  类型 (int32_t)
+ *          =0          解析成功
+ *          <0          解析失败, 具体失败原因见本h文件的错误码
+ */
+EDPKIT_DLL int32_t UnpackCmdReqInPlace(EdpPacket* pkg, const char** cmdid, uint16_t* cmdid_len,
+                                       const uint8_t** req, uint32_t* req_len);
+
 /*
  * 函数名:  PacketPing
  * 功能:    打包 由设备到设备云的EDP协议包, 心跳
@@ -30,6 +30,7 @@
 #include "usart2.h"
 #include "EdpKit.h"
 #include "utils.h"
+#include "log.h"
 #include "esp8266.h"
 #include "bh1750fvi.h"
 #include "EdpDemo.h"
@@ -37,8 +38,12 @@
 int main(void)
 {
     int16_t data[3];
+    /*1ms节拍, mDelay和任务调度按它计时*/
+    SystickTime_Init();
     /*初始化串口1 用于调试信息输出*/
     USART1_Init();
+    /*日志经USART1的DMA输出*/
+    Log_Init();
     /*初始化串口2 用于MT6331通信*/
     USART2_Init();
     mDelay(1000);
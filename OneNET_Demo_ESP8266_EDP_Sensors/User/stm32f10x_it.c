@@ -25,6 +25,7 @@
 #include "stm32f10x_it.h"
 #include "usart1.h"
 #include "usart2.h"
+#include "utils.h"
 
 extern uint32_t SystickTime;
 extern __IO uint32_t TimeDisplay;
@@ -139,8 +140,7 @@ void PendSV_Handler(void)
   */
 void SysTick_Handler(void)
 {
-    //SystickTime_Increase();
-    //SystickTime++;
+    SystickTime_Increase();
 }
 
 /******************************************************************************/
@@ -187,26 +187,54 @@ void USART1_IRQHandler(void)
   */
 void USART2_IRQHandler(void)
 {
-		unsigned int data;
-#if 1
-    if(USART2->SR & 0x0F)
+    unsigned int data;
+
+    if(USART2->SR & (USART_FLAG_ORE | USART_FLAG_NE | USART_FLAG_FE))
     {
-        // See if we have some kind of error
-        // Clear interrupt (do nothing about it!)
+        // Overrun/noise/framing error, counted; reading DR clears it
+        usart2_rcv_errors++;
         data = USART2->DR;
     }
-    else if(USART2->SR & USART_FLAG_RXNE)   //Receive Data Reg Full Flag
-    {		//GPIO_SetBits(GPIOC,GPIO_Pin_0|GPIO_Pin_1|GPIO_Pin_2|GPIO_Pin_3);
+    if(USART2->SR & USART_FLAG_IDLE)
+    {
+        // Line idle after a burst: bytes are already in the DMA buffer, clear the flag (SR then DR) and hand them over
         data = USART2->DR;
-				usart2_rcv_buf[usart2_rcv_len++]=data;
-			  //usart1_rcv_buf[usart1_rcv_len++]=data;
-        //usart1_putrxchar(data);       //Insert received character into buffer                     
+        USART2_RcvUpdate(1);
+    }
+}
+
+/**
+  * @brief  This function handles DMA1 channel 6 (USART2_RX) interrupt request.
+  *         DMA/ȫ, DMAƻظ֮ǰݰ
+  * @param  None
+  * @retval : None
+  */
+void DMA1_Channel6_IRQHandler(void)
+{
+    if(DMA_GetITStatus(DMA1_IT_HT6) != RESET)
+    {
+        DMA_ClearITPendingBit(DMA1_IT_HT6);
+    }
+    if(DMA_GetITStatus(DMA1_IT_TC6) != RESET)
+    {
+        DMA_ClearITPendingBit(DMA1_IT_TC6);
+    }
+    USART2_RcvUpdate(0);
+}
+
+/**
+  * @brief  This function handles DMA1 channel 7 (USART2_TX) interrupt request.
+  *         һͻѽUSART2, ŷеһ
+  * @param  None
+  * @retval : None
+  */
+void DMA1_Channel7_IRQHandler(void)
+{
+    if(DMA_GetITStatus(DMA1_IT_TC7) != RESET)
+    {
+        DMA_ClearITPendingBit(DMA1_IT_TC7);
+        USART2_TxComplete();
     }
-		else
-		{
-				;
-		}
-		#endif
 }
 
 /**
@@ -0,0 +1,413 @@
+/*
+  Event based (SAX style) JSON parser to go with cJSON. See cJSON_Sax.h.
+*/
+
+#include <string.h>
+#include <stdlib.h>
+#include "cJSON_Sax.h"
+
+#if CJSON_SAX_TOKEN_MAX < CJSON_SAX_KEY_MAX
+#error "CJSON_SAX_TOKEN_MAX must hold a key"
+#endif
+
+/* Parser states. */
+enum
+{
+    SAX_VALUE,          /* expecting a value */
+    SAX_VALUE_OR_END,   /* just after '[' */
+    SAX_KEY_OR_END,     /* just after '{' */
+    SAX_KEY,            /* after ',' in an object */
+    SAX_COLON,
+    SAX_AFTER_VALUE,    /* expecting ',' or the closing bracket */
+    SAX_STRING,
+    SAX_ESCAPE,
+    SAX_UNICODE,
+    SAX_NUMBER,
+    SAX_LITERAL,
+    SAX_TRAILING        /* top-level value complete, only whitespace may follow */
+};
+
+static int is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+void cJSON_SaxInit(cJSON_SaxParser *p, cJSON_SaxHandler handler, void *arg)
+{
+    memset(p, 0, sizeof(cJSON_SaxParser));
+    p->handler = handler;
+    p->arg = arg;
+    p->status = CJSON_SAX_MORE;
+    p->state = SAX_VALUE;
+}
+
+void cJSON_SaxSetFilter(cJSON_SaxParser *p, cJSON_SaxFilter filter)
+{
+    p->filter = filter;
+}
+
+static int emit(cJSON_SaxParser *p, int event, const char *text, size_t len)
+{
+    if (p->handler && p->handler(p, event, text, len, p->arg))
+    {
+        p->status = CJSON_SAX_STOPPED;
+        return 0;
+    }
+    return 1;
+}
+
+/* A value has been completed at the current level. */
+static void value_done(cJSON_SaxParser *p)
+{
+    p->state = p->depth ? SAX_AFTER_VALUE : SAX_TRAILING;
+    if (!p->depth && p->status == CJSON_SAX_MORE) p->status = CJSON_SAX_DONE;
+}
+
+static int push(cJSON_SaxParser *p, int is_array)
+{
+    cJSON_SaxLevel *l;
+    if (p->depth >= CJSON_SAX_MAX_DEPTH)
+    {
+        p->status = CJSON_SAX_ERR_DEPTH;
+        return 0;
+    }
+    if (!emit(p, is_array ? cJSON_SaxArrayBegin : cJSON_SaxObjectBegin, 0, 0)) return 0;
+    l = &p->level[p->depth++];
+    l->key[0] = 0;
+    l->index = 0;
+    l->is_array = is_array;
+    p->state = is_array ? SAX_VALUE_OR_END : SAX_KEY_OR_END;
+    return 1;
+}
+
+static void pop(cJSON_SaxParser *p, char c)
+{
+    int is_array = p->level[p->depth - 1].is_array;
+    if (c != (is_array ? ']' : '}'))
+    {
+        p->status = CJSON_SAX_ERR_SYNTAX;
+        return;
+    }
+    p->depth--;
+    if (!emit(p, is_array ? cJSON_SaxArrayEnd : cJSON_SaxObjectEnd, 0, 0)) return;
+    value_done(p);
+}
+
+static int token_put(cJSON_SaxParser *p, char c)
+{
+    if (p->skip)
+    {
+        /* keep what path matching needs, count the rest */
+        if (p->token_len + 1 < CJSON_SAX_KEY_MAX) p->token[p->token_len] = c;
+        p->token_len++;
+        return 1;
+    }
+    if (p->token_len + 1 >= CJSON_SAX_TOKEN_MAX)
+    {
+        p->status = CJSON_SAX_ERR_TOKEN;
+        return 0;
+    }
+    p->token[p->token_len++] = c;
+    return 1;
+}
+
+/* Append code point uc as UTF-8. */
+static void token_put_utf8(cJSON_SaxParser *p, unsigned uc)
+{
+    if (uc < 0x80)
+    {
+        token_put(p, (char)uc);
+    }
+    else if (uc < 0x800)
+    {
+        token_put(p, (char)(0xC0 | (uc >> 6)));
+        token_put(p, (char)(0x80 | (uc & 0x3F)));
+    }
+    else if (uc < 0x10000)
+    {
+        token_put(p, (char)(0xE0 | (uc >> 12)));
+        token_put(p, (char)(0x80 | ((uc >> 6) & 0x3F)));
+        token_put(p, (char)(0x80 | (uc & 0x3F)));
+    }
+    else
+    {
+        token_put(p, (char)(0xF0 | (uc >> 18)));
+        token_put(p, (char)(0x80 | ((uc >> 12) & 0x3F)));
+        token_put(p, (char)(0x80 | ((uc >> 6) & 0x3F)));
+        token_put(p, (char)(0x80 | (uc & 0x3F)));
+    }
+}
+
+static void unicode_done(cJSON_SaxParser *p)
+{
+    unsigned uc = p->uc;
+    if (uc >= 0xD800 && uc <= 0xDBFF)
+    {
+        p->uc_high = uc;    /* wait for the low half */
+        return;
+    }
+    if (uc >= 0xDC00 && uc <= 0xDFFF)
+    {
+        if (!p->uc_high) return;    /* lone low surrogate: dropped, as cJSON does */
+        uc = 0x10000 + (((p->uc_high & 0x3FF) << 10) | (uc & 0x3FF));
+    }
+    p->uc_high = 0;
+    if (uc) token_put_utf8(p, uc);
+}
+
+/* NUL-terminate the token, returns the text to pass to the handler */
+static const char *token_end(cJSON_SaxParser *p)
+{
+    if (p->skip)
+    {
+        p->token[p->token_len < CJSON_SAX_KEY_MAX ? p->token_len : CJSON_SAX_KEY_MAX - 1] = 0;
+        return 0;
+    }
+    p->token[p->token_len] = 0;
+    return p->token;
+}
+
+static void string_done(cJSON_SaxParser *p)
+{
+    cJSON_SaxLevel *l;
+    const char *text = token_end(p);
+    p->uc_high = 0;
+    if (p->is_key)
+    {
+        l = &p->level[p->depth - 1];
+        strncpy(l->key, p->token, CJSON_SAX_KEY_MAX - 1);
+        l->key[CJSON_SAX_KEY_MAX - 1] = 0;
+        p->state = SAX_COLON;
+        emit(p, cJSON_SaxKey, text, p->token_len);
+        return;
+    }
+    if (!emit(p, cJSON_SaxString, text, p->token_len)) return;
+    value_done(p);
+}
+
+static void number_done(cJSON_SaxParser *p)
+{
+    const char *text = token_end(p);
+    p->number = text ? strtod(text, 0) : 0;
+    if (!emit(p, cJSON_SaxNumber, text, p->token_len)) return;
+    value_done(p);
+}
+
+/* Start reading the text of a key, string or number. */
+static void start_token(cJSON_SaxParser *p, int event)
+{
+    p->token_len = 0;
+    p->skip = p->filter && !p->filter(p, event, p->arg);
+}
+
+static void start_string(cJSON_SaxParser *p, int is_key)
+{
+    p->is_key = is_key;
+    start_token(p, is_key ? cJSON_SaxKey : cJSON_SaxString);
+    p->state = SAX_STRING;
+}
+
+/* Start of a value, c is its first non-space character. */
+static void start_value(cJSON_SaxParser *p, char c)
+{
+    switch (c)
+    {
+        case '{':
+            push(p, 0);
+            break;
+        case '[':
+            push(p, 1);
+            break;
+        case '\"':
+            start_string(p, 0);
+            break;
+        case 't':
+            p->literal = "rue";
+            p->literal_event = cJSON_SaxTrue;
+            p->state = SAX_LITERAL;
+            break;
+        case 'f':
+            p->literal = "alse";
+            p->literal_event = cJSON_SaxFalse;
+            p->state = SAX_LITERAL;
+            break;
+        case 'n':
+            p->literal = "ull";
+            p->literal_event = cJSON_SaxNull;
+            p->state = SAX_LITERAL;
+            break;
+        default:
+            if (c == '-' || (c >= '0' && c <= '9'))
+            {
+                start_token(p, cJSON_SaxNumber);
+                token_put(p, c);
+                p->state = SAX_NUMBER;
+            }
+            else p->status = CJSON_SAX_ERR_SYNTAX;
+            break;
+    }
+}
+
+static int hex_value(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+/* Process one character. Returns 1 if c was consumed, 0 if it must be processed again in the new state. */
+static int sax_char(cJSON_SaxParser *p, char c)
+{
+    int h;
+    switch (p->state)
+    {
+        case SAX_STRING:
+            if (c == '\"') string_done(p);
+            else if (c == '\\') p->state = SAX_ESCAPE;
+            else token_put(p, c);
+            return 1;
+        case SAX_ESCAPE:
+            p->state = SAX_STRING;
+            switch (c)
+            {
+                case 'b': token_put(p, '\b'); break;
+                case 'f': token_put(p, '\f'); break;
+                case 'n': token_put(p, '\n'); break;
+                case 'r': token_put(p, '\r'); break;
+                case 't': token_put(p, '\t'); break;
+                case 'u':
+                    p->uc = 0;
+                    p->hex_left = 4;
+                    p->state = SAX_UNICODE;
+                    break;
+                default: token_put(p, c); break;
+            }
+            return 1;
+        case SAX_UNICODE:
+            if ((h = hex_value(c)) < 0)
+            {
+                p->status = CJSON_SAX_ERR_SYNTAX;
+                return 1;
+            }
+            p->uc = (p->uc << 4) | (unsigned)h;
+            if (--p->hex_left == 0)
+            {
+                p->state = SAX_STRING;
+                unicode_done(p);
+            }
+            return 1;
+        case SAX_NUMBER:
+            if ((c >= '0' && c <= '9') || c == '.' || c == 'e' || c == 'E' || c == '+' || c == '-')
+            {
+                token_put(p, c);
+                return 1;
+            }
+            number_done(p);
+            return 0;
+        case SAX_LITERAL:
+            if (c != *p->literal)
+            {
+                p->status = CJSON_SAX_ERR_SYNTAX;
+                return 1;
+            }
+            if (!*++p->literal && emit(p, p->literal_event, 0, 0)) value_done(p);
+            return 1;
+        default:
+            break;
+    }
+
+    if (is_space(c)) return 1;
+    switch (p->state)
+    {
+        case SAX_VALUE:
+            start_value(p, c);
+            break;
+        case SAX_VALUE_OR_END:
+            if (c == ']') pop(p, c);
+            else start_value(p, c);
+            break;
+        case SAX_KEY_OR_END:
+            if (c == '}') pop(p, c);
+            else if (c == '\"') start_string(p, 1);
+            else p->status = CJSON_SAX_ERR_SYNTAX;
+            break;
+        case SAX_KEY:
+            if (c == '\"') start_string(p, 1);
+            else p->status = CJSON_SAX_ERR_SYNTAX;
+            break;
+        case SAX_COLON:
+            if (c == ':') p->state = SAX_VALUE;
+            else p->status = CJSON_SAX_ERR_SYNTAX;
+            break;
+        case SAX_AFTER_VALUE:
+            if (c == ',')
+            {
+                p->level[p->depth - 1].index++;
+                p->state = p->level[p->depth - 1].is_array ? SAX_VALUE : SAX_KEY;
+            }
+            else pop(p, c);
+            break;
+        default:    /* SAX_TRAILING */
+            p->status = CJSON_SAX_ERR_SYNTAX;
+            break;
+    }
+    return 1;
+}
+
+int cJSON_SaxFeed(cJSON_SaxParser *p, const char *data, size_t len)
+{
+    size_t i = 0;
+    while (i < len && (p->status == CJSON_SAX_MORE || (p->status == CJSON_SAX_DONE && p->state == SAX_TRAILING)))
+    {
+        if (sax_char(p, data[i])) i++;
+    }
+    return p->status;
+}
+
+int cJSON_SaxFinish(cJSON_SaxParser *p)
+{
+    if (p->status == CJSON_SAX_MORE && p->state == SAX_NUMBER && !p->depth) number_done(p);
+    if (p->status == CJSON_SAX_MORE) p->status = CJSON_SAX_ERR_SYNTAX;
+    return p->status;
+}
+
+int cJSON_SaxPathMatch(const cJSON_SaxParser *p, const char *pattern)
+{
+    const cJSON_SaxLevel *l;
+    const char *end;
+    size_t n;
+    int d, index;
+
+    for (d = 0; d < p->depth; d++)
+    {
+        l = &p->level[d];
+        if (*pattern == '.') pattern++;
+        if (l->is_array)
+        {
+            if (*pattern++ != '[') return 0;
+            if (*pattern == '*') pattern++;
+            else
+            {
+                for (index = 0; *pattern >= '0' && *pattern <= '9'; pattern++) index = index * 10 + (*pattern - '0');
+                if (index != l->index) return 0;
+            }
+            if (*pattern++ != ']') return 0;
+        }
+        else
+        {
+            for (end = pattern; *end && *end != '.' && *end != '['; end++);
+            n = (size_t)(end - pattern);
+            if (!n) return 0;
+            if (!(n == 1 && *pattern == '*') && (strncmp(l->key, pattern, n) || l->key[n])) return 0;
+            pattern = end;
+        }
+    }
+    return *pattern == 0;
+}
+
+const char *cJSON_SaxGetKey(const cJSON_SaxParser *p, int depth)
+{
+    if (depth < 0 || depth >= p->depth || p->level[depth].is_array) return 0;
+    return p->level[depth].key;
+}
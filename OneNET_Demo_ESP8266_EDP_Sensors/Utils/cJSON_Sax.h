@@ -0,0 +1,102 @@
+/*
+  Event based (SAX style) JSON parser to go with cJSON.
+
+  Feed it the text in one or more chunks; it calls a handler for every key, value and
+  container begin/end, keeps the current path, and never allocates. Use it when only a
+  few fields of a document are needed and building a cJSON tree would be wasteful.
+*/
+
+#ifndef cJSON_Sax__h
+#define cJSON_Sax__h
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define CJSON_SAX_MAX_DEPTH 8       /* deeper nesting is an error */
+#define CJSON_SAX_TOKEN_MAX 64      /* longest wanted string or number (see cJSON_SaxFilter), unescaped, including the NUL */
+#define CJSON_SAX_KEY_MAX   24      /* keys are kept per level for path matching, truncated to this (including the NUL) */
+
+/* Events: */
+#define cJSON_SaxObjectBegin 0
+#define cJSON_SaxObjectEnd 1
+#define cJSON_SaxArrayBegin 2
+#define cJSON_SaxArrayEnd 3
+#define cJSON_SaxKey 4
+#define cJSON_SaxString 5
+#define cJSON_SaxNumber 6
+#define cJSON_SaxTrue 7
+#define cJSON_SaxFalse 8
+#define cJSON_SaxNull 9
+
+/* Return values of cJSON_SaxFeed/cJSON_SaxFinish: */
+#define CJSON_SAX_MORE 0            /* the value is not complete yet, feed more */
+#define CJSON_SAX_DONE 1            /* one complete value has been parsed */
+#define CJSON_SAX_STOPPED 2         /* the handler returned non-zero */
+#define CJSON_SAX_ERR_SYNTAX -1
+#define CJSON_SAX_ERR_DEPTH -2
+#define CJSON_SAX_ERR_TOKEN -3      /* a wanted string or number longer than CJSON_SAX_TOKEN_MAX - 1 */
+
+typedef struct cJSON_SaxParser cJSON_SaxParser;
+
+/* Called for every event. For keys and strings text is the unescaped text, for numbers the number text and
+   p->number its value; text is NUL-terminated and only valid during the call. For begin/end events text is 0.
+   The path of the event (the container itself for begin/end) can be tested with cJSON_SaxPathMatch or cJSON_SaxGetKey.
+   Return non-zero to stop parsing. */
+typedef int (*cJSON_SaxHandler)(cJSON_SaxParser *p, int event, const char *text, size_t len, void *arg);
+
+/* Called before the text of a key, string or number is read (event is cJSON_SaxKey/String/Number), with the path
+   of the value; for a key the current level's key is still the previous one. Return 0 if the text is not needed:
+   it is then only counted, so it may be of any length, and the event comes with text 0 (p->number 0) and the
+   full len. Without a filter every text is wanted and bounded by CJSON_SAX_TOKEN_MAX. */
+typedef int (*cJSON_SaxFilter)(const cJSON_SaxParser *p, int event, void *arg);
+
+typedef struct cJSON_SaxLevel {
+	char key[CJSON_SAX_KEY_MAX];	/* key of the current member, objects only */
+	int index;						/* index of the current element (arrays) or member (objects) */
+	int is_array;
+} cJSON_SaxLevel;
+
+struct cJSON_SaxParser {
+	cJSON_SaxHandler handler;
+	cJSON_SaxFilter filter;
+	void *arg;
+	int status;						/* CJSON_SAX_MORE while running, then the final result */
+	int state;
+	int depth;						/* number of open containers */
+	cJSON_SaxLevel level[CJSON_SAX_MAX_DEPTH];
+	char token[CJSON_SAX_TOKEN_MAX];
+	size_t token_len;
+	int skip;						/* the text being read is not wanted: only its key prefix is kept */
+	int is_key;						/* the string being read is a key */
+	const char *literal;			/* remaining characters of true/false/null */
+	int literal_event;
+	unsigned uc, uc_high;			/* \u escape being read, pending high surrogate */
+	int hex_left;
+	double number;					/* value of the last cJSON_SaxNumber event */
+};
+
+/* Prepare p for a new document. */
+extern void cJSON_SaxInit(cJSON_SaxParser *p, cJSON_SaxHandler handler, void *arg);
+/* Install a filter (called with the same arg as the handler) after cJSON_SaxInit. */
+extern void cJSON_SaxSetFilter(cJSON_SaxParser *p, cJSON_SaxFilter filter);
+/* Parse the next len bytes. Chunks may split the text anywhere. Returns one of the CJSON_SAX_ values above;
+   after anything but CJSON_SAX_MORE further input is ignored. */
+extern int cJSON_SaxFeed(cJSON_SaxParser *p, const char *data, size_t len);
+/* End of input: completes a bare top-level number. Returns CJSON_SAX_DONE/STOPPED, or an error if incomplete. */
+extern int cJSON_SaxFinish(cJSON_SaxParser *p);
+
+/* Does the current path match pattern? Patterns look like "datastreams[*].datapoints[0].value":
+   keys separated by '.', array indices in brackets, '*' matches any key or index. "" is the top level. */
+extern int cJSON_SaxPathMatch(const cJSON_SaxParser *p, const char *pattern);
+/* Key of the current member at nesting level depth (0 = top-level object), or 0 if that level is not an object. */
+extern const char *cJSON_SaxGetKey(const cJSON_SaxParser *p, int depth);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,147 @@
+#include <stddef.h>
+#include "sched.h"
+
+/*
+ * 时钟和空闲处理可以替换, 例如在PC上用模拟时钟运行:
+ * SCHED_NOW()返回当前毫秒数, SCHED_IDLE(ms)在没有任务到点时调用, 最多等ms毫秒.
+ * 替换后不再依赖板子的头文件, 替换用的函数可用编译器的-include引入声明.
+ */
+#ifndef SCHED_NOW
+#include "utils.h"
+#define SCHED_NOW()     SystickTime_Get()
+#endif
+
+static SchedTask *sched_list = NULL;
+static volatile uint8_t sched_woken = 0;   /*Sched_RunOnce之后有任务被唤醒*/
+
+#ifndef SCHED_IDLE
+#include "stm32f10x.h"
+#define SCHED_IDLE(ms)  Sched_Idle(ms)
+
+/*
+ *  @brief 没有到点的任务时睡眠, 下一个SysTick(最多1ms)或其他中断唤醒
+ */
+static void Sched_Idle(uint32_t ms)
+{
+    /*关中断后再判断, 判断之后、睡眠之前来的中断挂起, 同样能把WFI唤醒*/
+    __disable_irq();
+    if(!sched_woken)
+    {
+        __WFI();
+    }
+    __enable_irq();
+}
+#endif
+
+/*
+ *  @brief 启动任务, delay毫秒后第一次运行; 任务已在运行时只改下次运行的时间
+ *  @param task: 任务控制块, 由调用者分配, 一般是静态变量
+ *  @param func: 任务函数, 返回下次运行前等待的毫秒数或SCHED_STOP
+ *  @param arg: 传给func的参数
+ *  @param delay: 第一次运行前等待的毫秒数
+ */
+void Sched_Start(SchedTask *task, SchedFunc func, void *arg, uint32_t delay)
+{
+    SchedTask **p;
+
+    task->func = func;
+    task->arg = arg;
+    task->wake = SCHED_NOW() + delay;
+    task->ready = 0;
+    task->active = 1;
+    if(!task->linked)
+    {
+        /*挂到链表末尾, 同时到点的任务按启动顺序运行*/
+        task->next = NULL;
+        for(p = &sched_list; *p != NULL; p = &(*p)->next);
+        *p = task;
+        task->linked = 1;
+    }
+}
+
+/*
+ *  @brief 停止任务, 任务函数中也可以停止自己或别的任务
+ *         控制块留在链表中, 再次Sched_Start时重用
+ */
+void Sched_Stop(SchedTask *task)
+{
+    task->active = 0;
+    task->ready = 0;
+}
+
+/*
+ *  @brief 让任务尽快运行, 中断中也可调用
+ */
+void Sched_Wake(SchedTask *task)
+{
+    task->ready = 1;
+    sched_woken = 1;
+}
+
+/*
+ *  @brief 把到点的任务各运行一次
+ *  @retval 距离最近一个任务到点的毫秒数, 0表示马上还有任务要运行
+ */
+uint32_t Sched_RunOnce(void)
+{
+    SchedTask *t;
+    uint32_t now, delay, left;
+    uint32_t next = SCHED_STOP;
+    uint8_t due;
+
+    sched_woken = 0;
+    for(t = sched_list; t != NULL; t = t->next)
+    {
+        if(!t->active)
+        {
+            continue;
+        }
+        now = SCHED_NOW();
+        due = (int32_t)(now - t->wake) >= 0;
+        if(t->ready || due)
+        {
+            t->ready = 0;
+            delay = t->func(t->arg);
+            if(delay == SCHED_STOP || !t->active)
+            {
+                t->active = 0;      /*返回SCHED_STOP或在任务里被停止*/
+                continue;
+            }
+            /*
+             * 到点运行的从这次的到点时刻算起, 周期不随任务运行时间和调度延迟漂移;
+             * 被唤醒提前运行的从现在算起. 已经错过了下次的时刻(任务运行太久)时
+             * 下一轮马上运行, 但不补跑错过的次数
+             */
+            t->wake = (due ? t->wake : now) + delay;
+            now = SCHED_NOW();
+            if((int32_t)(now - t->wake) > 0)
+            {
+                t->wake = now;
+            }
+        }
+        /*运行期间被中断唤醒的任务马上还要运行*/
+        left = t->ready ? 0 : ((int32_t)(t->wake - now) > 0 ? t->wake - now : 0);
+        if(left < next)
+        {
+            next = left;
+        }
+    }
+    return next;
+}
+
+/*
+ *  @brief 调度主循环, 不返回; 没有到点的任务时进入SCHED_IDLE
+ */
+void Sched_Run(void)
+{
+    uint32_t next;
+
+    while(1)
+    {
+        next = Sched_RunOnce();
+        if(next > 0)
+        {
+            SCHED_IDLE(next);
+        }
+    }
+}
@@ -0,0 +1,50 @@
+#ifndef __SCHED_HEADER__
+#define __SCHED_HEADER__
+#include <stdint.h>
+
+/*
+ * 协作式任务调度.
+ * 任务函数运行到返回为止, 返回值是多少毫秒后再运行它; 任务之间不抢占,
+ * 所以任务里不要长时间等待, 要等就返回等待的时间, 把一件事拆成几步.
+ * 等待时间从这次应该运行的时刻算起, 不含调度延迟和任务本身的运行时间,
+ * 所以返回固定值的任务周期不漂移; Sched_Wake提前运行的从运行时刻算起.
+ * 没有到点的任务时CPU在WFI中睡眠, 由SysTick或其他中断唤醒.
+ */
+#define SCHED_STOP  0xFFFFFFFFUL    /*任务函数返回它表示不再运行*/
+
+typedef uint32_t (*SchedFunc)(void *arg);
+
+typedef struct SchedTask
+{
+    SchedFunc func;
+    void *arg;
+    uint32_t wake;              /*下次运行的时刻(ms)*/
+    volatile uint8_t ready;     /*Sched_Wake置位, 不等到点就运行*/
+    uint8_t active;
+    uint8_t linked;             /*已在任务链表中*/
+    struct SchedTask *next;
+} SchedTask;
+
+/*
+ *  @brief 启动任务, delay毫秒后第一次运行; 任务已在运行时只改下次运行的时间
+ *  @param task: 任务控制块, 由调用者分配, 一般是静态变量
+ */
+void Sched_Start(SchedTask *task, SchedFunc func, void *arg, uint32_t delay);
+/*
+ *  @brief 停止任务, 任务函数中也可以停止自己或别的任务
+ */
+void Sched_Stop(SchedTask *task);
+/*
+ *  @brief 让任务尽快运行, 中断中也可调用(如收到数据后唤醒处理任务)
+ */
+void Sched_Wake(SchedTask *task);
+/*
+ *  @brief 把到点的任务各运行一次
+ *  @retval 距离最近一个任务到点的毫秒数, 0表示马上还有任务要运行
+ */
+uint32_t Sched_RunOnce(void);
+/*
+ *  @brief 调度主循环, 不返回
+ */
+void Sched_Run(void);
+#endif
@@ -17,6 +17,16 @@ uint8_t prvucMBBIN2CHAR(uint8_t ucByte);
 void uDelay(uint32_t i);
 
 void mDelay(uint32_t i);
+
+/*
+ *  @brief SysTick毫秒计时, 1ms中断一次
+ */
+void SystickTime_Init(void);
+void SystickTime_Increase(void);
+/*
+ *  @brief 上电以来的毫秒数, 约49天回绕, 比较先后请用差值: (int32_t)(a - b) < 0
+ */
+uint32_t SystickTime_Get(void);
 /*
  *  @brief MODBU协议要求的CRC16校验
  */
@@ -0,0 +1,249 @@
+#include <string.h>
+#include <stdio.h>
+#include <stdint.h>
+#include "stm32f10x.h"
+#include "usart2.h"
+#include "HTTP_Demo.h"
+#include "HTTP_Bulk.h"
+
+#if HTTP_BULK_CHUNK < HTTP_TEMPLATE_LEN
+#error "HTTP_BULK_CHUNK must hold the whole request header (HTTP_TEMPLATE_LEN)"
+#endif
+
+/*
+ *  积压区: 断线期间没能上传的带时间的批次, 恢复后按OneNET的
+ *  {"datastreams":[{"id":..,"datapoints":[{"at":..,"value":..}]}]}格式批量补传
+ */
+static HTTP_Batch http_backlog[HTTP_BACKLOG_LEN];
+static int http_backlog_head = 0;
+static int http_backlog_num = 0;
+static HTTP_Template http_bulk_tmpl;    //json上传用的模板
+static int http_bulk_inflight = 0;      //在途的批量上传带的批次数, 即积压区最前面的这么多个
+
+/*
+ *  正文输出: 先以send = 0空跑一遍量出长度, 再以send = 1边生成边分块发出
+ */
+typedef struct
+{
+    char buf[HTTP_BULK_CHUNK];
+    uint32_t len;
+    uint32_t total;
+    uint8_t send;
+} HTTP_Stream;
+
+/**
+  * @brief   生成批量上传的请求模板, 由HTTP_Init调用
+  */
+int HTTP_BulkInit(const char *key, const char *devid)
+{
+    return HTTP_TemplateInit(&http_bulk_tmpl, key, devid, "");
+}
+
+/**
+  * @brief   批次转入积压区, 满了丢弃最旧的
+  */
+void HTTP_BacklogAdd(const HTTP_Batch *batch)
+{
+    if(http_backlog_num == HTTP_BACKLOG_LEN)
+    {
+        printf("%s: backlog full, drop oldest batch\r\n", __func__);
+        http_backlog_head = (http_backlog_head + 1) % HTTP_BACKLOG_LEN;
+        http_backlog_num--;
+        if(http_bulk_inflight)
+            http_bulk_inflight--;
+    }
+    http_backlog[(http_backlog_head + http_backlog_num) % HTTP_BACKLOG_LEN] = *batch;
+    http_backlog_num++;
+}
+
+/**
+  * @brief   积压区中的批次数
+  */
+int HTTP_BacklogNum(void)
+{
+    return http_backlog_num;
+}
+
+static void HTTP_Emit(HTTP_Stream *s, const char *data, uint32_t n)
+{
+    uint32_t room;
+
+    s->total += n;
+    if(!s->send)
+        return;
+    while(n)
+    {
+        room = HTTP_BULK_CHUNK - s->len;
+        if(room > n)
+            room = n;
+        memcpy(s->buf + s->len, data, room);
+        s->len += room;
+        data += room;
+        n -= room;
+        if(s->len == HTTP_BULK_CHUNK)
+        {
+            USART2_Write(USART2, (unsigned char *)s->buf, s->len);
+            s->len = 0;
+        }
+    }
+}
+#define HTTP_EMIT_LIT(s, lit)   HTTP_Emit(s, lit, sizeof(lit) - 1)
+
+/* UTC秒 -> "2018-01-01T08:00:00"(HTTP_TZ_OFFSET时区) */
+static void HTTP_FormatAt(char *out, uint32_t t)
+{
+    uint32_t days, era, doe, yoe, doy, mp, y, m, d;
+
+    t += HTTP_TZ_OFFSET;
+    days = t / 86400 + 719468;
+    era = days / 146097;
+    doe = days - era * 146097;
+    yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    mp = (5 * doy + 2) / 153;
+    d = doy - (153 * mp + 2) / 5 + 1;
+    m = mp < 10 ? mp + 3 : mp - 9;
+    y = yoe + era * 400 + (m <= 2);
+    t %= 86400;
+    sprintf(out, "%04u-%02u-%02uT%02u:%02u:%02u", (unsigned)y, (unsigned)m, (unsigned)d,
+            (unsigned)(t / 3600), (unsigned)(t / 60 % 60), (unsigned)(t % 60));
+}
+
+/* 数值原样输出, 其它按字符串加引号 */
+static int HTTP_IsNumber(const char *val)
+{
+    if(*val == 0)
+        return 0;
+    for(; *val; val++)
+    {
+        if(!strchr("-+.0123456789eE", *val))
+            return 0;
+    }
+    return 1;
+}
+
+/* 按数据流分组输出积压区前count个批次 */
+static void HTTP_EmitBody(HTTP_Stream *s, int count, const char **ids, int nid)
+{
+    const HTTP_Batch *batch;
+    char at[24];
+    int i, j, k, first;
+
+    HTTP_EMIT_LIT(s, "{\"datastreams\":[");
+    for(i = 0; i < nid; i++)
+    {
+        if(i)
+            HTTP_EMIT_LIT(s, ",");
+        HTTP_EMIT_LIT(s, "{\"id\":\"");
+        HTTP_Emit(s, ids[i], strlen(ids[i]));
+        HTTP_EMIT_LIT(s, "\",\"datapoints\":[");
+        first = 1;
+        for(j = 0; j < count; j++)
+        {
+            batch = &http_backlog[(http_backlog_head + j) % HTTP_BACKLOG_LEN];
+            for(k = 0; k < batch->num && strcmp(batch->dsid[k], ids[i]); k++);
+            if(k == batch->num)
+                continue;
+            HTTP_FormatAt(at, batch->at);
+            HTTP_Emit(s, first ? "{\"at\":\"" : ",{\"at\":\"", first ? 7 : 8);
+            HTTP_Emit(s, at, 19);
+            HTTP_EMIT_LIT(s, "\",\"value\":");
+            if(HTTP_IsNumber(batch->val[k]))
+                HTTP_Emit(s, batch->val[k], strlen(batch->val[k]));
+            else
+            {
+                HTTP_EMIT_LIT(s, "\"");
+                HTTP_Emit(s, batch->val[k], strlen(batch->val[k]));
+                HTTP_EMIT_LIT(s, "\"");
+            }
+            HTTP_EMIT_LIT(s, "}");
+            first = 0;
+        }
+        HTTP_EMIT_LIT(s, "]}");
+    }
+    HTTP_EMIT_LIT(s, "]}");
+}
+
+/**
+  * @brief   把积压区最旧的一批数据点打成一个带时间戳的json POST, 流式发送
+  *          正文长度先空跑算出, 正文直接从积压区生成, 不需要整包缓存
+  *	@param 	 timeOut 等待响应的最长时间, ms
+  * @retval  移出积压区的批次数. 还有请求在途时不发送, 返回0
+  */
+int HTTP_BulkUpload(int timeOut)
+{
+    static HTTP_Stream stream;
+    const HTTP_Batch *batch;
+    const char *ids[HTTP_BULK_MAX_STREAMS];
+    int count, nid = 0, i, j;
+    uint32_t body_len;
+
+    if(HTTP_Busy())
+        return 0;
+
+    //选出本次上传的批次, 数据流个数超出时截断到前一个批次
+    for(count = 0; count < http_backlog_num && count < HTTP_BULK_MAX_BATCHES; count++)
+    {
+        batch = &http_backlog[(http_backlog_head + count) % HTTP_BACKLOG_LEN];
+        for(i = 0; i < batch->num; i++)
+        {
+            for(j = 0; j < nid && strcmp(ids[j], batch->dsid[i]); j++);
+            if(j == nid)
+            {
+                if(nid == HTTP_BULK_MAX_STREAMS)
+                    break;
+                ids[nid++] = batch->dsid[i];
+            }
+        }
+        if(i < batch->num)
+            break;
+    }
+    if(count == 0)
+        return 0;
+
+    stream.send = 0;
+    stream.total = 0;
+    HTTP_EmitBody(&stream, count, ids, nid);
+    body_len = stream.total;
+
+    //请求头放进分块缓存开头, 正文紧随其后分块发出, 缓存只需放得下头部
+    stream.len = HTTP_TemplateRenderHead(&http_bulk_tmpl, stream.buf, sizeof(stream.buf), body_len);
+    if(stream.len == 0)
+        return 0;
+    stream.send = 1;
+    stream.total = 0;
+    USART2_Clear();
+    HTTP_EmitBody(&stream, count, ids, nid);
+    if(stream.len)
+        USART2_Write(USART2, (unsigned char *)stream.buf, stream.len);
+    printf("bulk upload %d batch(es), body %d bytes\r\n", count, body_len);
+
+    http_bulk_inflight = count;
+    HTTP_InflightAdd(0);
+    return HTTP_Collect(timeOut);
+}
+
+/**
+  * @brief   批量上传的响应, 由HTTP_Collect调用
+  *	@param 	 result 1成功, 0服务器拒绝, -1等不到响应
+  * @retval  移出积压区的批次数. 拒绝HTTP_MAX_RETRY次后这些批次被丢弃;
+  *          等不到响应时数据保留, 带时间戳的数据点重传只会覆盖同一时刻的值
+  */
+int HTTP_BulkDone(int result)
+{
+    int count = http_bulk_inflight;
+
+    http_bulk_inflight = 0;
+    if(result < 0 || count == 0)    //count为0: 这些批次等待期间已因积压区满被丢弃
+        return 0;
+    if(result == 0)
+    {
+        //服务器拒绝: 计在最旧的批次上, 超过重试次数整批丢弃
+        if(++http_backlog[http_backlog_head].retry < HTTP_MAX_RETRY)
+            return 0;
+        printf("%s: bulk upload failed %d times, dropped\r\n", __func__, HTTP_MAX_RETRY);
+    }
+    http_backlog_head = (http_backlog_head + count) % HTTP_BACKLOG_LEN;
+    http_backlog_num -= count;
+    return count;
+}
@@ -0,0 +1,19 @@
+#ifndef __HTTP_BULK_H__
+#define __HTTP_BULK_H__
+
+#include <stdint.h>
+#include "HTTP_Demo.h"
+
+#define HTTP_BACKLOG_LEN        64      //积压区能存的批次数, 满了丢最旧的
+#define HTTP_BULK_MAX_BATCHES   32      //一次批量上传最多带的批次数
+#define HTTP_BULK_MAX_STREAMS   8       //一次批量上传最多带的数据流个数
+#define HTTP_BULK_CHUNK         256     //流式发送的分块大小, 须不小于HTTP_TEMPLATE_LEN
+#define HTTP_TZ_OFFSET          (8 * 3600)  //"at"按北京时间填写
+
+extern int HTTP_BulkInit(const char *key, const char *devid);
+extern void HTTP_BacklogAdd(const HTTP_Batch *batch);
+extern int HTTP_BacklogNum(void);
+extern int HTTP_BulkUpload(int timeOut);
+extern int HTTP_BulkDone(int result);
+
+#endif
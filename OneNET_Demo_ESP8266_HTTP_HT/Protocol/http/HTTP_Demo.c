@@ -1,40 +1,446 @@
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <stdint.h>
+#include "stm32f10x.h"
+#include "usart2.h"
+#include "utils.h"
+#include "HTTP_Demo.h"
+#include "HTTP_Parser.h"
+#include "HTTP_Bulk.h"
+
+static HTTP_Template http_type5_tmpl;     //type=5上传用的模板
+
+/*
+ *  软件时钟: 用服务器响应的Date头对时, 之后按SystickTime推算, 毫秒计数约49天回绕, 期间总会再对时
+ */
+static uint32_t http_clock = 0;             //对时时的UTC秒, 0表示还没对过时
+static uint32_t http_clock_tick;            //对时时的SystickTime
 
 /**
-  * @brief   组HTTP POST报文
-  * @param   pkt   报文缓存指针
+  * @brief   用服务器时间对时
+  */
+void HTTP_ClockSync(uint32_t utc)
+{
+    http_clock = utc;
+    http_clock_tick = SystickTime_Get();
+}
+
+/**
+  * @brief   当前UTC秒数, 还没对时返回0
+  */
+uint32_t HTTP_Time(void)
+{
+    if(http_clock == 0)
+        return 0;
+    return http_clock + (SystickTime_Get() - http_clock_tick) / 1000;
+}
+
+/* 在[*p, end)追加n字节, 空间不够返回-1 */
+static int HTTP_Append(char **p, const char *end, const char *s, uint32_t n)
+{
+    if(n > (uint32_t)(end - *p))
+        return -1;
+    memcpy(*p, s, n);
+    *p += n;
+    return 0;
+}
+#define HTTP_APPEND_LIT(p, end, lit)    HTTP_Append(p, end, lit, sizeof(lit) - 1)
+
+/**
+  * @brief   生成请求头模板, 设备ID和API_KEY只在这里写入一次
+  * @param   t     模板
+  * @param   key   API_KEY
+  *	@param 	 devid 设备ID
+  *	@param 	 query datapoints后面的查询串, 如"?type=5", 可为""
+  * @retval  0成功, -1模板缓存不够
+  */
+int HTTP_TemplateInit(HTTP_Template *t, const char *key, const char *devid, const char *query)
+{
+    char *p = t->buf;
+    const char *end = t->buf + HTTP_TEMPLATE_LEN;
+    int ret = 0;
+
+    ret |= HTTP_APPEND_LIT(&p, end, "POST /devices/");
+    ret |= HTTP_Append(&p, end, devid, strlen(devid));
+    ret |= HTTP_APPEND_LIT(&p, end, "/datapoints");
+    ret |= HTTP_Append(&p, end, query, strlen(query));
+    ret |= HTTP_APPEND_LIT(&p, end, " HTTP/1.1\r\napi-key:");
+    ret |= HTTP_Append(&p, end, key, strlen(key));
+    ret |= HTTP_APPEND_LIT(&p, end, "\r\nHost:api.heclouds.com\r\nConnection:keep-alive\r\nContent-Length:");
+    t->cl_pos = p - t->buf;
+    //数字槽先填空格, 长度右对齐写入, 前导空格是合法的头部空白
+    ret |= HTTP_Append(&p, end, "          ", HTTP_CL_DIGITS);
+    ret |= HTTP_APPEND_LIT(&p, end, "\r\n\r\n");
+    t->len = ret ? 0 : p - t->buf;    //生成失败的模板长度为0, 渲染时拒绝
+    return ret ? -1 : 0;
+}
+
+/**
+  * @brief   只把请求头写到缓存开头并填入正文长度, 正文由调用者另外发送(如分块流式发送)
+  * @param   pkt      请求头缓存
+  * @param   size     请求头缓存大小
+  * @param   body_len 正文长度
+  * @retval  请求头长度; 模板未生成、请求头放不下或长度超过槽位时返回0
+  */
+uint32_t HTTP_TemplateRenderHead(const HTTP_Template *t, char *pkt, uint32_t size, uint32_t body_len)
+{
+    char *digit;
+
+    if(t->len == 0 || body_len > HTTP_CL_MAX || t->len > size)
+        return 0;
+
+    memcpy(pkt, t->buf, t->len);
+    digit = pkt + t->cl_pos + HTTP_CL_DIGITS;
+    do
+    {
+        *--digit = '0' + body_len % 10;
+        body_len /= 10;
+    }
+    while(body_len);
+    return t->len;
+}
+
+/**
+  * @brief   把模板复制到报文开头, 并填入正文长度
+  * @param   pkt      报文缓存
+  * @param   size     报文缓存大小
+  * @param   body_len 正文长度
+  * @retval  请求头长度, 正文之后紧接着写; 模板未生成、头加正文放不下或长度超过槽位时返回0
+  */
+uint32_t HTTP_TemplateRender(const HTTP_Template *t, char *pkt, uint32_t size, uint32_t body_len)
+{
+    if(t->len + body_len < body_len || t->len + body_len > size)
+        return 0;
+    return HTTP_TemplateRenderHead(t, pkt, size, body_len);
+}
+
+/**
+  * @brief   生成上传用的请求模板, 发送前调用一次
   * @param   key   API_KEY定义在Main.c文件中，需要根据自己的设备修改
   *	@param 	 devid 设备ID，定义在main.c文件中，需要根据自己的设备修改
+  * @retval  0成功, -1设备ID或API_KEY太长
+  */
+int HTTP_Init(const char *key, const char *devid)
+{
+    if(HTTP_TemplateInit(&http_type5_tmpl, key, devid, "?type=5"))
+        return -1;
+    return HTTP_BulkInit(key, devid);
+}
+
+/**
+  * @brief   组HTTP POST报文, 单个数据流
+  * @param   pkt   报文缓存指针
+  * @param   size  报文缓存大小
   *	@param 	 dsid  数据流ID
   *	@param 	 val   字符串形式的数据点的值
-  * @retval  整个包的长度
+  * @retval  整个包的长度, 缓存不够时返回0
   */
-uint32_t HTTP_PostPkt(char *pkt, char *key, char *devid, char *dsid, char *val)
+uint32_t HTTP_PostPkt(char *pkt, uint32_t size, const char *dsid, const char *val)
 {
-    char dataBuf[100] = {0};
-    char lenBuf[10] = {0};
-    *pkt = 0;
+    uint32_t dsid_len = strlen(dsid), val_len = strlen(val);
+    uint32_t body_len = 2 + dsid_len + 1 + val_len;     //采用分割字符串格式:type = 5, ",;dsid,val"
+    uint32_t len;
+    char *p;
 
-    sprintf(dataBuf, ",;%s,%s", dsid, val);     //采用分割字符串格式:type = 5
-    sprintf(lenBuf, "%d", strlen(dataBuf));
+    len = HTTP_TemplateRender(&http_type5_tmpl, pkt, size, body_len);
+    if(len == 0)
+        return 0;
+    p = pkt + len;
+    memcpy(p, ",;", 2);
+    memcpy(p + 2, dsid, dsid_len);
+    p[2 + dsid_len] = ',';
+    memcpy(p + 3 + dsid_len, val, val_len);
+    return len + body_len;
+}
 
-    strcat(pkt, "POST /devices/");
-    strcat(pkt, devid);
-    strcat(pkt, "/datapoints?type=5 HTTP/1.1\r\n");
+/**
+  * @brief   清空一个批次, 采样时间记为当前时间
+  */
+void HTTP_BatchInit(HTTP_Batch *batch)
+{
+    batch->num = 0;
+    batch->retry = 0;
+    batch->at = HTTP_Time();
+}
 
-    strcat(pkt, "api-key:");
-    strcat(pkt, key);
-    strcat(pkt, "\r\n");
+/**
+  * @brief   向批次中加入一个数据点
+  *	@param 	 dsid  数据流ID, 只保存指针, 须为常量字符串
+  *	@param 	 val   字符串形式的数据点的值, 会被复制
+  * @retval  0成功, -1批次已满或值太长
+  */
+int HTTP_BatchAdd(HTTP_Batch *batch, const char *dsid, const char *val)
+{
+    if(batch->num >= HTTP_BATCH_MAX_STREAMS || strlen(val) >= HTTP_VAL_LEN)
+        return -1;
+
+    batch->dsid[batch->num] = dsid;
+    strcpy(batch->val[batch->num], val);
+    batch->num++;
+    return 0;
+}
 
-    strcat(pkt, "Host:api.heclouds.com\r\n");
+/**
+  * @brief   把一个批次的所有数据流组成一个HTTP POST报文, 长连接
+  * @param   pkt   报文缓存指针
+  * @param   size  报文缓存大小
+  *	@param 	 batch 本次上传的数据点
+  * @retval  整个包的长度, 缓存不够时返回0
+  */
+uint32_t HTTP_PostBatchPkt(char *pkt, uint32_t size, const HTTP_Batch *batch)
+{
+    uint32_t dsid_len[HTTP_BATCH_MAX_STREAMS], val_len[HTTP_BATCH_MAX_STREAMS];
+    uint32_t body_len = 1, len;
+    char *p;
+    int i;
+
+    //采用分割字符串格式:type = 5, ","之后每个数据流为";dsid,val". 先算出正文长度, 再一遍写完
+    for(i = 0; i < batch->num; i++)
+    {
+        dsid_len[i] = strlen(batch->dsid[i]);
+        val_len[i] = strlen(batch->val[i]);
+        body_len += 1 + dsid_len[i] + 1 + val_len[i];
+    }
+    len = HTTP_TemplateRender(&http_type5_tmpl, pkt, size, body_len);
+    if(len == 0)
+        return 0;
+
+    p = pkt + len;
+    *p++ = ',';
+    for(i = 0; i < batch->num; i++)
+    {
+        *p++ = ';';
+        memcpy(p, batch->dsid[i], dsid_len[i]);
+        p += dsid_len[i];
+        *p++ = ',';
+        memcpy(p, batch->val[i], val_len[i]);
+        p += val_len[i];
+    }
+    return len + body_len;
+}
+
+/*
+ *  待上传批次队列, 发送失败的批次留在队列里, 下次和新批次一起连发
+ */
+static HTTP_Batch http_queue[HTTP_QUEUE_LEN];
+static int http_queue_head = 0;
+static int http_queue_num = 0;
+static char http_pkt_buf[HTTP_PKT_BUF_LEN];
+
+/**
+  * @brief   批次入队, 队列满时最旧的批次转入积压区, 恢复连接后批量补传
+  */
+void HTTP_Queue(const HTTP_Batch *batch)
+{
+    if(http_queue_num == HTTP_QUEUE_LEN)
+    {
+        if(http_queue[http_queue_head].at)
+            HTTP_BacklogAdd(&http_queue[http_queue_head]);
+        else
+            printf("%s: queue full, drop oldest batch\r\n", __func__);
+        http_queue_head = (http_queue_head + 1) % HTTP_QUEUE_LEN;
+        http_queue_num--;
+    }
+    http_queue[(http_queue_head + http_queue_num) % HTTP_QUEUE_LEN] = *batch;
+    http_queue_num++;
+}
+
+/**
+  * @brief   队列中待上传的批次数
+  */
+int HTTP_QueueNum(void)
+{
+    return http_queue_num;
+}
+
+/*
+ *  已发出还没收到响应的请求, 按发送顺序排列. 同一连接上的响应按请求顺序返回, 第i个响应属于第i个请求;
+ *  有请求在途时不发新请求, 所以迟到的响应只会记到它自己的请求上, 不会被算给重发的请求
+ */
+typedef struct
+{
+    HTTP_Batch batch;       //type=5请求的批次, 从队列中移出后由这里保管
+    uint8_t bulk;           //批量补传请求, 批次留在积压区里
+} HTTP_Inflight;
+
+static HTTP_Inflight http_inflight[HTTP_PIPELINE_MAX];
+static int http_inflight_num = 0;
+static int http_inflight_done = 0;          //已收到响应的请求数
+static uint32_t http_inflight_time;         //发出时的SystickTime
+static HTTP_Parser http_parser;             //跨HTTP_Collect调用保持, 响应可以分几次收完
+
+/**
+  * @brief   还有没收到响应的请求, 此时不能发新请求
+  */
+int HTTP_Busy(void)
+{
+    return http_inflight_num;
+}
+
+/**
+  * @brief   记录一个刚发出的请求, 须在HTTP_Busy()为0时USART2_Clear后发出
+  *	@param 	 batch  type=5请求的批次, 0表示批量补传请求
+  */
+void HTTP_InflightAdd(const HTTP_Batch *batch)
+{
+    HTTP_Inflight *req = &http_inflight[http_inflight_num++];
+
+    if(batch)
+        req->batch = *batch;
+    req->bulk = (batch == 0);
+    if(http_inflight_num == 1)
+        HTTP_ParserInit(&http_parser);
+    http_inflight_time = SystickTime_Get();
+}
+
+/*
+ *  一个type=5批次没能重发时的去处: 队列满时它比队列里的都旧, 按HTTP_Queue的规则转入积压区或丢弃
+ */
+static void HTTP_Requeue(const HTTP_Batch *batch)
+{
+    if(http_queue_num == HTTP_QUEUE_LEN)
+    {
+        if(batch->at)
+            HTTP_BacklogAdd(batch);
+        else
+            printf("%s: queue full, drop batch\r\n", __func__);
+        return;
+    }
+    http_queue_head = (http_queue_head + HTTP_QUEUE_LEN - 1) % HTTP_QUEUE_LEN;
+    http_queue[http_queue_head] = *batch;
+    http_queue_num++;
+}
+
+/*
+ *  按结果处理一个请求: result 1成功, 0服务器拒绝, -1等不到响应
+ *  返回上传成功的批次数
+ */
+static int HTTP_Finish(HTTP_Inflight *req, int result)
+{
+    HTTP_Batch *batch = &req->batch;
+
+    if(req->bulk)
+        return HTTP_BulkDone(result);
+    if(result > 0)
+        return 1;
+    if(result == 0)
+    {
+        if(++batch->retry < HTTP_MAX_RETRY)
+            HTTP_Requeue(batch);
+        else
+            printf("%s: batch failed %d times, dropped\r\n", __func__, batch->retry);
+    }
+    else if(batch->at)
+    {
+        //服务器可能已经收下: 不再用type=5重发(会以服务器时间再存一份), 改由积压区带原采样时间补传
+        HTTP_BacklogAdd(batch);
+    }
+    else
+    {
+        printf("%s: no response, batch dropped\r\n", __func__);
+    }
+    return 0;
+}
+
+/* 把串口已收到的数据直接在接收环形缓冲区里喂给解析器, 每个完整的响应交给对应的请求, 返回上传成功的批次数 */
+static int HTTP_FeedRcv(void)
+{
+    const uint8_t *p;
+    uint32_t len, n;
+    int succ = 0;
+
+    while(http_inflight_done < http_inflight_num && http_parser.state != HTTP_PARSE_ERROR
+          && (len = Ring_ReadSpan(&usart2_rcv_ring, &p)) > 0)
+    {
+        n = HTTP_ParserFeed(&http_parser, (const char *)p, len);
+        Ring_Consume(&usart2_rcv_ring, n);      //没消耗的字节属于下一个响应
+        if(http_parser.state == HTTP_PARSE_DONE)
+        {
+            if(http_parser.date)
+                HTTP_ClockSync(http_parser.date);
+            printf("HTTP response %d: status %d, errno %d\r\n", http_inflight_done + 1,
+                   http_parser.status, (int)http_parser.err_no);
+            succ += HTTP_Finish(&http_inflight[http_inflight_done++], HTTP_ParserSuccess(&http_parser));
+            HTTP_ParserInit(&http_parser);
+        }
+    }
+    return succ;
+}
+
+/**
+  * @brief   等待在途请求的响应, 边收边解析, 全部到齐立即返回; 没到齐的下次调用接着等
+  *          发出后HTTP_RESP_GIVEUP内还没到齐或响应无法解析时认为连接已断, 剩下的请求按没有响应处理
+  *	@param 	 timeOut 本次最长等待时间, ms
+  * @retval  本次上传成功的批次数
+  */
+int HTTP_Collect(int timeOut)
+{
+    uint32_t start = SystickTime_Get();
+    int succ = 0;
+
+    while(http_inflight_done < http_inflight_num)
+    {
+        succ += HTTP_FeedRcv();
+        if(http_inflight_done == http_inflight_num)
+            break;
+        if(http_parser.state == HTTP_PARSE_ERROR
+           || (int32_t)(SystickTime_Get() - http_inflight_time) >= HTTP_RESP_GIVEUP)
+        {
+            printf("%s: %d of %d response(s) missing, give up\r\n", __func__,
+                   http_inflight_num - http_inflight_done, http_inflight_num);
+            while(http_inflight_done < http_inflight_num)
+                succ += HTTP_Finish(&http_inflight[http_inflight_done++], -1);
+            USART2_Clear();
+            break;
+        }
+        if((int32_t)(SystickTime_Get() - start) >= timeOut)
+            break;
+        mDelay(10);
+    }
+    if(http_inflight_done == http_inflight_num)
+        http_inflight_num = http_inflight_done = 0;
+    return succ;
+}
+
+/**
+  * @brief   把队列中的批次在长连接上连发出去(pipelining), 边收边解析响应
+  *          上次发出的请求还有响应没到时不发新请求, 只接着等那些响应
+  *	@param 	 timeOut 等待响应的最长时间, ms
+  * @retval  本次上传成功的批次数. 被拒绝的批次回到队列重试, HTTP_MAX_RETRY次后丢弃;
+  *          等不到响应的批次服务器可能已经收下, 不再重发, 带采样时间的转入积压区补传
+  */
+int HTTP_Flush(int timeOut)
+{
+    uint32_t len = 0, pkt_len;
+    int sent = 0;
 
-    strcat(pkt, "Content-Length:");
-    strcat(pkt, lenBuf);
-    strcat(pkt, "\r\n\r\n");
+    if(!HTTP_Busy())
+    {
+        //尽量多的批次拼进一次发送
+        while(sent < http_queue_num && sent < HTTP_PIPELINE_MAX)
+        {
+            pkt_len = HTTP_PostBatchPkt(http_pkt_buf + len, HTTP_PKT_BUF_LEN - len,
+                                        &http_queue[(http_queue_head + sent) % HTTP_QUEUE_LEN]);
+            if(pkt_len == 0)
+                break;
+            len += pkt_len;
+            sent++;
+        }
+        if(sent == 0)
+            return 0;
 
-    strcat(pkt, dataBuf);
+        USART2_Clear();
+        USART2_Write(USART2, (unsigned char *)http_pkt_buf, len);
+        printf("send %d HTTP request(s), %d bytes\r\n", sent, len);
 
-    return strlen(pkt);
+        //发出的批次移出队列, 由在途请求保管到响应到来
+        while(sent--)
+        {
+            HTTP_InflightAdd(&http_queue[http_queue_head]);
+            http_queue_head = (http_queue_head + 1) % HTTP_QUEUE_LEN;
+            http_queue_num--;
+        }
+    }
+    return HTTP_Collect(timeOut);
 }
@@ -1 +1,60 @@
-extern uint32 HTTP_PostPkt(u8 *pkt, char *key, char *devid, char *dsid, char *val);
\ No newline at end of file
+#ifndef __HTTP_DEMO_H__
+#define __HTTP_DEMO_H__
+
+#include <stdint.h>
+
+#define HTTP_BATCH_MAX_STREAMS  4       //一次POST最多携带的数据流个数
+#define HTTP_VAL_LEN            12      //字符串形式数据点值的最大长度(含结束符)
+#define HTTP_QUEUE_LEN          4       //待上传批次队列长度, 满了丢最旧的
+#define HTTP_PIPELINE_MAX       3       //一次连发的请求数, 受usart2_rcv_ring能容纳的响应数限制
+#define HTTP_PKT_BUF_LEN        1024    //连发报文缓存
+#define HTTP_MAX_RETRY          3       //服务器返回失败时一个批次最多重发的次数
+#define HTTP_RESP_GIVEUP        10000   //请求发出后这么久(ms)响应还没到齐, 认为连接已断
+#define HTTP_TEMPLATE_LEN       192     //请求头模板缓存
+#define HTTP_CL_DIGITS          5       //模板中Content-Length数字槽的宽度
+#define HTTP_CL_MAX             99999   //槽位能表示的最大正文长度
+
+/*
+ *  一个采集周期的全部数据点, 打成一个type=5的POST
+ */
+typedef struct
+{
+    uint8_t num;
+    uint8_t retry;                              //已被服务器拒绝的次数
+    uint32_t at;                                //采样时间, UTC秒, 0表示未知
+    const char *dsid[HTTP_BATCH_MAX_STREAMS];   //数据流ID, 须为常量字符串
+    char val[HTTP_BATCH_MAX_STREAMS][HTTP_VAL_LEN];
+} HTTP_Batch;
+
+/*
+ *  预先生成的请求头: 请求行, api-key, Host等每次都一样, 只有Content-Length需要按正文填写
+ */
+typedef struct
+{
+    char buf[HTTP_TEMPLATE_LEN];
+    uint16_t len;               //请求头总长, 含结尾空行
+    uint16_t cl_pos;            //Content-Length数字槽在buf中的位置
+} HTTP_Template;
+
+extern int HTTP_TemplateInit(HTTP_Template *t, const char *key, const char *devid, const char *query);
+extern uint32_t HTTP_TemplateRenderHead(const HTTP_Template *t, char *pkt, uint32_t size, uint32_t body_len);
+extern uint32_t HTTP_TemplateRender(const HTTP_Template *t, char *pkt, uint32_t size, uint32_t body_len);
+
+extern int HTTP_Init(const char *key, const char *devid);
+extern uint32_t HTTP_PostPkt(char *pkt, uint32_t size, const char *dsid, const char *val);
+
+extern void HTTP_BatchInit(HTTP_Batch *batch);
+extern int HTTP_BatchAdd(HTTP_Batch *batch, const char *dsid, const char *val);
+extern uint32_t HTTP_PostBatchPkt(char *pkt, uint32_t size, const HTTP_Batch *batch);
+
+extern void HTTP_Queue(const HTTP_Batch *batch);
+extern int HTTP_QueueNum(void);
+extern int HTTP_Flush(int timeOut);
+extern int HTTP_Busy(void);
+extern void HTTP_InflightAdd(const HTTP_Batch *batch);
+extern int HTTP_Collect(int timeOut);
+
+extern void HTTP_ClockSync(uint32_t utc);
+extern uint32_t HTTP_Time(void);
+
+#endif
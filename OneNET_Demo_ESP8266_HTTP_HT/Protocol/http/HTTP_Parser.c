@@ -0,0 +1,288 @@
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "HTTP_Parser.h"
+
+/* errno扫描状态 */
+#define ERR_KEY     0   //匹配 "errno"
+#define ERR_COLON   1   //等待':'
+#define ERR_VALUE   2   //等待数值开始
+#define ERR_DIGITS  3   //读数字
+#define ERR_END     4   //已取到errno
+
+static const char err_key[] = "\"errno\"";
+
+/**
+  * @brief   准备解析一个新的响应
+  */
+void HTTP_ParserInit(HTTP_Parser *p)
+{
+    memset(p, 0, sizeof(HTTP_Parser));
+    p->state = HTTP_PARSE_STATUS;
+}
+
+/* 不区分大小写比较头部名称, name须为小写 */
+static int HTTP_HeaderIs(const char *line, const char *name)
+{
+    while(*name)
+    {
+        if((*line | 0x20) != *name)
+            return 0;
+        line++;
+        name++;
+    }
+    return 1;
+}
+
+/* 1970-01-01到y-m-d的天数(公历) */
+static uint32_t HTTP_Days(int y, int m, int d)
+{
+    uint32_t era, yoe, doy;
+
+    y -= m <= 2;
+    era = y / 400;
+    yoe = y - era * 400;
+    doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    return era * 146097 + yoe * 365 + yoe / 4 - yoe / 100 + doy - 719468;
+}
+
+/* 解析"Sun, 06 Nov 1994 08:49:37 GMT", 失败返回0 */
+static uint32_t HTTP_ParseDate(const char *s)
+{
+    static const char months[] = "janfebmaraprmayjunjulaugsepoctnovdec";
+    int d, m, y, hh, mm, ss;
+    char *end;
+
+    s = strchr(s, ',');
+    if(s == NULL)
+        return 0;
+    d = strtol(s + 1, &end, 10);
+    while(*end == ' ')
+        end++;
+    for(m = 0; m < 12; m++)
+    {
+        if((end[0] | 0x20) == months[m * 3] && (end[1] | 0x20) == months[m * 3 + 1] && (end[2] | 0x20) == months[m * 3 + 2])
+            break;
+    }
+    if(m == 12)
+        return 0;
+    y = strtol(end + 3, &end, 10);
+    hh = strtol(end, &end, 10);
+    if(*end++ != ':')
+        return 0;
+    mm = strtol(end, &end, 10);
+    if(*end++ != ':')
+        return 0;
+    ss = strtol(end, &end, 10);
+    if(y < 1970 || d < 1 || d > 31)
+        return 0;
+    return HTTP_Days(y, m + 1, d) * 86400 + hh * 3600 + mm * 60 + ss;
+}
+
+/* 正文字节: 从OneNET的json应答里找出"errno":<整数> */
+static void HTTP_ScanErrno(HTTP_Parser *p, char c)
+{
+    switch(p->err_state)
+    {
+    case ERR_KEY:
+        if(c == err_key[p->err_match])
+        {
+            if(++p->err_match == sizeof(err_key) - 1)
+                p->err_state = ERR_COLON;
+        }
+        else
+        {
+            p->err_match = (c == '"') ? 1 : 0;
+        }
+        break;
+    case ERR_COLON:
+        if(c == ':')
+            p->err_state = ERR_VALUE;
+        else if(c != ' ')
+            p->err_state = ERR_KEY, p->err_match = 0;
+        break;
+    case ERR_VALUE:
+        if(c == '-')
+        {
+            p->err_neg = 1;
+        }
+        else if(c >= '0' && c <= '9')
+        {
+            p->err_no = c - '0';
+            p->err_state = ERR_DIGITS;
+        }
+        else if(c != ' ')
+        {
+            p->err_state = ERR_KEY, p->err_match = 0;
+        }
+        break;
+    case ERR_DIGITS:
+        if(c >= '0' && c <= '9')
+        {
+            //超长的数字饱和到INT32_MAX, 仍然是非0的错误码
+            if(p->err_no <= (INT32_MAX - 9) / 10)
+                p->err_no = p->err_no * 10 + (c - '0');
+            else
+                p->err_no = INT32_MAX;
+            break;
+        }
+        if(p->err_neg)
+            p->err_no = -p->err_no;
+        p->has_errno = 1;
+        p->err_state = ERR_END;
+        break;
+    default:
+        break;
+    }
+}
+
+/* 正文结束 */
+static void HTTP_BodyDone(HTTP_Parser *p)
+{
+    if(p->err_state == ERR_DIGITS)     //数字一直到正文末尾
+        HTTP_ScanErrno(p, 0);
+    p->state = HTTP_PARSE_DONE;
+}
+
+/* 头部结束(空行) */
+static void HTTP_HeadersDone(HTTP_Parser *p)
+{
+    if(p->status >= 100 && p->status < 200)
+    {
+        //1xx临时响应, 后面还有真正的响应
+        p->status = 0;
+        p->chunked = p->has_length = 0;
+        p->state = HTTP_PARSE_STATUS;
+    }
+    else if(p->status == 204 || p->status == 304)
+        p->state = HTTP_PARSE_DONE;
+    else if(p->chunked)
+        p->state = HTTP_PARSE_CHUNK_SIZE;
+    else if(p->has_length && p->remaining)
+        p->state = HTTP_PARSE_BODY;
+    else
+        p->state = HTTP_PARSE_DONE;     //无正文; 不支持靠断开连接结束的正文
+}
+
+/* 一整行(已去掉CRLF, 超长部分被截掉) */
+static void HTTP_Line(HTTP_Parser *p)
+{
+    char *line = p->line;
+    uint32_t size;
+    int n;
+
+    line[p->line_len] = 0;
+    switch(p->state)
+    {
+    case HTTP_PARSE_STATUS:
+        //HTTP/1.1 200 OK
+        if(p->line_len == 0)
+            break;      //响应之间多余的空行
+        if(strncmp(line, "HTTP/1.", 7) != 0 || p->line_len < 12 || line[8] != ' ')
+        {
+            p->state = HTTP_PARSE_ERROR;
+            break;
+        }
+        p->status = atoi(line + 9);
+        p->state = HTTP_PARSE_HEADER;
+        break;
+    case HTTP_PARSE_HEADER:
+        if(p->line_len == 0)
+            HTTP_HeadersDone(p);
+        else if(HTTP_HeaderIs(line, "content-length:"))
+        {
+            p->has_length = 1;
+            p->remaining = strtoul(line + 15, NULL, 10);
+        }
+        else if(HTTP_HeaderIs(line, "date:"))
+            p->date = HTTP_ParseDate(line + 5);
+        else if(HTTP_HeaderIs(line, "transfer-encoding:"))
+        {
+            for(n = 18; line[n] == ' '; n++);
+            p->chunked = HTTP_HeaderIs(line + n, "chunked");
+        }
+        break;
+    case HTTP_PARSE_CHUNK_SIZE:
+        //十六进制长度, 可能带";ext"
+        size = 0;
+        for(n = 0; line[n]; n++)
+        {
+            if(line[n] >= '0' && line[n] <= '9')
+                size = size * 16 + (line[n] - '0');
+            else if((line[n] | 0x20) >= 'a' && (line[n] | 0x20) <= 'f')
+                size = size * 16 + ((line[n] | 0x20) - 'a' + 10);
+            else
+                break;
+        }
+        if(n == 0)
+            p->state = HTTP_PARSE_ERROR;
+        else if(size == 0)
+            p->state = HTTP_PARSE_TRAILER;
+        else
+        {
+            p->remaining = size;
+            p->state = HTTP_PARSE_CHUNK_DATA;
+        }
+        break;
+    case HTTP_PARSE_CHUNK_END:
+        p->state = p->line_len ? HTTP_PARSE_ERROR : HTTP_PARSE_CHUNK_SIZE;
+        break;
+    case HTTP_PARSE_TRAILER:
+        if(p->line_len == 0)
+            HTTP_BodyDone(p);
+        break;
+    default:
+        break;
+    }
+    p->line_len = 0;
+}
+
+/**
+  * @brief   喂入收到的数据
+  * @param   data  数据, 可从任意位置切分
+  * @param   len   数据长度
+  * @retval  消耗的字节数. 一个响应解析完(HTTP_PARSE_DONE)后立即返回,
+  *          剩下的字节属于下一个响应(pipelining), 调用者HTTP_ParserInit后继续喂
+  */
+uint32_t HTTP_ParserFeed(HTTP_Parser *p, const char *data, uint32_t len)
+{
+    uint32_t i = 0, n;
+
+    while(i < len && p->state != HTTP_PARSE_DONE && p->state != HTTP_PARSE_ERROR)
+    {
+        if(p->state == HTTP_PARSE_BODY || p->state == HTTP_PARSE_CHUNK_DATA)
+        {
+            //正文按块消耗, 只为找errno逐字节扫描
+            n = len - i;
+            if(n > p->remaining)
+                n = p->remaining;
+            p->remaining -= n;
+            while(n--)
+                HTTP_ScanErrno(p, data[i++]);
+            if(p->remaining == 0)
+            {
+                if(p->state == HTTP_PARSE_BODY)
+                    HTTP_BodyDone(p);
+                else
+                    p->state = HTTP_PARSE_CHUNK_END;
+            }
+            continue;
+        }
+
+        if(data[i] == '\n')
+            HTTP_Line(p);
+        else if(data[i] != '\r' && p->line_len < HTTP_LINE_MAX - 1)
+            p->line[p->line_len++] = data[i];
+        i++;
+    }
+    return i;
+}
+
+/**
+  * @brief   响应是否表示上传成功: 状态码2xx, 且正文中的errno(如果有)为0
+  */
+int HTTP_ParserSuccess(const HTTP_Parser *p)
+{
+    return p->state == HTTP_PARSE_DONE && p->status >= 200 && p->status < 300
+           && (!p->has_errno || p->err_no == 0);
+}
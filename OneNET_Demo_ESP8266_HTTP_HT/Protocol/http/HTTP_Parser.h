@@ -0,0 +1,43 @@
+#ifndef __HTTP_PARSER_H__
+#define __HTTP_PARSER_H__
+
+#include <stdint.h>
+
+#define HTTP_LINE_MAX       64      //状态行/头部行只保留前面这么多字节, 够判断需要的几个头
+
+/* 解析状态, HTTP_PARSE_DONE/HTTP_PARSE_ERROR为终止状态 */
+#define HTTP_PARSE_STATUS       0   //状态行
+#define HTTP_PARSE_HEADER       1   //头部行
+#define HTTP_PARSE_BODY         2   //Content-Length正文
+#define HTTP_PARSE_CHUNK_SIZE   3   //chunk长度行
+#define HTTP_PARSE_CHUNK_DATA   4   //chunk数据
+#define HTTP_PARSE_CHUNK_END    5   //chunk数据后的CRLF
+#define HTTP_PARSE_TRAILER      6   //最后一个chunk后的trailer
+#define HTTP_PARSE_DONE         7   //一个完整响应已解析完
+#define HTTP_PARSE_ERROR        8
+
+/*
+ *  HTTP/1.1响应的增量解析器, 数据可以任意切分后分多次喂入, 不申请内存
+ */
+typedef struct
+{
+    uint8_t state;
+    uint8_t chunked;            //Transfer-Encoding: chunked
+    uint8_t has_length;         //收到了Content-Length
+    uint8_t has_errno;          //正文里找到了OneNET的"errno"
+    uint16_t status;            //状态码, 如200
+    uint32_t remaining;         //当前正文/chunk剩余字节数
+    int32_t err_no;             //OneNET正文中的errno, 0表示成功
+    uint32_t date;              //Date头部, 1970-01-01起的UTC秒数, 0表示没有
+    char line[HTTP_LINE_MAX];
+    uint8_t line_len;
+    uint8_t err_state;          //errno扫描状态
+    uint8_t err_match;          //已匹配的"\"errno\""字符数
+    uint8_t err_neg;
+} HTTP_Parser;
+
+extern void HTTP_ParserInit(HTTP_Parser *p);
+extern uint32_t HTTP_ParserFeed(HTTP_Parser *p, const char *data, uint32_t len);
+extern int HTTP_ParserSuccess(const HTTP_Parser *p);
+
+#endif
@@ -32,6 +32,8 @@
 #include "sht20.h"
 #include "hal_i2c.h"
 #include "esp8266.h"
+#include "HTTP_Demo.h"
+#include "HTTP_Bulk.h"
 
 
 #define API_KEY     "DXZcCKxqrpxZJKWFnbMzxIjeITk="		//需要定义为用户自己的参数
@@ -46,11 +48,11 @@
 int main(void)
 {
     uint16_t temp, humi;    //温湿度
-    char HTTP_Buf[400];     //HTTP报文缓存区
-    char tempStr[5];       //字符串格式温度
-    char humiStr[5];       //字符串格式湿度
-    int len;
+    char tempStr[6];       //字符串格式温度
+    char humiStr[6];       //字符串格式湿度
+    HTTP_Batch batch;       //本周期的全部数据点
 
+    SystickTime_Init();     //1ms节拍, mDelay按它计时
     USART1_Config();        //USART1作为调试串口
     USART2_Config();        //USART2用于连接ESP8266模块
     Hal_I2C_Init();			//I2C初始化，用于连接温湿度传感器
@@ -58,6 +60,12 @@ int main(void)
 init:
     ESP8266_Init();         //ESP8266初始化
 	printf("ESP8266 init over\r\n");
+    if(HTTP_Init(API_KEY, DEV_ID))    //请求头模板只生成一次
+    {
+        /* 设备ID或API_KEY是编译期常量, 重试也不会成功, 停在这里等待修改参数 */
+        printf("HTTP_Init failed: API_KEY or DEV_ID too long\r\n");
+        while(1);
+    }
     //SHT20_loop();         //
 	
     while(1)
@@ -73,21 +81,14 @@ init:
 
         //printf("%s   %s\r\n", tempStr, humiStr);
 
-        USART2_Clear();
-        len = HTTP_PostPkt(HTTP_Buf, API_KEY, DEV_ID, "temp", tempStr); //HTTP组包
-        USART2_Write(USART2, (unsigned char *)(HTTP_Buf), len);			//报文发送
-        printf("send HTTP msg:\r\n%s\r\n", HTTP_Buf);
-
-        mDelay(1000);
-        printf("rcv response:\r\n%s\r\n", usart2_rcv_buf);
-
-        USART2_Clear();
-        len = HTTP_PostPkt(HTTP_Buf, API_KEY, DEV_ID, "humi", humiStr); //HTTP组包
-        USART2_Write(USART2, (unsigned char *)(HTTP_Buf), len);			//报文发送
-        printf("send HTTP msg:\r\n%s\r\n", HTTP_Buf);
-
-        mDelay(1000);
-        printf("rcv response:\r\n%s\r\n", usart2_rcv_buf);
+        /* 所有数据流打成一个POST, 在长连接上发送; 未应答的批次下周期和新数据一起连发 */
+        HTTP_BatchInit(&batch);
+        HTTP_BatchAdd(&batch, "temp", tempStr);
+        HTTP_BatchAdd(&batch, "humi", humiStr);
+        HTTP_Queue(&batch);
+        /* 连接恢复后把断线期间积压的带时间数据点批量补传 */
+        if(HTTP_Flush(2000) > 0 && HTTP_BacklogNum() > 0)
+            HTTP_BulkUpload(3000);
 
         mDelay(5000);
     }
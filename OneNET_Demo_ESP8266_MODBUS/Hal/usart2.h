@@ -3,7 +3,9 @@
 #include "stdio.h"
 #include "stdlib.h"
 #include "string.h"
-#define MAX_RCV_LEN 256
+#include "ring.h"
+#define MAX_RCV_LEN 256         /*查找AT应答时最多看的字节数*/
+#define USART2_RCV_RING_LEN 512 /*接收环形缓冲区, 必须是2的幂*/
 
 /*
  *  @brief USART2初始化函数
@@ -13,9 +15,18 @@ extern void USART2_Init(void);
  *  @brief USART2串口发送api
  */
 extern void USART2_Write(USART_TypeDef* USARTx, uint8_t *Data, uint32_t len);
-extern uint8_t  usart2_rcv_buf[MAX_RCV_LEN];
-
-extern volatile uint32_t   usart2_rcv_len;
+/*
+ *  接收数据: 中断写入, 主循环读取. usart2_rcv_ring.overflow为缓冲区满被丢掉的字节数
+ */
+extern Ring usart2_rcv_ring;
+/*
+ *  @brief 丢掉已接收的全部数据, 发AT命令前调用
+ */
+void USART2_RcvClear(void);
+/*
+ *  @brief 在已接收的数据(最多前MAX_RCV_LEN-1字节)中查找字符串, 不取走数据
+ */
+char *USART2_RcvFind(const char *str);
 /*
  *  @brief USART2串口发送AT命令用
  */
@@ -25,7 +36,7 @@ void SendCmd(int8_t* cmd, int8_t* result, int32_t timeOut);
  */
 uint32_t USART2_GetRcvNum(void);
 /*
- *  @brief 返回USART2已接收的数据到buf，长度为rcv_len
+ *  @brief 取走USART2已接收的rcv_len字节到buf, buf为NULL时直接丢掉, 之后到达的数据不受影响
  */
 void  USART2_GetRcvData(uint8_t *buf, uint32_t rcv_len);
 #endif
@@ -0,0 +1,72 @@
+#include "stm32f10x.h"
+#include "stm32f10x_usart.h"
+#include "stm32f10x_gpio.h"
+#include "stm32f10x_rcc.h"
+#include "misc.h"
+#include "usart3.h"
+
+/*
+ *  @brief USART3初始化函数, 接下游RS-485总线, 8N1
+ */
+void USART3_Init(uint32_t baud)
+{
+    GPIO_InitTypeDef GPIO_InitStructure;
+    USART_InitTypeDef USART_InitStructure;
+    NVIC_InitTypeDef NVIC_InitStructure;
+
+    /* config USART3 clock */
+    RCC_APB2PeriphClockCmd(RCC_APB2Periph_GPIOB | USART3_DE_CLK, ENABLE);
+    RCC_APB1PeriphClockCmd(RCC_APB1Periph_USART3, ENABLE);
+
+    /* USART3 GPIO config */
+    /* Configure USART3 Tx (PB.10) as alternate function push-pull */
+    GPIO_InitStructure.GPIO_Pin = GPIO_Pin_10;
+    GPIO_InitStructure.GPIO_Mode = GPIO_Mode_AF_PP;
+    GPIO_InitStructure.GPIO_Speed = GPIO_Speed_50MHz;
+    GPIO_Init(GPIOB, &GPIO_InitStructure);
+    /* Configure USART3 Rx (PB.11) as input floating */
+    GPIO_InitStructure.GPIO_Pin = GPIO_Pin_11;
+    GPIO_InitStructure.GPIO_Mode = GPIO_Mode_IN_FLOATING;
+    GPIO_Init(GPIOB, &GPIO_InitStructure);
+    /* RS-485 direction pin, receive by default */
+    GPIO_InitStructure.GPIO_Pin = USART3_DE_PIN;
+    GPIO_InitStructure.GPIO_Mode = GPIO_Mode_Out_PP;
+    GPIO_Init(USART3_DE_PORT, &GPIO_InitStructure);
+    GPIO_ResetBits(USART3_DE_PORT, USART3_DE_PIN);
+
+    /* USART3 mode config */
+    USART_InitStructure.USART_BaudRate = baud;
+    USART_InitStructure.USART_WordLength = USART_WordLength_8b;
+    USART_InitStructure.USART_StopBits = USART_StopBits_1;
+    USART_InitStructure.USART_Parity = USART_Parity_No ;
+    USART_InitStructure.USART_HardwareFlowControl = USART_HardwareFlowControl_None;
+    USART_InitStructure.USART_Mode = USART_Mode_Rx | USART_Mode_Tx;
+    USART_Init(USART3, &USART_InitStructure);
+    USART_Cmd(USART3, ENABLE);
+
+    //Enable usart3 receive interrupt
+    USART_ITConfig(USART3, USART_IT_RXNE, ENABLE);
+
+    NVIC_InitStructure.NVIC_IRQChannel = USART3_IRQn;
+    NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 3;
+    NVIC_InitStructure.NVIC_IRQChannelSubPriority = 1;
+    NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+    NVIC_Init(&NVIC_InitStructure);
+}
+/*
+ *  @brief USART3串口发送api, 发送期间打开RS-485发送方向, 发完切回接收
+ */
+void USART3_Write(uint8_t *Data, uint32_t len)
+{
+    uint32_t i;
+
+    GPIO_SetBits(USART3_DE_PORT, USART3_DE_PIN);
+    USART_ClearFlag(USART3, USART_FLAG_TC);
+    for(i = 0; i < len; i++)
+    {
+        USART_SendData(USART3, *Data++);
+        while( USART_GetFlagStatus(USART3, USART_FLAG_TC) == RESET );
+    }
+    /*最后一个字节的停止位发完才能释放总线*/
+    GPIO_ResetBits(USART3_DE_PORT, USART3_DE_PIN);
+}
@@ -0,0 +1,18 @@
+#ifndef USART3_H_H
+#define USART3_H_H
+
+/*RS-485收发器的方向控制脚(DE/RE), 高电平发送, 按实际电路修改*/
+#define USART3_DE_PORT  GPIOB
+#define USART3_DE_CLK   RCC_APB2Periph_GPIOB
+#define USART3_DE_PIN   GPIO_Pin_1
+
+/*
+ *  @brief USART3初始化函数, 接下游RS-485总线, 8N1
+ */
+extern void USART3_Init(uint32_t baud);
+/*
+ *  @brief USART3串口发送api, 发送期间打开RS-485发送方向, 发完切回接收
+ */
+extern void USART3_Write(uint8_t *Data, uint32_t len);
+
+#endif
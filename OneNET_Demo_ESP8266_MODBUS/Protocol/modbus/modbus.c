@@ -11,6 +11,9 @@
 #include "usart2.h"
 #include "esp8266.h"
 #include "modbus.h"
+#include "modbus_rtu.h"
+#include "modbus_master.h"
+#include "log.h"
 
 int8_t req[52];
 
@@ -18,14 +21,12 @@ void Process_Cmd(uint8_t * buf, int32_t len);
 void MODBUS_Init_Login_Data(void);
 void MODBUS_Login(void);
 void Insert_Crc16(uint8_t *buf, int32_t len_to_calc);
-void Read_HoldingRegs(uint8_t * buf, uint8_t * rsp_buf, int32_t *len);
 
 /*
  *初始化modbus鉴权数据，共52字节。
  */
 void MODBUS_Init_Login_Data(void)
 {
-    int32_t i = 0;
     int8_t type[11] = "type";/*暂时不支持，服务器不处理*/
     int8_t name[9] = "name";/*暂时不支持，服务器不处理*/
     int8_t phone[12] = "12345670";/*创建MODBUS设备时对应的卡号信息，鉴权信息*/
@@ -37,12 +38,7 @@ void MODBUS_Init_Login_Data(void)
     memcpy(req + 11 + 9, phone, 12);
     memcpy(req + 11 + 9 + 12, pwd, 9);
     memcpy(req + 11 + 9 + 12 + 9, p_id, 11);
-
-    for(i = 0; i < 52; i++)
-    {
-        printf("0x%x ", req[i]);
-    }
-    printf("\n");
+    LOG_HEX(LOG_LEVEL_DEBUG, LOG_MOD_MODBUS, "login", (uint8_t *)req, sizeof(req));
 }
 
 /**
@@ -52,38 +48,28 @@ void MODBUS_Init_Login_Data(void)
  **/
 void MODBUS_Loop(void)
 {
-    int32_t i = 0;
     int32_t rcv_len = 0;
-    uint8_t buffer[MAXLINE];
+    static uint8_t buffer[MB_RTU_FRAME_MAX];
+    /*透传已建立, 之后USART2收到的数据按3.5字符静默定界成帧*/
+    MB_RTU_Init(115200);
     printf("MODBUS Login\r\n");
     /*1.modbus首先登陆，发送鉴权信息*/
     MODBUS_Login();
-	  printf("\r\n");
     while (1)
     {
-        /*查询WIFI是否接收到数据*/
-        rcv_len = USART2_GetRcvNum();
-        //USART2_GetRcvData(buffer, rcv_len);
-        mDelay(1000);
-        mDelay(1000);
+        /*日志在这里格式化并用DMA发出, 不占用处理命令的时间*/
+        Log_Poll();
+        /*轮询下游RS-485设备, 结果缓存到本机输入寄存器*/
+        MB_Master_Poll();
+        /*取出已收完并通过CRC校验的帧*/
+        rcv_len = MB_RTU_GetFrame(buffer);
         if (rcv_len <= 0)
         {
-            mDelay(1000);
             continue;
         }
-        else
-        {		mDelay(50);
-					  rcv_len = USART2_GetRcvNum();
-            USART2_GetRcvData(buffer, rcv_len);
-            printf("\r\nI GET DATA:\r\n");
-            for (i = 0; i < rcv_len; i++)
-            {
-                printf("0x%x ", buffer[i]);
-            }
-            printf("\r\n");
-            /*处理MODBUS协议命令*/
-            Process_Cmd(buffer, rcv_len);
-        }
+        LOG_HEX(LOG_LEVEL_DEBUG, LOG_MOD_MODBUS, "rx", buffer, rcv_len);
+        /*处理MODBUS协议命令*/
+        Process_Cmd(buffer, rcv_len);
     }
 }
 
@@ -94,73 +80,408 @@ void MODBUS_Loop(void)
  **/
 void Process_Cmd(uint8_t * buf, int32_t len)
 {
-    uint8_t rsp_buf[MAXLINE];
+    static uint8_t rsp_buf[MB_RSP_MAX];
     int32_t rsp_len = 0;
-    uint8_t addr = *buf;
-    uint8_t func_code = *(buf + 1);
 
-    printf("addr:0x%x,func_code: 0x%x\n", addr, func_code);
-
-    if(addr != MY_MODBUS_ADDR)
+    if(len >= 2)
     {
-        printf("error addr\n");/*非本设备地址*/
-        return;
+        LOG_D(LOG_MOD_MODBUS, "addr:0x%x,func_code: 0x%x", buf[0], buf[1]);
     }
-    switch (func_code)
+    rsp_len = MB_Slave_Process(buf, len, rsp_buf);
+    if(rsp_len <= 0)
     {
-        /*处理0x3命令*/
-        case MB_FUNC_READ_HOLDING:
-            Read_HoldingRegs(buf, rsp_buf, &rsp_len);
-            break;
-        default:
-            Read_HoldingRegs(buf, rsp_buf, &rsp_len);
-            break;
+        return;/*CRC错误, 非本设备地址或广播, 不响应*/
     }
-    /*返回命令响应数据*/
-    USART2_SendData(rsp_buf, rsp_len);
-    printf("%s send  %d bytes to server\n", __func__, rsp_len);
+    /*
+     * 返回命令响应数据: 透传已建立, 直接写USART2. 不经USART2_SendData,
+     * 它为AT命令清空接收缓冲区并延时100ms, 会丢掉排队的请求并把吞吐限制在每秒10帧
+     */
+    USART2_Write(USART2, rsp_buf, rsp_len);
+    LOG_D(LOG_MOD_MODBUS, "%s send %d bytes to server", __func__, rsp_len);
 }
 
-
 /*
- * @brief 处理0x3命令，按照modbus协议，是读取保持寄存器
- * @param  buf：需要处理的协议数据缓冲区
- * @param  rsp_buf：返回结果缓冲区
- * @param  len：需要处理的协议数据缓冲区长度
- * @retval None
+ * 功能码处理函数
+ * req: 请求帧(不含CRC), req_len: 其长度; rsp: 响应帧, 地址和功能码已填好, 从rsp[2]开始填写
+ * 返回0成功, *rsp_len为响应长度(不含CRC); 否则返回异常码
  */
+typedef int32_t (*MB_Handler)(const uint8_t * req, int32_t req_len, uint8_t * rsp, int32_t * rsp_len);
 
-void Read_HoldingRegs(uint8_t * buf, uint8_t * rsp_buf, int32_t * len)
+/*
+ * @brief 在寄存器表中查找地址
+ * @param  table：寄存器表
+ * @param  addr：寄存器地址
+ * @param  offset：返回地址在块内的偏移
+ * @retval 所在的块, 未映射返回NULL
+ */
+static const MB_Block * MB_Find(const MB_Table * table, uint16_t addr, uint16_t * offset)
 {
+    const MB_Block * block;
     int32_t i = 0;
-    uint16_t start_addr = (buf[2] << 8) + buf[3];
-    uint8_t read_reg_len = ((buf[4] << 4) & 0xf0) + (buf[5] & 0x0f);
 
-    rsp_buf[0] = buf[0]; //copy addr;
-    rsp_buf[1] = buf[1]; //copy func code;
-    rsp_buf[2] = read_reg_len * 2;
+    for(i = 0; i < table->num; i++)
+    {
+        block = &table->block[i];
+        if(addr >= block->start && addr - block->start < block->num)
+        {
+            *offset = addr - block->start;
+            return block;
+        }
+    }
+    return NULL;
+}
 
-    printf("from addr 0x%x,%d bytes to read\n", start_addr, read_reg_len);
+/*
+ * @brief 检查从addr开始的num个地址是否全部已映射
+ * @param  writable：非0时还要求可写
+ * @retval 0或MB_EX_ILLEGAL_DATA_ADDRESS
+ */
+static int32_t MB_Check(const MB_Table * table, uint16_t addr, uint16_t num, int32_t writable)
+{
+    const MB_Block * block;
+    uint16_t offset = 0;
+    uint32_t a = addr;
 
-    if(read_reg_len == 3)
+    if(a + num > 0x10000)
     {
-        //user data  in modbus protocol;
-        rsp_buf[i + 3] = (unsigned char)rand();
-        rsp_buf[i + 4] = (unsigned char)rand();
-        rsp_buf[i + 5] = (unsigned char)rand();
-        rsp_buf[i + 6] = (unsigned char)rand();
-        rsp_buf[i + 7] = (unsigned char)rand();
-        rsp_buf[i + 8] = (unsigned char)rand();
+        return MB_EX_ILLEGAL_DATA_ADDRESS;
+    }
+    while(num > 0)
+    {
+        block = MB_Find(table, (uint16_t)a, &offset);
+        if(block == NULL || (writable && block->var == NULL && block->write == NULL))
+        {
+            return MB_EX_ILLEGAL_DATA_ADDRESS;
+        }
+        /*一次跳过块内剩余部分*/
+        if(block->num - offset >= num)
+        {
+            break;
+        }
+        num -= block->num - offset;
+        a += block->num - offset;
+    }
+    return 0;
+}
+
+/*读一个已检查过的地址, is_bit表示线圈/离散量表*/
+static uint16_t MB_Get(const MB_Table * table, uint16_t addr, int32_t is_bit)
+{
+    uint16_t offset = 0;
+    const MB_Block * block = MB_Find(table, addr, &offset);
+
+    if(block->read != NULL)
+    {
+        return block->read(offset);
+    }
+    if(is_bit)
+    {
+        return ((uint8_t *)block->var)[offset] ? 1 : 0;
+    }
+    return ((uint16_t *)block->var)[offset];
+}
+
+/*写一个已检查过的地址, 返回0或异常码*/
+static int32_t MB_Put(const MB_Table * table, uint16_t addr, uint16_t value, int32_t is_bit)
+{
+    uint16_t offset = 0;
+    const MB_Block * block = MB_Find(table, addr, &offset);
+
+    if(block->write != NULL)
+    {
+        return block->write(offset, value);
+    }
+    if(is_bit)
+    {
+        ((uint8_t *)block->var)[offset] = value ? 1 : 0;
     }
     else
     {
-        for(i = 0; i < (read_reg_len * 2); i++)
+        ((uint16_t *)block->var)[offset] = value;
+    }
+    return 0;
+}
+
+/*0x01/0x02 读线圈/离散输入*/
+static int32_t MB_Read_Bits(const MB_Table * table, const uint8_t * req, int32_t req_len, uint8_t * rsp, int32_t * rsp_len)
+{
+    uint16_t start_addr = 0;
+    uint16_t num = 0;
+    uint16_t i = 0;
+    int32_t ret = 0;
+
+    if(req_len != 6)
+    {
+        return MB_EX_ILLEGAL_DATA_VALUE;
+    }
+    start_addr = (req[2] << 8) | req[3];
+    num = (req[4] << 8) | req[5];
+    if(num < 1 || num > 2000)
+    {
+        return MB_EX_ILLEGAL_DATA_VALUE;
+    }
+    ret = MB_Check(table, start_addr, num, 0);
+    if(ret != 0)
+    {
+        return ret;
+    }
+
+    rsp[2] = (num + 7) / 8;
+    memset(rsp + 3, 0, rsp[2]);
+    for(i = 0; i < num; i++)
+    {
+        if(MB_Get(table, start_addr + i, 1))
         {
-            rsp_buf[i + 3] = 1; //(unsigned char)rand();
+            rsp[3 + i / 8] |= 1 << (i % 8);
         }
     }
-    Insert_Crc16(rsp_buf, 1 + 1 + 1 + read_reg_len * 2);
-    *len = 1 + 1 + 1 + read_reg_len * 2 + 2; //1 byte addr,1 byte func code,1 byte reg_val_len,reg data len,2 bytes crc16;
+    *rsp_len = 3 + rsp[2];
+    return 0;
+}
+
+static int32_t MB_Read_Coils(const uint8_t * req, int32_t req_len, uint8_t * rsp, int32_t * rsp_len)
+{
+    return MB_Read_Bits(&mb_coils, req, req_len, rsp, rsp_len);
+}
+
+static int32_t MB_Read_Discrete(const uint8_t * req, int32_t req_len, uint8_t * rsp, int32_t * rsp_len)
+{
+    return MB_Read_Bits(&mb_discrete_inputs, req, req_len, rsp, rsp_len);
+}
+
+/*0x03/0x04 读保持/输入寄存器, 平台一次轮询多个寄存器时在一帧内全部返回*/
+static int32_t MB_Read_Regs(const MB_Table * table, const uint8_t * req, int32_t req_len, uint8_t * rsp, int32_t * rsp_len)
+{
+    uint16_t start_addr = 0;
+    uint16_t num = 0;
+    uint16_t value = 0;
+    uint16_t i = 0;
+    int32_t ret = 0;
+
+    if(req_len != 6)
+    {
+        return MB_EX_ILLEGAL_DATA_VALUE;
+    }
+    start_addr = (req[2] << 8) | req[3];
+    num = (req[4] << 8) | req[5];
+    if(num < 1 || num > 125)
+    {
+        return MB_EX_ILLEGAL_DATA_VALUE;
+    }
+    ret = MB_Check(table, start_addr, num, 0);
+    if(ret != 0)
+    {
+        return ret;
+    }
+
+    LOG_D(LOG_MOD_MODBUS, "from addr 0x%x,%d regs to read", start_addr, num);
+    rsp[2] = num * 2;
+    for(i = 0; i < num; i++)
+    {
+        value = MB_Get(table, start_addr + i, 0);
+        rsp[3 + i * 2] = value >> 8;
+        rsp[4 + i * 2] = value & 0xff;
+    }
+    *rsp_len = 3 + rsp[2];
+    return 0;
+}
+
+static int32_t MB_Read_Holding(const uint8_t * req, int32_t req_len, uint8_t * rsp, int32_t * rsp_len)
+{
+    return MB_Read_Regs(&mb_holding_regs, req, req_len, rsp, rsp_len);
+}
+
+static int32_t MB_Read_Input(const uint8_t * req, int32_t req_len, uint8_t * rsp, int32_t * rsp_len)
+{
+    return MB_Read_Regs(&mb_input_regs, req, req_len, rsp, rsp_len);
+}
+
+/*0x05 写单个线圈, 值只能是0xFF00或0x0000, 原样回显请求*/
+static int32_t MB_Write_Coil(const uint8_t * req, int32_t req_len, uint8_t * rsp, int32_t * rsp_len)
+{
+    uint16_t addr = 0;
+    uint16_t value = 0;
+    int32_t ret = 0;
+
+    if(req_len != 6)
+    {
+        return MB_EX_ILLEGAL_DATA_VALUE;
+    }
+    addr = (req[2] << 8) | req[3];
+    value = (req[4] << 8) | req[5];
+    if(value != 0xFF00 && value != 0x0000)
+    {
+        return MB_EX_ILLEGAL_DATA_VALUE;
+    }
+    ret = MB_Check(&mb_coils, addr, 1, 1);
+    if(ret == 0)
+    {
+        ret = MB_Put(&mb_coils, addr, value ? 1 : 0, 1);
+    }
+    if(ret != 0)
+    {
+        return ret;
+    }
+    memcpy(rsp + 2, req + 2, 4);
+    *rsp_len = 6;
+    return 0;
+}
+
+/*0x06 写单个保持寄存器, 原样回显请求*/
+static int32_t MB_Write_Reg(const uint8_t * req, int32_t req_len, uint8_t * rsp, int32_t * rsp_len)
+{
+    uint16_t addr = 0;
+    int32_t ret = 0;
+
+    if(req_len != 6)
+    {
+        return MB_EX_ILLEGAL_DATA_VALUE;
+    }
+    addr = (req[2] << 8) | req[3];
+    ret = MB_Check(&mb_holding_regs, addr, 1, 1);
+    if(ret == 0)
+    {
+        ret = MB_Put(&mb_holding_regs, addr, (req[4] << 8) | req[5], 0);
+    }
+    if(ret != 0)
+    {
+        return ret;
+    }
+    memcpy(rsp + 2, req + 2, 4);
+    *rsp_len = 6;
+    return 0;
+}
+
+/*0x0F 写多个线圈, 先检查全部地址再写, 不会只写一半*/
+static int32_t MB_Write_Coils(const uint8_t * req, int32_t req_len, uint8_t * rsp, int32_t * rsp_len)
+{
+    uint16_t start_addr = 0;
+    uint16_t num = 0;
+    uint16_t i = 0;
+    int32_t ret = 0;
+
+    if(req_len < 7)
+    {
+        return MB_EX_ILLEGAL_DATA_VALUE;
+    }
+    start_addr = (req[2] << 8) | req[3];
+    num = (req[4] << 8) | req[5];
+    if(num < 1 || num > 1968 || req[6] != (num + 7) / 8 || req_len != 7 + req[6])
+    {
+        return MB_EX_ILLEGAL_DATA_VALUE;
+    }
+    ret = MB_Check(&mb_coils, start_addr, num, 1);
+    for(i = 0; i < num && ret == 0; i++)
+    {
+        ret = MB_Put(&mb_coils, start_addr + i, (req[7 + i / 8] >> (i % 8)) & 1, 1);
+    }
+    if(ret != 0)
+    {
+        return ret;
+    }
+    memcpy(rsp + 2, req + 2, 4);
+    *rsp_len = 6;
+    return 0;
+}
+
+/*0x10 写多个保持寄存器*/
+static int32_t MB_Write_Regs(const uint8_t * req, int32_t req_len, uint8_t * rsp, int32_t * rsp_len)
+{
+    uint16_t start_addr = 0;
+    uint16_t num = 0;
+    uint16_t i = 0;
+    int32_t ret = 0;
+
+    if(req_len < 7)
+    {
+        return MB_EX_ILLEGAL_DATA_VALUE;
+    }
+    start_addr = (req[2] << 8) | req[3];
+    num = (req[4] << 8) | req[5];
+    if(num < 1 || num > 123 || req[6] != num * 2 || req_len != 7 + req[6])
+    {
+        return MB_EX_ILLEGAL_DATA_VALUE;
+    }
+    ret = MB_Check(&mb_holding_regs, start_addr, num, 1);
+    for(i = 0; i < num && ret == 0; i++)
+    {
+        ret = MB_Put(&mb_holding_regs, start_addr + i, (req[7 + i * 2] << 8) | req[8 + i * 2], 0);
+    }
+    if(ret != 0)
+    {
+        return ret;
+    }
+    memcpy(rsp + 2, req + 2, 4);
+    *rsp_len = 6;
+    return 0;
+}
+
+static const struct
+{
+    uint8_t func_code;
+    MB_Handler handler;
+} mb_handlers[] =
+{
+    {MB_FUNC_READ_COILS, MB_Read_Coils},
+    {MB_FUNC_READ_DISCRETE_INPUTS, MB_Read_Discrete},
+    {MB_FUNC_READ_HOLDING, MB_Read_Holding},
+    {MB_FUNC_READ_INPUT, MB_Read_Input},
+    {MB_FUNC_WRITE_SINGLE_COIL, MB_Write_Coil},
+    {MB_FUNC_WRITE_REGISTER, MB_Write_Reg},
+    {MB_FUNC_WRITE_MULTIPLE_COILS, MB_Write_Coils},
+    {MB_FUNC_WRITE_MULTIPLE_REGISTERS, MB_Write_Regs},
+};
+
+/**
+ * @brief  modbus从机处理一帧请求
+ * @param  req：请求帧, 含CRC
+ * @param  len：请求帧长度
+ * @param  rsp：响应帧缓冲区, 至少MB_RSP_MAX字节
+ * @retval 响应帧长度(含CRC), 0表示不响应(CRC错误, 非本机地址或广播)
+ **/
+int32_t MB_Slave_Process(const uint8_t * req, int32_t len, uint8_t * rsp)
+{
+    int32_t rsp_len = 0;
+    int32_t ret = MB_EX_ILLEGAL_FUNCTION;
+    int32_t i = 0;
+
+    /*地址+功能码+CRC至少4字节; 整帧(含CRC)的CRC16为0说明校验正确*/
+    if(len < 4 || usMBCRC16((uint8_t *)req, len) != 0)
+    {
+        LOG_D(LOG_MOD_MODBUS, "error crc");
+        return 0;
+    }
+    if(req[0] != MY_MODBUS_ADDR && req[0] != 0)
+    {
+        LOG_D(LOG_MOD_MODBUS, "error addr");/*非本设备地址*/
+        return 0;
+    }
+
+    rsp[0] = req[0];
+    rsp[1] = req[1];
+    for(i = 0; i < sizeof(mb_handlers) / sizeof(mb_handlers[0]); i++)
+    {
+        if(mb_handlers[i].func_code == req[1])
+        {
+            ret = mb_handlers[i].handler(req, len - 2, rsp, &rsp_len);
+            break;
+        }
+    }
+
+    /*广播地址0: 只执行, 不响应*/
+    if(req[0] == 0)
+    {
+        return 0;
+    }
+    if(ret != 0)
+    {
+        LOG_D(LOG_MOD_MODBUS, "exception 0x%x", ret);
+        rsp[1] = req[1] | MB_FUNC_ERROR;
+        rsp[2] = ret;
+        rsp_len = 3;
+    }
+    Insert_Crc16(rsp, rsp_len);
+    return rsp_len + 2; //1 byte addr,1 byte func code,data,2 bytes crc16;
 }
 
 /*
@@ -182,26 +503,8 @@ void MODBUS_Login(void)
  */
 void Insert_Crc16(uint8_t *buf, int32_t len_to_calc)
 {
-    uint8_t test_buf[256];//only for test
-    uint8_t * tmp = test_buf;
-    int32_t i = 0;
     uint16_t uscrc = usMBCRC16(buf, len_to_calc);
     buf[len_to_calc + 0] = uscrc & 0xff;
     buf[len_to_calc + 1] = (uscrc >> 8) & 0xff; /*make sure buf big enough to accept crc16*/
-    printf("crc:0x%2x\n", uscrc);
-
-    for(i = 0; i < len_to_calc + 2; i++)
-    {
-        printf("0x%x ", buf[i]);
-    }
-    printf("\n");
-    i = 0;
-
-    while (i < len_to_calc + 2)
-    {
-        *tmp++ = prvucMBBIN2CHAR((buf[i]) >> 4);    //high byte
-        *tmp++ = prvucMBBIN2CHAR((buf[i]) & 0x0F);  //low byte
-        i++;
-    }
-    printf("send data rsp:%s,%d\n", test_buf, strlen(test_buf));
+    LOG_HEX(LOG_LEVEL_DEBUG, LOG_MOD_MODBUS, "send data rsp", buf, len_to_calc + 2);
 }
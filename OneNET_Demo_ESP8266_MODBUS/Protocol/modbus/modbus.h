@@ -15,7 +15,54 @@
 
 #define MAXLINE 128
 #define MY_MODBUS_ADDR 0x11
-#define MB_FUNC_READ_HOLDING 3
+#define MB_RSP_MAX 256              /*响应帧缓冲区, 够放125个寄存器的读响应*/
+
+/*功能码*/
+#define MB_FUNC_READ_COILS              0x01
+#define MB_FUNC_READ_DISCRETE_INPUTS    0x02
+#define MB_FUNC_READ_HOLDING            0x03
+#define MB_FUNC_READ_INPUT              0x04
+#define MB_FUNC_WRITE_SINGLE_COIL       0x05
+#define MB_FUNC_WRITE_REGISTER          0x06
+#define MB_FUNC_WRITE_MULTIPLE_COILS    0x0F
+#define MB_FUNC_WRITE_MULTIPLE_REGISTERS 0x10
+#define MB_FUNC_ERROR                   0x80
+
+/*异常码*/
+#define MB_EX_ILLEGAL_FUNCTION      0x01
+#define MB_EX_ILLEGAL_DATA_ADDRESS  0x02
+#define MB_EX_ILLEGAL_DATA_VALUE    0x03
+#define MB_EX_DEVICE_FAILURE        0x04
+
+/*
+ * 寄存器表: 每个块覆盖从start开始的num个地址, 值来自var或回调.
+ * 寄存器块的var是uint16_t数组, 线圈/离散量块的var是uint8_t数组(每个元素0或1).
+ * read为NULL时读var; write为NULL时写var, var也为NULL则该块只读.
+ * 回调的addr是块内偏移(0 ~ num-1).
+ */
+typedef uint16_t (*MB_ReadFunc)(uint16_t addr);
+typedef int32_t (*MB_WriteFunc)(uint16_t addr, uint16_t value);    /*返回0成功, 否则为异常码*/
+
+typedef struct
+{
+    uint16_t start;
+    uint16_t num;
+    void *var;
+    MB_ReadFunc read;
+    MB_WriteFunc write;
+} MB_Block;
+
+typedef struct
+{
+    const MB_Block *block;
+    uint8_t num;
+} MB_Table;
+
+/*寄存器表在modbus_map.c中定义*/
+extern const MB_Table mb_coils;
+extern const MB_Table mb_discrete_inputs;
+extern const MB_Table mb_holding_regs;
+extern const MB_Table mb_input_regs;
 
 /**
  * @brief  modbus协议主循环
@@ -30,6 +77,15 @@ void MODBUS_Loop(void);
  * @retval None
  **/
 void Process_Cmd(uint8_t * buf, int32_t len);
+
+/**
+ * @brief  modbus从机处理一帧请求
+ * @param  req：请求帧, 含CRC
+ * @param  len：请求帧长度
+ * @param  rsp：响应帧缓冲区, 至少MB_RSP_MAX字节
+ * @retval 响应帧长度(含CRC), 0表示不响应(CRC错误, 非本机地址或广播)
+ **/
+int32_t MB_Slave_Process(const uint8_t * req, int32_t len, uint8_t * rsp);
 /*
  *  @brief modbus登陆鉴权
  * @param  None
@@ -0,0 +1,81 @@
+#include "stm32f10x.h"
+#include "stdlib.h"
+#include "modbus.h"
+#include "modbus_master.h"
+
+/*
+ * 本机的modbus寄存器表, 编译期确定.
+ * 板子上没有接传感器, 保持寄存器0~2仍用随机数模拟测量值, 其余绑定到变量上.
+ */
+
+/*线圈, 00001起: 0~7为输出开关*/
+static uint8_t coil_out[8];
+
+/*离散输入, 10001起: 0~7为输入状态, 这里回读线圈*/
+static uint16_t Read_Discrete(uint16_t addr)
+{
+    return coil_out[addr];
+}
+
+/*保持寄存器, 40001起*/
+static uint16_t Read_Sensor(uint16_t addr)
+{
+    return (uint16_t)rand();    /*模拟的测量值*/
+}
+
+static uint16_t holding_param[16];  /*40101起, 可读写参数*/
+
+/*输入寄存器, 30001起*/
+static uint16_t req_count;
+
+static uint16_t Read_Status(uint16_t addr)
+{
+    switch(addr)
+    {
+        case 0:
+            return MY_MODBUS_ADDR;
+        case 1:
+            return req_count++;     /*读取次数, 用于确认轮询是否在进行*/
+        default:
+            return 0;
+    }
+}
+
+static const MB_Block coil_blocks[] =
+{
+    {0, 8, coil_out, NULL, NULL},
+};
+
+static const MB_Block discrete_blocks[] =
+{
+    {0, 8, NULL, Read_Discrete, NULL},
+};
+
+static const MB_Block holding_blocks[] =
+{
+    {0, 3, NULL, Read_Sensor, NULL},
+    {100, 16, holding_param, NULL, NULL},
+};
+
+static const MB_Block input_blocks[] =
+{
+    {0, 2, NULL, Read_Status, NULL},
+    {1000, MB_MASTER_CACHE_LEN, mb_master_cache, NULL, NULL},   /*30001+1000起: 下游设备寄存器缓存*/
+    {1100, MB_MASTER_POLL_MAX, mb_poll_status, NULL, NULL},     /*各轮询项状态, 见MB_POLL_xxx*/
+};
+
+/*
+ * 下游RS-485设备轮询表, 按现场接线修改.
+ * 例: 1号电表每秒读电压/电流/功率, 2号电表每10秒读累计电量.
+ */
+const MB_Poll mb_polls[] =
+{
+    {1, MB_FUNC_READ_HOLDING, 0x0000, 3, 0, 1000},
+    {2, MB_FUNC_READ_INPUT, 0x0100, 2, 3, 10000},
+};
+const uint8_t mb_poll_num = sizeof(mb_polls) / sizeof(mb_polls[0]);
+
+const MB_Table mb_coils = {coil_blocks, sizeof(coil_blocks) / sizeof(coil_blocks[0])};
+const MB_Table mb_discrete_inputs = {discrete_blocks, sizeof(discrete_blocks) / sizeof(discrete_blocks[0])};
+const MB_Table mb_holding_regs = {holding_blocks, sizeof(holding_blocks) / sizeof(holding_blocks[0])};
+const MB_Table mb_input_regs = {input_blocks, sizeof(input_blocks) / sizeof(input_blocks[0])};
@@ -0,0 +1,246 @@
+#include "stm32f10x.h"
+#include "stdio.h"
+#include "string.h"
+#include "utils.h"
+#include "usart3.h"
+#include "modbus.h"
+#include "modbus_rtu.h"
+#include "modbus_master.h"
+#include "log.h"
+
+/*调度状态*/
+#define MB_MASTER_ST_IDLE   0   /*没有进行中的事务, 可以发下一个到期的请求*/
+#define MB_MASTER_ST_WAIT   1   /*请求已发出, 等响应*/
+#define MB_MASTER_ST_GAP    2   /*事务刚结束, 等总线空闲*/
+
+uint16_t mb_master_cache[MB_MASTER_CACHE_LEN];
+uint16_t mb_poll_status[MB_MASTER_POLL_MAX];
+
+static uint32_t poll_due[MB_MASTER_POLL_MAX];  /*各项下次到期的时间*/
+
+static volatile uint8_t state = MB_MASTER_ST_IDLE;
+static uint8_t cur = 0;             /*当前事务的轮询项*/
+static uint8_t tries = 0;           /*当前事务已重发的次数*/
+static uint8_t resend = 0;          /*间隔结束后重发当前请求*/
+static uint32_t deadline = 0;       /*等待响应或间隔结束的时间*/
+
+static uint8_t rx_buf[MB_RTU_FRAME_MAX];
+static volatile uint16_t rx_len = 0;
+
+/*n字节在下游总线上的传输时间, ms, 向上取整; 8N1每字节10位*/
+#define MB_MASTER_TX_MS(n)  (((uint32_t)(n) * 10 * 1000 + MB_MASTER_BAUD - 1) / MB_MASTER_BAUD)
+
+/*a是否已到达或超过b, 计时回绕也能正确比较*/
+#define TIME_REACHED(a, b)  ((int32_t)((a) - (b)) >= 0)
+
+/*轮询项是否有效, 无效项不轮询*/
+static int32_t MB_Poll_Valid(const MB_Poll * poll)
+{
+    return (poll->func == MB_FUNC_READ_HOLDING || poll->func == MB_FUNC_READ_INPUT)
+           && poll->num >= 1 && poll->num <= 125
+           && poll->cache + poll->num <= MB_MASTER_CACHE_LEN;
+}
+
+/**
+ * @brief  初始化下游总线USART3, 所有轮询项立即到期
+ * @param  None
+ * @retval None
+ **/
+void MB_Master_Init(void)
+{
+    uint32_t now = SystickTime_Get();
+    int32_t i = 0;
+
+    USART3_Init(MB_MASTER_BAUD);
+    for(i = 0; i < MB_MASTER_POLL_MAX; i++)
+    {
+        poll_due[i] = now;
+        mb_poll_status[i] = MB_POLL_PENDING;
+        if(i < mb_poll_num && !MB_Poll_Valid(&mb_polls[i]))
+        {
+            printf("modbus master: poll %d invalid, skipped\n", i);
+        }
+    }
+    state = MB_MASTER_ST_IDLE;
+}
+
+/**
+ * @brief  USART3中断中调用, 收到一个字节
+ **/
+void MB_Master_RxByte(uint8_t data)
+{
+    /*没有在等响应时收到的是噪声或超时后迟到的响应, 丢弃*/
+    if(state == MB_MASTER_ST_WAIT && rx_len < MB_RTU_FRAME_MAX)
+    {
+        rx_buf[rx_len++] = data;
+    }
+}
+
+/*发出当前轮询项的请求*/
+static void MB_Master_Send(void)
+{
+    const MB_Poll * poll = &mb_polls[cur];
+    uint8_t req[8];
+    uint16_t crc = 0;
+
+    req[0] = poll->slave;
+    req[1] = poll->func;
+    req[2] = poll->addr >> 8;
+    req[3] = poll->addr & 0xff;
+    req[4] = poll->num >> 8;
+    req[5] = poll->num & 0xff;
+    crc = usMBCRC16(req, 6);
+    req[6] = crc & 0xff;
+    req[7] = crc >> 8;
+
+    rx_len = 0;
+    state = MB_MASTER_ST_WAIT;
+    USART3_Write(req, sizeof(req));
+    /*USART3_Write返回时请求已发完; 完整的读响应为地址+功能码+字节数+num*2字节数据+CRC,
+      9600波特读125个寄存器要传266ms, 超时按它算, 不用固定值*/
+    deadline = SystickTime_Get() + MB_MASTER_TIMEOUT + MB_MASTER_TX_MS(5 + poll->num * 2);
+}
+
+/*事务结束: 记录状态, 排好下次到期时间, 进入总线间隔*/
+static void MB_Master_Done(uint16_t status, uint32_t now)
+{
+    const MB_Poll * poll = &mb_polls[cur];
+
+    mb_poll_status[cur] = status;
+    poll_due[cur] += poll->interval;
+    if(!TIME_REACHED(poll_due[cur], now))
+    {
+        poll_due[cur] = now + poll->interval;   /*落后太多时不补读错过的周期*/
+    }
+    resend = 0;
+    state = MB_MASTER_ST_GAP;
+    deadline = now + MB_MASTER_TURNAROUND;
+}
+
+/*超时或坏帧: 还有重发次数就在间隔后重发, 否则记为失败*/
+static void MB_Master_Fail(uint16_t status, uint32_t now)
+{
+    if(tries < MB_MASTER_RETRY)
+    {
+        tries++;
+        resend = 1;
+        state = MB_MASTER_ST_GAP;
+        deadline = now + MB_MASTER_TURNAROUND;
+        return;
+    }
+    LOG_W(LOG_MOD_MODBUS, "modbus master: slave %d no valid response, status 0x%x", mb_polls[cur].slave, status);
+    MB_Master_Done(status, now);
+}
+
+/*
+ * 检查已收到的响应
+ * 返回0还没收完, 1已处理完
+ */
+static int32_t MB_Master_Check(uint32_t now)
+{
+    const MB_Poll * poll = &mb_polls[cur];
+    uint16_t len = rx_len;
+    uint16_t expect = 0;
+    uint16_t i = 0;
+
+    /*由功能码和字节数算出完整响应的长度, 收够就处理, 不必再等3.5字符静默*/
+    if(len >= 2 && (rx_buf[1] & MB_FUNC_ERROR))
+    {
+        expect = 5;
+    }
+    else if(len >= 3)
+    {
+        expect = 5 + rx_buf[2];
+    }
+    if(expect == 0 || len < expect)
+    {
+        return 0;
+    }
+
+    if(usMBCRC16(rx_buf, expect) != 0 || rx_buf[0] != poll->slave
+            || (rx_buf[1] & ~MB_FUNC_ERROR) != poll->func)
+    {
+        MB_Master_Fail(MB_POLL_BAD_FRAME, now);
+        return 1;
+    }
+    if(rx_buf[1] & MB_FUNC_ERROR)
+    {
+        /*从机明确拒绝, 重发也没用*/
+        MB_Master_Done(rx_buf[2], now);
+        return 1;
+    }
+    if(rx_buf[2] != poll->num * 2)
+    {
+        MB_Master_Fail(MB_POLL_BAD_FRAME, now);
+        return 1;
+    }
+    for(i = 0; i < poll->num; i++)
+    {
+        mb_master_cache[poll->cache + i] = (rx_buf[3 + i * 2] << 8) | rx_buf[4 + i * 2];
+    }
+    MB_Master_Done(MB_POLL_OK, now);
+    return 1;
+}
+
+/*选出到期最久的轮询项, 没有到期的返回-1*/
+static int32_t MB_Master_Next(uint32_t now)
+{
+    int32_t best = -1;
+    int32_t i = 0;
+
+    for(i = 0; i < mb_poll_num && i < MB_MASTER_POLL_MAX; i++)
+    {
+        if(!MB_Poll_Valid(&mb_polls[i]) || !TIME_REACHED(now, poll_due[i]))
+        {
+            continue;
+        }
+        if(best < 0 || TIME_REACHED(poll_due[best], poll_due[i] + 1))
+        {
+            best = i;
+        }
+    }
+    return best;
+}
+
+/**
+ * @brief  主机调度, 主循环中反复调用, 不阻塞(发送请求的几毫秒除外)
+ * @param  None
+ * @retval None
+ **/
+void MB_Master_Poll(void)
+{
+    uint32_t now = SystickTime_Get();
+    int32_t next = 0;
+
+    if(state == MB_MASTER_ST_WAIT)
+    {
+        if(!MB_Master_Check(now) && TIME_REACHED(now, deadline))
+        {
+            MB_Master_Fail(MB_POLL_TIMEOUT, now);
+        }
+        return;
+    }
+    if(state == MB_MASTER_ST_GAP)
+    {
+        if(!TIME_REACHED(now, deadline))
+        {
+            return;
+        }
+        state = MB_MASTER_ST_IDLE;
+        if(resend)
+        {
+            resend = 0;
+            MB_Master_Send();
+            return;
+        }
+    }
+
+    /*上一个事务一结束就发下一个到期的请求, 多个设备的请求在总线上首尾相接*/
+    next = MB_Master_Next(now);
+    if(next >= 0)
+    {
+        cur = next;
+        tries = 0;
+        MB_Master_Send();
+    }
+}
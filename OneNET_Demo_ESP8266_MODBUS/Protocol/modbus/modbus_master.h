@@ -0,0 +1,59 @@
+#ifndef __MODBUS_MASTER_HEADER__
+#define __MODBUS_MASTER_HEADER__
+
+#include "stm32f10x.h"
+
+#define MB_MASTER_BAUD          9600    /*下游RS-485总线波特率*/
+#define MB_MASTER_TIMEOUT       100     /*从机收到请求后开始回复的最长时间, ms; 等待超时再加上响应按波特率传完的时间*/
+#define MB_MASTER_RETRY         2       /*超时或校验错误后的重发次数*/
+#define MB_MASTER_TURNAROUND    5       /*一次事务结束到下一个请求的间隔, ms, 不小于3.5字符时间*/
+#define MB_MASTER_CACHE_LEN     64      /*缓存下游寄存器的本地输入寄存器个数*/
+#define MB_MASTER_POLL_MAX      16      /*轮询表最多项数*/
+
+/*
+ * 轮询表的一项: 每interval毫秒从slave读一次寄存器, 结果放到本地缓存cache开始的位置.
+ * 缓存通过本机输入寄存器表对平台可见, 见modbus_map.c.
+ */
+typedef struct
+{
+    uint8_t slave;          /*下游设备地址*/
+    uint8_t func;           /*MB_FUNC_READ_HOLDING或MB_FUNC_READ_INPUT*/
+    uint16_t addr;          /*下游设备上的起始地址*/
+    uint16_t num;           /*寄存器个数, 不超过125*/
+    uint16_t cache;         /*在mb_master_cache中的起始下标*/
+    uint32_t interval;      /*轮询周期, ms*/
+} MB_Poll;
+
+/*每个轮询项的状态, 同样对平台可见*/
+#define MB_POLL_OK          0
+#define MB_POLL_PENDING     0xFFFF  /*还没读成功过*/
+#define MB_POLL_TIMEOUT     0xFFFE  /*重发后仍无响应*/
+#define MB_POLL_BAD_FRAME   0xFFFD  /*重发后响应仍不完整或与请求不符*/
+/*从机返回异常响应时状态为其异常码(1~4)*/
+
+/*轮询表在modbus_map.c中定义*/
+extern const MB_Poll mb_polls[];
+extern const uint8_t mb_poll_num;
+extern uint16_t mb_master_cache[MB_MASTER_CACHE_LEN];
+extern uint16_t mb_poll_status[MB_MASTER_POLL_MAX];
+
+/**
+ * @brief  初始化下游总线USART3, 所有轮询项立即到期
+ * @param  None
+ * @retval None
+ **/
+void MB_Master_Init(void);
+
+/**
+ * @brief  主机调度, 主循环中反复调用, 不阻塞(发送请求的几毫秒除外)
+ * @param  None
+ * @retval None
+ **/
+void MB_Master_Poll(void);
+
+/**
+ * @brief  USART3中断中调用, 收到一个字节
+ **/
+void MB_Master_RxByte(uint8_t data);
+
+#endif
@@ -0,0 +1,156 @@
+#include "stm32f10x.h"
+#include "stm32f10x_tim.h"
+#include "stm32f10x_rcc.h"
+#include "misc.h"
+#include "string.h"
+#include "utils.h"
+#include "modbus_rtu.h"
+
+MB_RTU_Stats mb_rtu_stats;
+
+/*帧队列: rx_slot为正在接收的槽, head为最早排队的帧; head == rx_slot时队列空*/
+static uint8_t frame_buf[MB_RTU_QUEUE_LEN][MB_RTU_FRAME_MAX];
+static uint16_t frame_len[MB_RTU_QUEUE_LEN];
+static volatile uint8_t head = 0;
+static volatile uint8_t rx_slot = 0;
+
+/*当前帧的接收状态, 只在中断中访问*/
+static uint16_t rx_len = 0;
+static uint16_t rx_crc = MB_CRC16_INIT;
+static uint8_t rx_overrun = 0;
+
+static uint8_t rtu_enabled = 0;
+
+/**
+ * @brief  初始化帧定界定时器TIM3, 之后USART2收到的字节都按RTU帧处理
+ * @param  baud：串口波特率, 用于计算3.5字符时间
+ * @retval None
+ **/
+void MB_RTU_Init(uint32_t baud)
+{
+    TIM_TimeBaseInitTypeDef TIM_TimeBaseStructure;
+    NVIC_InitTypeDef NVIC_InitStructure;
+    RCC_ClocksTypeDef clocks;
+    uint32_t tim_clk = 0;
+    uint32_t t35 = 0;
+
+    RCC_APB1PeriphClockCmd(RCC_APB1Periph_TIM3, ENABLE);
+    RCC_GetClocksFreq(&clocks);
+    /*APB1分频不为1时定时器时钟是PCLK1的2倍*/
+    tim_clk = clocks.PCLK1_Frequency;
+    if(clocks.PCLK1_Frequency != clocks.HCLK_Frequency)
+    {
+        tim_clk *= 2;
+    }
+
+    /*3.5字符时间(1字符按11位算), 波特率高于19200时协议规定固定为1750us*/
+    if(baud > 19200)
+    {
+        t35 = 1750;
+    }
+    else
+    {
+        t35 = 38500000 / baud;
+    }
+
+    /*1us计数, 单脉冲模式: 溢出一次后自动停止*/
+    TIM_TimeBaseStructure.TIM_Prescaler = tim_clk / 1000000 - 1;
+    TIM_TimeBaseStructure.TIM_Period = t35 - 1;
+    TIM_TimeBaseStructure.TIM_ClockDivision = TIM_CKD_DIV1;
+    TIM_TimeBaseStructure.TIM_CounterMode = TIM_CounterMode_Up;
+    TIM_TimeBaseStructure.TIM_RepetitionCounter = 0;
+    TIM_TimeBaseInit(TIM3, &TIM_TimeBaseStructure);
+    TIM_SelectOnePulseMode(TIM3, TIM_OPMode_Single);
+    TIM_ClearFlag(TIM3, TIM_FLAG_Update);   /*TimeBaseInit产生的更新事件*/
+    TIM_ITConfig(TIM3, TIM_IT_Update, ENABLE);
+
+    /*与USART2同一抢占优先级, 两个中断不会互相打断*/
+    NVIC_InitStructure.NVIC_IRQChannel = TIM3_IRQn;
+    NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 3;
+    NVIC_InitStructure.NVIC_IRQChannelSubPriority = 3;
+    NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+    NVIC_Init(&NVIC_InitStructure);
+
+    rx_len = 0;
+    rx_crc = MB_CRC16_INIT;
+    rx_overrun = 0;
+    head = rx_slot = 0;
+    rtu_enabled = 1;
+}
+
+/**
+ * @brief  是否已启用RTU帧定界, 启用前USART2仍按AT命令方式收进usart2_rcv_ring
+ **/
+uint8_t MB_RTU_Enabled(void)
+{
+    return rtu_enabled;
+}
+
+/**
+ * @brief  USART2中断中调用, 收到一个字节
+ **/
+void MB_RTU_RxByte(uint8_t data)
+{
+    if(rx_len < MB_RTU_FRAME_MAX)
+    {
+        frame_buf[rx_slot][rx_len++] = data;
+        rx_crc = usMBCRC16_Byte(rx_crc, data);
+    }
+    else
+    {
+        rx_overrun = 1;
+    }
+    /*重新开始计静默时间*/
+    TIM3->CNT = 0;
+    TIM3->CR1 |= TIM_CR1_CEN;
+}
+
+/**
+ * @brief  TIM3中断中调用, 线路静默达到3.5字符时间
+ **/
+void MB_RTU_FrameEnd(void)
+{
+    uint8_t next = (rx_slot + 1) % MB_RTU_QUEUE_LEN;
+
+    if(rx_overrun)
+    {
+        mb_rtu_stats.overruns++;
+    }
+    else if(rx_len < 4 || rx_crc != 0)
+    {
+        /*含CRC的整帧再算CRC为0说明校验正确*/
+        mb_rtu_stats.crc_errors++;
+    }
+    else if(next == head)
+    {
+        mb_rtu_stats.dropped++;
+    }
+    else
+    {
+        frame_len[rx_slot] = rx_len;
+        rx_slot = next;
+        mb_rtu_stats.frames++;
+    }
+    rx_len = 0;
+    rx_crc = MB_CRC16_INIT;
+    rx_overrun = 0;
+}
+
+/**
+ * @brief  取出一帧
+ * @param  buf：至少MB_RTU_FRAME_MAX字节
+ * @retval 帧长度(含CRC), 队列空返回0
+ **/
+int32_t MB_RTU_GetFrame(uint8_t * buf)
+{
+    int32_t len = 0;
+
+    if(head == rx_slot)
+    {
+        return 0;
+    }
+    len = frame_len[head];
+    memcpy(buf, frame_buf[head], len);
+    head = (head + 1) % MB_RTU_QUEUE_LEN;
+    return len;
+}
@@ -0,0 +1,52 @@
+#ifndef __MODBUS_RTU_HEADER__
+#define __MODBUS_RTU_HEADER__
+
+#include "stm32f10x.h"
+
+#define MB_RTU_FRAME_MAX    256     /*RTU帧最大长度, 含地址和CRC*/
+#define MB_RTU_QUEUE_LEN    4       /*帧队列槽数, 其中一个槽总在接收中, 最多排队3帧*/
+
+/*
+ * RTU帧定界: 串口中断逐字节收进当前槽并同时计算CRC, 每收一个字节就重启TIM3;
+ * 线路静默3.5个字符时间后TIM3中断认为帧结束, CRC正确的帧入队, 主循环取走处理.
+ */
+typedef struct
+{
+    uint32_t frames;        /*入队的帧数*/
+    uint32_t crc_errors;    /*CRC错误或太短被丢弃的帧数*/
+    uint32_t overruns;      /*超长被丢弃的帧数*/
+    uint32_t dropped;       /*队列满被丢弃的帧数*/
+} MB_RTU_Stats;
+
+extern MB_RTU_Stats mb_rtu_stats;
+
+/**
+ * @brief  初始化帧定界定时器TIM3, 之后USART2收到的字节都按RTU帧处理
+ * @param  baud：串口波特率, 用于计算3.5字符时间
+ * @retval None
+ **/
+void MB_RTU_Init(uint32_t baud);
+
+/**
+ * @brief  是否已启用RTU帧定界, 启用前USART2仍按AT命令方式收进usart2_rcv_ring
+ **/
+uint8_t MB_RTU_Enabled(void);
+
+/**
+ * @brief  USART2中断中调用, 收到一个字节
+ **/
+void MB_RTU_RxByte(uint8_t data);
+
+/**
+ * @brief  TIM3中断中调用, 线路静默达到3.5字符时间
+ **/
+void MB_RTU_FrameEnd(void);
+
+/**
+ * @brief  取出一帧
+ * @param  buf：至少MB_RTU_FRAME_MAX字节
+ * @retval 帧长度(含CRC), 队列空返回0
+ **/
+int32_t MB_RTU_GetFrame(uint8_t * buf);
+
+#endif
@@ -29,13 +29,21 @@
 #include "utils.h"
 #include "esp8266.h"
 #include "modbus.h"
+#include "modbus_master.h"
+#include "log.h"
 
 int main(void)
 {
     /*初始化串口1 用于打印调试信息， 115200 8N1*/
     USART1_Init();
+    /*调试日志经USART1的DMA发送, 主循环中Log_Poll*/
+    Log_Init();
     /*初始化串口2 用于和ESP8266进行数据通信， 115200 8N1*/
     USART2_Init();
+    /*1ms时基, modbus主机调度用*/
+    SystickTime_Init();
+    /*初始化串口3 用于轮询下游RS-485设备*/
+    MB_Master_Init();
     mDelay(1000);
     /*初始化ESP8266模组，并连接CWJAP指定的AP，与MODBUS_CIPSTART配置的MODBUS服务器建立tcp连接*/
     ESP8266_Init((int8_t *)MODBUS_CIPSTART, (int8_t *)CWJAP);
@@ -25,6 +25,9 @@
 #include "stm32f10x_it.h"
 #include "usart1.h"
 #include "usart2.h"
+#include "modbus_rtu.h"
+#include "modbus_master.h"
+#include "utils.h"
 
 extern uint32_t SystickTime;
 extern __IO uint32_t TimeDisplay;
@@ -139,8 +142,7 @@ void PendSV_Handler(void)
   */
 void SysTick_Handler(void)
 {
-    //SystickTime_Increase();
-    //SystickTime++;
+    SystickTime_Increase();
 }
 
 /******************************************************************************/
@@ -198,7 +200,14 @@ void USART2_IRQHandler(void)
     else if(USART2->SR & USART_FLAG_RXNE)   //Receive Data Reg Full Flag
     {		//GPIO_SetBits(GPIOC,GPIO_Pin_0|GPIO_Pin_1|GPIO_Pin_2|GPIO_Pin_3);
         data = USART2->DR;
-				usart2_rcv_buf[usart2_rcv_len++]=data;
+        if(MB_RTU_Enabled())
+        {
+            MB_RTU_RxByte(data);    /*透传后按modbus RTU帧接收*/
+        }
+        else
+        {
+            Ring_PutByte(&usart2_rcv_ring, data);   /*满时丢弃, 计入overflow*/
+        }
 			  //usart1_rcv_buf[usart1_rcv_len++]=data;
         //usart1_putrxchar(data);       //Insert received character into buffer                     
     }
@@ -209,6 +218,44 @@ void USART2_IRQHandler(void)
 		#endif
 }
 
+/**
+  * @brief  This function handles usart3 global interrupt request.
+  *         下游RS-485总线, modbus主机收响应
+  * @param  None
+  * @retval : None
+  */
+void USART3_IRQHandler(void)
+{
+    unsigned int data;
+
+    if(USART3->SR & 0x0F)
+    {
+        // See if we have some kind of error
+        // Clear interrupt (do nothing about it!)
+        data = USART3->DR;
+    }
+    else if(USART3->SR & USART_FLAG_RXNE)   //Receive Data Reg Full Flag
+    {
+        data = USART3->DR;
+        MB_Master_RxByte(data);
+    }
+}
+
+/**
+  * @brief  This function handles TIM3 global interrupt request.
+  *         USART2线路静默3.5字符时间, 一个modbus RTU帧结束
+  * @param  None
+  * @retval : None
+  */
+void TIM3_IRQHandler(void)
+{
+    if(TIM_GetITStatus(TIM3, TIM_IT_Update) != RESET)
+    {
+        TIM_ClearITPendingBit(TIM3, TIM_IT_Update);
+        MB_RTU_FrameEnd();
+    }
+}
+
 /**
   * @brief  This function handles RTC global interrupt request.
   * @param  None
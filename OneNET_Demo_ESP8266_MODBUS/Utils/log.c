@@ -0,0 +1,489 @@
+#include "stm32f10x.h"
+#include "stm32f10x_dma.h"
+#include "stm32f10x_usart.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include "ring.h"
+#include "log.h"
+
+/*
+ * 记录格式: len, level, module, type, 格式串指针, 参数...
+ * 参数按va_arg取出时的类型原样保存, 格式化时再按格式串依次取出.
+ */
+#define LOG_HEAD_LEN    (4 + sizeof(const char *))
+#define LOG_REC_MAX     (LOG_HEAD_LEN + (LOG_HEX_MAX > LOG_ARG_BYTES ? LOG_HEX_MAX : LOG_ARG_BYTES))
+
+volatile uint32_t log_dropped = 0;
+
+static uint8_t log_mem[LOG_RING_LEN];
+static Ring log_ring;
+static char log_tx_buf[LOG_TX_LEN];
+static volatile uint8_t log_tx_busy = 0;
+static uint32_t log_dropped_shown = 0;
+
+static const char log_level_char[] = "-EWID";
+static const char *const log_mod_name[] = {"APP", "NET", "MQTT", "EDP", "SENSOR", "MODBUS"};
+
+/*一个转换说明的解析结果*/
+typedef struct
+{
+    char conv;          /*转换字符, 格式串结束时为0*/
+    uint8_t lng;        /*l的个数*/
+    uint8_t stars;      /*宽度和精度中'*'的个数*/
+} LogSpec;
+
+/*
+ *  @brief 解析一个转换说明
+ *  @param p:指向'%'之后
+ *  @retval 指向转换字符之后
+ */
+static const char *Log_ParseSpec(const char *p, LogSpec *spec)
+{
+    spec->lng = 0;
+    spec->stars = 0;
+    while(*p == '-' || *p == '+' || *p == ' ' || *p == '#' || *p == '0')
+    {
+        p++;
+    }
+    if(*p == '*')
+    {
+        spec->stars++;
+        p++;
+    }
+    while(*p >= '0' && *p <= '9')
+    {
+        p++;
+    }
+    if(*p == '.')
+    {
+        p++;
+        if(*p == '*')
+        {
+            spec->stars++;
+            p++;
+        }
+        while(*p >= '0' && *p <= '9')
+        {
+            p++;
+        }
+    }
+    while(*p == 'h' || *p == 'l' || *p == 'L' || *p == 'z' || *p == 'j' || *p == 't')
+    {
+        if(*p == 'l')
+        {
+            spec->lng++;
+        }
+        p++;
+    }
+    spec->conv = *p;
+    return *p ? p + 1 : p;
+}
+
+/*
+ *  @brief 转换说明对应参数的字节数, 0表示不取参数
+ */
+static uint32_t Log_ArgSize(const LogSpec *spec)
+{
+    switch(spec->conv)
+    {
+        case 'd':
+        case 'i':
+        case 'u':
+        case 'x':
+        case 'X':
+        case 'o':
+        case 'c':
+            if(spec->lng >= 2)
+            {
+                return sizeof(long long);
+            }
+            return spec->lng ? sizeof(long) : sizeof(int);
+        case 'f':
+        case 'F':
+        case 'e':
+        case 'E':
+        case 'g':
+        case 'G':
+            return sizeof(double);
+        case 's':
+        case 'p':
+            return sizeof(void *);
+        default:
+            return 0;
+    }
+}
+
+/*
+ *  @brief 记录放进缓冲区, 放不下则整条丢掉
+ */
+static void Log_Commit(uint8_t *rec, uint32_t len, uint8_t level, uint8_t module, uint8_t type, const char *fmt)
+{
+    uint32_t primask;
+
+    rec[0] = len;
+    rec[1] = level;
+    rec[2] = module;
+    rec[3] = type;
+    memcpy(rec + 4, &fmt, sizeof(fmt));
+
+    /*可能被中断中的日志打断, 关中断保证整条记录连续*/
+    primask = __get_PRIMASK();
+    __disable_irq();
+    if(Ring_Free(&log_ring) >= len)
+    {
+        Ring_Put(&log_ring, rec, len);
+    }
+    else
+    {
+        log_dropped++;
+    }
+    __set_PRIMASK(primask);
+}
+
+/*
+ *  @brief 初始化日志缓冲区和USART1的DMA发送, 在USART1_Init之后调用
+ */
+void Log_Init(void)
+{
+    DMA_InitTypeDef DMA_InitStructure;
+
+    Ring_Init(&log_ring, log_mem, LOG_RING_LEN);
+
+    /*USART1_TX对应DMA1通道4*/
+    RCC_AHBPeriphClockCmd(RCC_AHBPeriph_DMA1, ENABLE);
+    DMA_DeInit(DMA1_Channel4);
+    DMA_InitStructure.DMA_PeripheralBaseAddr = (uint32_t)&USART1->DR;
+    DMA_InitStructure.DMA_MemoryBaseAddr = (uint32_t)log_tx_buf;
+    DMA_InitStructure.DMA_DIR = DMA_DIR_PeripheralDST;
+    DMA_InitStructure.DMA_BufferSize = 0;
+    DMA_InitStructure.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
+    DMA_InitStructure.DMA_MemoryInc = DMA_MemoryInc_Enable;
+    DMA_InitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_Byte;
+    DMA_InitStructure.DMA_MemoryDataSize = DMA_MemoryDataSize_Byte;
+    DMA_InitStructure.DMA_Mode = DMA_Mode_Normal;
+    DMA_InitStructure.DMA_Priority = DMA_Priority_Low;
+    DMA_InitStructure.DMA_M2M = DMA_M2M_Disable;
+    DMA_Init(DMA1_Channel4, &DMA_InitStructure);
+    USART_DMACmd(USART1, USART_DMAReq_Tx, ENABLE);
+}
+
+/*
+ *  @brief 记录一条日志, 中断中也可调用; 一般通过LOG_x宏调用
+ *  @param level:LOG_LEVEL_xxx
+ *  @param module:LOG_MOD_xxx
+ *  @param fmt:printf格式串, 必须是常量字符串
+ */
+void Log_Write(uint8_t level, uint8_t module, const char *fmt, ...)
+{
+    uint8_t rec[LOG_REC_MAX];
+    uint32_t n = LOG_HEAD_LEN;
+    uint32_t size = 0;
+    uint8_t i = 0;
+    const char *p = fmt;
+    LogSpec spec;
+    va_list ap;
+    int iv;
+    long lv;
+    long long llv;
+    double dv;
+    void *pv;
+
+    va_start(ap, fmt);
+    while((p = strchr(p, '%')) != NULL)
+    {
+        p = Log_ParseSpec(p + 1, &spec);
+        size = Log_ArgSize(&spec);
+        if(size == 0 && spec.stars == 0)
+        {
+            continue;
+        }
+        if(n + spec.stars * sizeof(int) + size > LOG_HEAD_LEN + LOG_ARG_BYTES)
+        {
+            break;      /*参数太多, 后面的不保存, 格式化时也不输出*/
+        }
+        for(i = 0; i < spec.stars; i++)
+        {
+            iv = va_arg(ap, int);
+            memcpy(rec + n, &iv, sizeof(iv));
+            n += sizeof(iv);
+        }
+        switch(spec.conv)
+        {
+            case 'f':
+            case 'F':
+            case 'e':
+            case 'E':
+            case 'g':
+            case 'G':
+                dv = va_arg(ap, double);
+                memcpy(rec + n, &dv, sizeof(dv));
+                break;
+            case 's':
+            case 'p':
+                pv = va_arg(ap, void *);
+                memcpy(rec + n, &pv, sizeof(pv));
+                break;
+            default:
+                if(spec.lng >= 2)
+                {
+                    llv = va_arg(ap, long long);
+                    memcpy(rec + n, &llv, sizeof(llv));
+                }
+                else if(spec.lng)
+                {
+                    lv = va_arg(ap, long);
+                    memcpy(rec + n, &lv, sizeof(lv));
+                }
+                else if(size)
+                {
+                    iv = va_arg(ap, int);
+                    memcpy(rec + n, &iv, sizeof(iv));
+                }
+                break;
+        }
+        n += size;
+    }
+    va_end(ap);
+
+    Log_Commit(rec, n, level, module, LOG_REC_FMT, fmt);
+}
+
+/*
+ *  @brief 记录一段二进制数据, 超过LOG_HEX_MAX的部分截掉
+ *  @param title:标题, 必须是常量字符串
+ */
+void Log_Hex(uint8_t level, uint8_t module, const char *title, const uint8_t *buf, uint32_t len)
+{
+    uint8_t rec[LOG_REC_MAX];
+
+    if(len > LOG_HEX_MAX)
+    {
+        len = LOG_HEX_MAX;
+    }
+    memcpy(rec + LOG_HEAD_LEN, buf, len);
+    Log_Commit(rec, LOG_HEAD_LEN + len, level, module, LOG_REC_HEX, title);
+}
+
+/*
+ *  @brief 追加格式化文本, 超出size时截断
+ *  @retval 追加后的长度
+ */
+static uint32_t Log_Append(char *out, uint32_t o, uint32_t size, const char *fmt, ...)
+{
+    va_list ap;
+    int n;
+
+    if(o + 1 >= size)
+    {
+        return o;
+    }
+    va_start(ap, fmt);
+    n = vsnprintf(out + o, size - o, fmt, ap);
+    va_end(ap);
+    if(n < 0)
+    {
+        return o;
+    }
+    o += n;
+    return o < size ? o : size - 1;
+}
+
+/*
+ *  @brief 把一条记录格式化成文本(不含换行)
+ *  @param rec:一条完整的记录
+ *  @param out:输出缓冲区, 以0结尾
+ *  @param size:out的大小
+ *  @retval 文本长度
+ */
+uint32_t Log_Format(const uint8_t *rec, char *out, uint32_t size)
+{
+    uint32_t len = rec[0];
+    uint8_t level = rec[1];
+    uint8_t module = rec[2];
+    const uint8_t *arg = rec + LOG_HEAD_LEN;
+    const uint8_t *end = rec + len;
+    const char *fmt, *p, *start;
+    char spec_str[24];
+    uint32_t o = 0, k, argsize;
+    uint8_t mod = 0;
+    LogSpec spec;
+    int iv;
+    long lv;
+    long long llv;
+    double dv;
+    void *pv;
+
+    memcpy(&fmt, rec + 4, sizeof(fmt));
+    while(mod < sizeof(log_mod_name) / sizeof(log_mod_name[0]) - 1 && !(module & (1 << mod)))
+    {
+        mod++;
+    }
+    o = Log_Append(out, o, size, "[%c][%s] ",
+                   log_level_char[level < sizeof(log_level_char) - 1 ? level : 0], log_mod_name[mod]);
+
+    if(rec[3] == LOG_REC_HEX)
+    {
+        o = Log_Append(out, o, size, "%s %u:", fmt, (unsigned)(end - arg));
+        while(arg < end)
+        {
+            o = Log_Append(out, o, size, " %02x", *arg++);
+        }
+        return o;
+    }
+
+    p = fmt;
+    while(*p && o + 1 < size)
+    {
+        if(*p != '%')
+        {
+            out[o++] = *p++;
+            continue;
+        }
+        start = p;
+        p = Log_ParseSpec(p + 1, &spec);
+        if(spec.conv == '%')
+        {
+            out[o++] = '%';
+            continue;
+        }
+        argsize = Log_ArgSize(&spec);
+        if(argsize == 0 && spec.stars == 0)
+        {
+            continue;       /*不支持的转换说明, 不输出*/
+        }
+        if(arg + spec.stars * sizeof(int) + argsize > end)
+        {
+            break;          /*记录时被截掉的参数*/
+        }
+
+        /*重新拼出转换说明, '*'换成保存的数值; 只保留h和l, 与保存的类型一致*/
+        k = 0;
+        while(start < p && k < sizeof(spec_str) - 12)
+        {
+            if(*start == '*')
+            {
+                memcpy(&iv, arg, sizeof(iv));
+                arg += sizeof(iv);
+                k += snprintf(spec_str + k, sizeof(spec_str) - k, "%d", iv);
+            }
+            else if(*start != 'L' && *start != 'z' && *start != 'j' && *start != 't')
+            {
+                spec_str[k++] = *start;
+            }
+            start++;
+        }
+        spec_str[k] = 0;
+
+        switch(spec.conv)
+        {
+            case 'f':
+            case 'F':
+            case 'e':
+            case 'E':
+            case 'g':
+            case 'G':
+                memcpy(&dv, arg, sizeof(dv));
+                o = Log_Append(out, o, size, spec_str, dv);
+                break;
+            case 's':
+            case 'p':
+                memcpy(&pv, arg, sizeof(pv));
+                if(spec.conv == 's' && pv == NULL)
+                {
+                    pv = "(null)";
+                }
+                o = Log_Append(out, o, size, spec_str, pv);
+                break;
+            default:
+                if(spec.lng >= 2)
+                {
+                    memcpy(&llv, arg, sizeof(llv));
+                    o = Log_Append(out, o, size, spec_str, llv);
+                }
+                else if(spec.lng)
+                {
+                    memcpy(&lv, arg, sizeof(lv));
+                    o = Log_Append(out, o, size, spec_str, lv);
+                }
+                else
+                {
+                    memcpy(&iv, arg, sizeof(iv));
+                    o = Log_Append(out, o, size, spec_str, iv);
+                }
+                break;
+        }
+        arg += argsize;
+    }
+
+    /*换行由Log_Poll统一加*/
+    while(o > 0 && (out[o - 1] == '\n' || out[o - 1] == '\r'))
+    {
+        o--;
+    }
+    out[o] = 0;
+    return o;
+}
+
+/*
+ *  @brief 用DMA发出log_tx_buf的前len字节
+ */
+static void Log_Start(uint32_t len)
+{
+    DMA_Cmd(DMA1_Channel4, DISABLE);
+    DMA_ClearFlag(DMA1_FLAG_TC4);
+    DMA1_Channel4->CNDTR = len;
+    log_tx_busy = 1;
+    DMA_Cmd(DMA1_Channel4, ENABLE);
+}
+
+/*
+ *  @brief 上一批发完后格式化并发出下一批, 不阻塞, 主循环中调用
+ */
+void Log_Poll(void)
+{
+    uint8_t rec[LOG_REC_MAX];
+    uint32_t n = 0;
+    uint32_t dropped;
+
+    if(log_tx_busy)
+    {
+        if(DMA_GetFlagStatus(DMA1_FLAG_TC4) == RESET)
+        {
+            return;
+        }
+        log_tx_busy = 0;
+    }
+
+    dropped = log_dropped;
+    if(dropped != log_dropped_shown)
+    {
+        n = Log_Append(log_tx_buf, n, LOG_TX_LEN, "[W][LOG] %u dropped\r\n", (unsigned)(dropped - log_dropped_shown));
+        log_dropped_shown = dropped;
+    }
+    /*每条至少留LOG_LINE_MAX, 放不下的留到下一批*/
+    while(n + LOG_LINE_MAX + 2 <= LOG_TX_LEN && Ring_Peek(&log_ring, 0, rec, 1) == 1)
+    {
+        Ring_Get(&log_ring, rec, rec[0]);
+        n += Log_Format(rec, log_tx_buf + n, LOG_LINE_MAX);
+        log_tx_buf[n++] = '\r';
+        log_tx_buf[n++] = '\n';
+    }
+
+    if(n > 0)
+    {
+        Log_Start(n);
+    }
+}
+
+/*
+ *  @brief 等待正在进行的DMA发送结束, printf直接写USART1之前调用
+ */
+void Log_Sync(void)
+{
+    if(log_tx_busy)
+    {
+        while(DMA_GetFlagStatus(DMA1_FLAG_TC4) == RESET);
+        while(USART_GetFlagStatus(USART1, USART_FLAG_TXE) == RESET);
+    }
+}
@@ -0,0 +1,94 @@
+#ifndef __LOG_HEADER__
+#define __LOG_HEADER__
+#include <stdint.h>
+
+/*
+ * 分级、分模块的调试日志, 经USART1输出.
+ *
+ * LOG_x()只把格式串地址和参数拷进环形缓冲区就返回, 不格式化也不等串口;
+ * 主循环调用Log_Poll()时才格式化, 并用DMA1通道4发出去.
+ * 低于LOG_LEVEL或不在LOG_MODULES中的日志在编译期就被去掉, 参数也不会求值.
+ *
+ * 限制: 参数最多LOG_ARG_BYTES字节(int和指针4字节, double和long long 8字节), 多出的不输出;
+ *       %s的参数只保存指针, 必须是常量字符串(如__func__), 不能是栈上的缓冲区.
+ */
+
+/*级别*/
+#define LOG_LEVEL_NONE      0
+#define LOG_LEVEL_ERROR     1
+#define LOG_LEVEL_WARN      2
+#define LOG_LEVEL_INFO      3
+#define LOG_LEVEL_DEBUG     4
+
+/*编译期保留的最低级别, 调试版默认全部保留*/
+#ifndef LOG_LEVEL
+#ifdef _DEBUG
+#define LOG_LEVEL           LOG_LEVEL_DEBUG
+#else
+#define LOG_LEVEL           LOG_LEVEL_INFO
+#endif
+#endif
+
+/*模块, 每个一位*/
+#define LOG_MOD_APP         0x01
+#define LOG_MOD_NET         0x02    /*ESP8266/USART2*/
+#define LOG_MOD_MQTT        0x04
+#define LOG_MOD_EDP         0x08
+#define LOG_MOD_SENSOR      0x10
+#define LOG_MOD_MODBUS      0x20
+
+/*编译期保留的模块*/
+#ifndef LOG_MODULES
+#define LOG_MODULES         0xFF
+#endif
+
+#define LOG_ARG_BYTES       32      /*每条日志最多保存的参数字节数*/
+#define LOG_HEX_MAX         64      /*LOG_HEX每条最多保存的字节数, 多出的截掉*/
+#define LOG_RING_LEN        2048    /*记录缓冲区, 必须是2的幂*/
+#define LOG_TX_LEN          512     /*一次DMA发送的文本缓冲区*/
+#define LOG_LINE_MAX        256     /*一条日志格式化后的最大长度*/
+
+#define LOG_REC_FMT         0
+#define LOG_REC_HEX         1
+
+#define LOG_ON(level, mod)  ((level) <= LOG_LEVEL && ((mod) & LOG_MODULES))
+
+#define LOG_WRITE(level, mod, ...) \
+    do { if(LOG_ON(level, mod)) Log_Write(level, mod, __VA_ARGS__); } while(0)
+
+#define LOG_E(mod, ...)     LOG_WRITE(LOG_LEVEL_ERROR, mod, __VA_ARGS__)
+#define LOG_W(mod, ...)     LOG_WRITE(LOG_LEVEL_WARN, mod, __VA_ARGS__)
+#define LOG_I(mod, ...)     LOG_WRITE(LOG_LEVEL_INFO, mod, __VA_ARGS__)
+#define LOG_D(mod, ...)     LOG_WRITE(LOG_LEVEL_DEBUG, mod, __VA_ARGS__)
+
+/*buf按十六进制输出, title须为常量字符串*/
+#define LOG_HEX(level, mod, title, buf, len) \
+    do { if(LOG_ON(level, mod)) Log_Hex(level, mod, title, buf, len); } while(0)
+
+extern volatile uint32_t log_dropped;  /*缓冲区满被丢掉的日志条数*/
+
+/*
+ *  @brief 初始化日志缓冲区和USART1的DMA发送, 在USART1_Init之后调用
+ */
+void Log_Init(void);
+/*
+ *  @brief 记录一条日志, 中断中也可调用; 一般通过LOG_x宏调用
+ */
+void Log_Write(uint8_t level, uint8_t module, const char *fmt, ...);
+/*
+ *  @brief 记录一段二进制数据
+ */
+void Log_Hex(uint8_t level, uint8_t module, const char *title, const uint8_t *buf, uint32_t len);
+/*
+ *  @brief 上一批发完后格式化并发出下一批, 不阻塞, 主循环中调用
+ */
+void Log_Poll(void);
+/*
+ *  @brief 等待正在进行的DMA发送结束, printf直接写USART1之前调用
+ */
+void Log_Sync(void);
+/*
+ *  @brief 把一条记录格式化成文本(不含换行), 返回长度; 由Log_Poll调用
+ */
+uint32_t Log_Format(const uint8_t *rec, char *out, uint32_t size);
+#endif
@@ -17,8 +17,32 @@ uint8_t prvucMBBIN2CHAR(uint8_t ucByte);
 void uDelay(uint32_t i);
 
 void mDelay(uint32_t i);
+
+/*
+ *  @brief SysTick毫秒计时, 1ms中断一次
+ */
+void SystickTime_Init(void);
+void SystickTime_Increase(void);
+/*
+ *  @brief 上电以来的毫秒数, 约49天回绕, 比较先后请用差值: (int32_t)(a - b) < 0
+ */
+uint32_t SystickTime_Get(void);
+/*
+ * CRC16查表切片数: 1为逐字节(表512字节), 4或8每次处理4/8字节(表2K/4K字节, 放在flash)
+ */
+#ifndef MB_CRC_SLICE
+#define MB_CRC_SLICE 4
+#endif
+
+#define MB_CRC16_INIT 0xFFFF
+
 /*
  *  @brief MODBU协议要求的CRC16校验
  */
 uint16_t usMBCRC16(uint8_t * pucFrame, uint16_t usLen);
+/*
+ *  @brief CRC16增量计算, 从MB_CRC16_INIT开始, 分段调用的结果与整段调用usMBCRC16相同
+ */
+uint16_t usMBCRC16_Update(uint16_t usCRC, const uint8_t * pucFrame, uint16_t usLen);
+uint16_t usMBCRC16_Byte(uint16_t usCRC, uint8_t ucByte);
 #endif
@@ -6,6 +6,7 @@
 #include "hal_i2c.h"
 #include "sht20.h"
 #include "utils.h"
+#include "log.h"
 
 const int16_t POLYNOMIAL = 0x131;
 int8_t SHT2x_CheckCrc(int8_t data[], int8_t nbrOfBytes, int8_t checksum);
@@ -94,18 +95,18 @@ int8_t SHT2x_MeasureHM(uint8_t cmd, uint16_t *pMeasurand)
     if(cmd == SHT20_Measurement_T_HM)
     {
         t = SHT2x_CalcTemperatureC(tmp);
-        printf("%s data[0]=%d,data[1]=%d,checksum=%d,t=%f\n", __func__, data[0], data[1], SHT2x_CheckCrc(data, 2, checksum), t);
+        LOG_D(LOG_MOD_SENSOR, "%s data[0]=%d,data[1]=%d,checksum=%d,t=%f", __func__, data[0], data[1], SHT2x_CheckCrc(data, 2, checksum), t);
     }
     else
     {
         t = SHT2x_CalcRH(tmp);
-        printf("%s data[0]=%d,data[1]=%d,checksum=%d,rh=%f%\n", __func__, data[0], data[1], SHT2x_CheckCrc(data, 2, checksum), t);
+        LOG_D(LOG_MOD_SENSOR, "%s data[0]=%d,data[1]=%d,checksum=%d,rh=%f%%", __func__, data[0], data[1], SHT2x_CheckCrc(data, 2, checksum), t);
     }
     if(pMeasurand)
     {
         *pMeasurand = (uint16_t)t;
     }
-    printf("%s %d\n", __func__, *pMeasurand);
+    LOG_D(LOG_MOD_SENSOR, "%s %d", __func__, *pMeasurand);
     return 0;
 }
 #if 0
@@ -160,7 +161,7 @@ int8_t SHT2x_MeasurePoll(uint8_t cmd, uint16_t *pMeasurand, int32_t timeout)
     while(!I2C_CheckEvent(I2C2, I2C_EVENT_MASTER_BYTE_RECEIVED));
     if (i >= 200)
     {
-        printf("timeout\n");
+        LOG_W(LOG_MOD_SENSOR, "%s timeout", __func__);
         goto timeout_l;
     }
     //-- read two data bytes and one checksum byte --
@@ -177,12 +178,12 @@ int8_t SHT2x_MeasurePoll(uint8_t cmd, uint16_t *pMeasurand, int32_t timeout)
     if(cmd == SHT20_Measurement_T_HM)
     {
         t = SHT2x_CalcTemperatureC(tmp);
-        printf("%s data[0]=%d,data[1]=%d,checksum=%d,t=%f\n", __func__, data[0], data[1], SHT2x_CheckCrc(data, 2, checksum), t);
+        LOG_D(LOG_MOD_SENSOR, "%s data[0]=%d,data[1]=%d,checksum=%d,t=%f", __func__, data[0], data[1], SHT2x_CheckCrc(data, 2, checksum), t);
     }
     else
     {
         t = SHT2x_CalcRH(tmp);
-        printf("%s data[0]=%d,data[1]=%d,checksum=%d,rh=%f%\n", __func__, data[0], data[1], SHT2x_CheckCrc(data, 2, checksum), t);
+        LOG_D(LOG_MOD_SENSOR, "%s data[0]=%d,data[1]=%d,checksum=%d,rh=%f%%", __func__, data[0], data[1], SHT2x_CheckCrc(data, 2, checksum), t);
     }
     if(pMeasurand)
     {
@@ -3,6 +3,7 @@
 #include "stm32f10x_exti.h"
 #include "misc.h"
 #include "usart1.h"
+#include "log.h"
 #include <stdio.h>
 uint8_t usart1_rcv_buf[256];
 volatile uint32_t  usart1_rcv_len = 0;
@@ -76,6 +77,7 @@ void USART1_Write(USART_TypeDef* USARTx, uint8_t *Data, uint32_t len)
 PUTCHAR_PROTOTYPE
 {
     //Place your implementation of fputc here , e.g. write a character to the USART
+    Log_Sync();     /*等日志的DMA发完, 避免两路输出交错*/
     USART_SendData(USART1, (uint8_t)ch);
     //Loop until the end of transmission
     while (USART_GetFlagStatus(USART1, USART_FLAG_TXE) == RESET);
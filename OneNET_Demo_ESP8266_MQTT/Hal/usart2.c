@@ -1,6 +1,7 @@
 #include "stm32f10x.h"
 #include "stm32f10x_usart.h"
 #include "stm32f10x_exti.h"
+#include "stm32f10x_dma.h"
 #include "misc.h"
 #include "usart2.h"
 #include "stm32f10x.h"
@@ -8,8 +9,37 @@
 #include "stdlib.h"
 #include "string.h"
 
-uint8_t  usart2_rcv_buf[MAX_RCV_LEN];
-volatile uint32_t   usart2_rcv_len = 0;
+Ring usart2_rcv_ring;
+static uint8_t usart2_rcv_mem[USART2_RCV_RING_LEN];
+static uint8_t usart2_rcv_buf[MAX_RCV_LEN];     /*USART2_RcvFind用的字符串副本*/
+volatile uint32_t   usart2_rcv_errors = 0;
+
+/*DMA循环接收区, DMA一直往里写, 中断里把新数据搬到usart2_rcv_ring*/
+static uint8_t usart2_dma_buf[USART2_DMA_LEN];
+static uint16_t usart2_dma_rd = 0;             /*DMA接收区中已搬走的位置*/
+static volatile uint8_t usart2_rcv_idle = 0;   /*收到数据后线路空闲过*/
+
+/*
+ * DMA发送队列, 环形:
+ * [tx_head, tx_done)为DMA已发完、还没回调的项, [tx_done, tx_tail)为正在发和排队的项.
+ * tx_done只在DMA中断中前移, tx_head/tx_tail只在主循环中前移.
+ */
+static struct
+{
+    const uint8_t *buf;
+    uint16_t len;
+    USART2_TxDone done;
+    void *arg;
+    uint32_t cycle;         /*DMA发完时的DWT周期计数*/
+} usart2_tx_queue[USART2_TX_QUEUE_LEN];
+static volatile uint8_t usart2_tx_head = 0;
+static volatile uint8_t usart2_tx_done = 0;
+static volatile uint8_t usart2_tx_tail = 0;
+static volatile uint8_t usart2_tx_busy = 0;
+static uint32_t usart2_tx_cycle = 0;            /*正在回调的项发完时的周期计数*/
+
+/*Cortex-M3 DWT周期计数器, 由使用者打开(DEMCR.TRCENA), 没打开时读到的值不变*/
+#define USART2_CYCCNT   (*(volatile uint32_t *)0xE0001004)
 
 /*
  *  @brief USART2初始化函数
@@ -19,6 +49,9 @@ void USART2_Init(void)
     GPIO_InitTypeDef GPIO_InitStructure;
     USART_InitTypeDef USART_InitStructure;
     NVIC_InitTypeDef NVIC_InitStructure;
+    DMA_InitTypeDef DMA_InitStructure;
+
+    Ring_Init(&usart2_rcv_ring, usart2_rcv_mem, USART2_RCV_RING_LEN);
 
     /* config USART2 clock */
     RCC_APB2PeriphClockCmd(RCC_APB2Periph_GPIOA , ENABLE);
@@ -36,51 +69,322 @@ void USART2_Init(void)
     GPIO_Init(GPIOA, &GPIO_InitStructure);
 
     /* USART2 mode config */
-    USART_InitStructure.USART_BaudRate = 115200;
+    USART_InitStructure.USART_BaudRate = USART2_BAUD_DEFAULT;
     USART_InitStructure.USART_WordLength = USART_WordLength_8b;
     USART_InitStructure.USART_StopBits = USART_StopBits_1;
     USART_InitStructure.USART_Parity = USART_Parity_No ;
     USART_InitStructure.USART_HardwareFlowControl = USART_HardwareFlowControl_None;
     USART_InitStructure.USART_Mode = USART_Mode_Rx | USART_Mode_Tx;
     USART_Init(USART2, &USART_InitStructure);
+
+    /* USART2_RX is DMA1 channel 6, circular: the CPU is not involved per byte */
+    RCC_AHBPeriphClockCmd(RCC_AHBPeriph_DMA1, ENABLE);
+    DMA_DeInit(DMA1_Channel6);
+    DMA_InitStructure.DMA_PeripheralBaseAddr = (uint32_t)&USART2->DR;
+    DMA_InitStructure.DMA_MemoryBaseAddr = (uint32_t)usart2_dma_buf;
+    DMA_InitStructure.DMA_DIR = DMA_DIR_PeripheralSRC;
+    DMA_InitStructure.DMA_BufferSize = USART2_DMA_LEN;
+    DMA_InitStructure.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
+    DMA_InitStructure.DMA_MemoryInc = DMA_MemoryInc_Enable;
+    DMA_InitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_Byte;
+    DMA_InitStructure.DMA_MemoryDataSize = DMA_MemoryDataSize_Byte;
+    DMA_InitStructure.DMA_Mode = DMA_Mode_Circular;
+    DMA_InitStructure.DMA_Priority = DMA_Priority_High;
+    DMA_InitStructure.DMA_M2M = DMA_M2M_Disable;
+    DMA_Init(DMA1_Channel6, &DMA_InitStructure);
+    //半满/全满时搬一次, 保证DMA绕回前数据已被取走
+    DMA_ITConfig(DMA1_Channel6, DMA_IT_HT | DMA_IT_TC, ENABLE);
+    DMA_Cmd(DMA1_Channel6, ENABLE);
+    USART_DMACmd(USART2, USART_DMAReq_Rx, ENABLE);
+
+    /* USART2_TX is DMA1 channel 7, started per queued buffer */
+    DMA_DeInit(DMA1_Channel7);
+    DMA_InitStructure.DMA_PeripheralBaseAddr = (uint32_t)&USART2->DR;
+    DMA_InitStructure.DMA_MemoryBaseAddr = 0;
+    DMA_InitStructure.DMA_DIR = DMA_DIR_PeripheralDST;
+    DMA_InitStructure.DMA_BufferSize = 0;
+    DMA_InitStructure.DMA_Mode = DMA_Mode_Normal;
+    DMA_InitStructure.DMA_Priority = DMA_Priority_Medium;
+    DMA_Init(DMA1_Channel7, &DMA_InitStructure);
+    DMA_ITConfig(DMA1_Channel7, DMA_IT_TC, ENABLE);
+    USART_DMACmd(USART2, USART_DMAReq_Tx, ENABLE);
+
     USART_Cmd(USART2, ENABLE);
 
-    //Enable usart2 receive interrupt
-    USART_ITConfig(USART2, USART_IT_RXNE, ENABLE);
+    //Enable usart2 idle-line and error interrupts, bytes themselves go through DMA
+    USART_ITConfig(USART2, USART_IT_IDLE, ENABLE);
+    USART_ITConfig(USART2, USART_IT_ERR, ENABLE);
 
     NVIC_InitStructure.NVIC_IRQChannel = USART2_IRQn;
     NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 3;
     NVIC_InitStructure.NVIC_IRQChannelSubPriority = 2;
     NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
     NVIC_Init(&NVIC_InitStructure);
+
+    //与USART2同一抢占优先级, 两个中断不会互相打断
+    NVIC_InitStructure.NVIC_IRQChannel = DMA1_Channel6_IRQn;
+    NVIC_Init(&NVIC_InitStructure);
+    NVIC_InitStructure.NVIC_IRQChannel = DMA1_Channel7_IRQn;
+    NVIC_Init(&NVIC_InitStructure);
 }
+
 /*
-*  @brief USART2串口发送api
-*/
-void USART2_Write(USART_TypeDef* USARTx, uint8_t *Data, uint32_t len)
+ *  @brief 修改USART2的波特率和硬件流控, 先等发送队列发完, 丢掉已接收的数据
+ *  @param baud: 波特率
+ *  @param flow: 非0时启用RTS(PA1)/CTS(PA0)硬件流控, 为0时不动这两个脚
+ */
+void USART2_SetBaud(uint32_t baud, uint8_t flow)
+{
+    GPIO_InitTypeDef GPIO_InitStructure;
+    USART_InitTypeDef USART_InitStructure;
+
+    USART2_TxFlush();
+
+    if(flow)
+    {
+        /* Configure USART2 RTS (PA.01) as alternate function push-pull */
+        GPIO_InitStructure.GPIO_Pin = GPIO_Pin_1;
+        GPIO_InitStructure.GPIO_Mode = GPIO_Mode_AF_PP;
+        GPIO_InitStructure.GPIO_Speed = GPIO_Speed_50MHz;
+        GPIO_Init(GPIOA, &GPIO_InitStructure);
+        /* Configure USART2 CTS (PA.00) as input floating */
+        GPIO_InitStructure.GPIO_Pin = GPIO_Pin_0;
+        GPIO_InitStructure.GPIO_Mode = GPIO_Mode_IN_FLOATING;
+        GPIO_Init(GPIOA, &GPIO_InitStructure);
+    }
+
+    //USART_Init只改BRR和数据格式、流控位, DMA请求和中断使能保持不变
+    USART_Cmd(USART2, DISABLE);
+    USART_InitStructure.USART_BaudRate = baud;
+    USART_InitStructure.USART_WordLength = USART_WordLength_8b;
+    USART_InitStructure.USART_StopBits = USART_StopBits_1;
+    USART_InitStructure.USART_Parity = USART_Parity_No ;
+    USART_InitStructure.USART_HardwareFlowControl = flow ? USART_HardwareFlowControl_RTS_CTS : USART_HardwareFlowControl_None;
+    USART_InitStructure.USART_Mode = USART_Mode_Rx | USART_Mode_Tx;
+    USART_Init(USART2, &USART_InitStructure);
+    USART_Cmd(USART2, ENABLE);
+
+    //切换过程中收到的多半是乱码
+    USART2_RcvClear();
+}
+
+/*
+ *  @brief 把DMA接收区中新到的数据搬到usart2_rcv_ring, 在USART2空闲中断和DMA半满/全满中断中调用
+ *  @param idle: 非0表示线路已空闲, 一段连续数据收完
+ */
+void USART2_RcvUpdate(uint8_t idle)
+{
+    uint16_t wr = USART2_DMA_LEN - DMA_GetCurrDataCounter(DMA1_Channel6);
+    uint16_t n = 0;
+
+    if(wr >= USART2_DMA_LEN)
+    {
+        wr = 0;
+    }
+    while(usart2_dma_rd != wr)
+    {
+        /*一次搬到接收区末尾或写位置, 环形缓冲区满时多出的字节计入overflow*/
+        n = (wr > usart2_dma_rd ? wr : USART2_DMA_LEN) - usart2_dma_rd;
+        Ring_Put(&usart2_rcv_ring, usart2_dma_buf + usart2_dma_rd, n);
+        usart2_dma_rd = (usart2_dma_rd + n) % USART2_DMA_LEN;
+    }
+    if(idle && Ring_Count(&usart2_rcv_ring) > 0)
+    {
+        usart2_rcv_idle = 1;
+    }
+}
+/*
+ *  @brief 启动队列中下一项的DMA发送, 队列空则置空闲; 在DMA中断中或关中断时调用
+ */
+static void USART2_TxStart(void)
+{
+    uint8_t i = usart2_tx_done;
+
+    DMA_Cmd(DMA1_Channel7, DISABLE);
+    if(i == usart2_tx_tail)
+    {
+        usart2_tx_busy = 0;
+        return;
+    }
+    usart2_tx_busy = 1;
+    DMA1_Channel7->CMAR = (uint32_t)usart2_tx_queue[i].buf;
+    DMA1_Channel7->CNDTR = usart2_tx_queue[i].len;
+    USART_ClearFlag(USART2, USART_FLAG_TC);     /*USART2_TxFlush靠TC判断最后一个字节已发出*/
+    DMA_Cmd(DMA1_Channel7, ENABLE);
+}
+
+/*
+ *  @brief DMA1通道7中断中调用, 一项发完
+ */
+void USART2_TxComplete(void)
+{
+    usart2_tx_queue[usart2_tx_done].cycle = USART2_CYCCNT;
+    usart2_tx_done = (usart2_tx_done + 1) % USART2_TX_QUEUE_LEN;
+    USART2_TxStart();
+}
+
+/*
+ *  @brief 对已发完的项执行完成回调, 在主循环中调用, 回调因此不在中断上下文里
+ */
+void USART2_TxPoll(void)
+{
+    uint8_t i;
+
+    while(usart2_tx_head != usart2_tx_done)
+    {
+        i = usart2_tx_head;
+        usart2_tx_head = (i + 1) % USART2_TX_QUEUE_LEN;
+        if(usart2_tx_queue[i].done)
+        {
+            usart2_tx_cycle = usart2_tx_queue[i].cycle;
+            usart2_tx_queue[i].done(usart2_tx_queue[i].arg);
+        }
+    }
+}
+
+/*
+ *  @brief 正在执行的完成回调所对应的数据发完时(DMA中断中)的DWT周期计数, 只在回调中有效
+ */
+uint32_t USART2_TxDoneCycle(void)
+{
+    return usart2_tx_cycle;
+}
+
+/*队列空位数*/
+static uint8_t USART2_TxFree(void)
+{
+    return USART2_TX_QUEUE_LEN - 1
+           - (usart2_tx_tail + USART2_TX_QUEUE_LEN - usart2_tx_head) % USART2_TX_QUEUE_LEN;
+}
+
+/*追加一项, 调用者保证有空位*/
+static void USART2_TxPut(const uint8_t *buf, uint16_t len, USART2_TxDone done, void *arg)
+{
+    uint8_t i = usart2_tx_tail;
+
+    usart2_tx_queue[i].buf = buf;
+    usart2_tx_queue[i].len = len;
+    usart2_tx_queue[i].done = done;
+    usart2_tx_queue[i].arg = arg;
+    __disable_irq();
+    usart2_tx_tail = (i + 1) % USART2_TX_QUEUE_LEN;
+    if(!usart2_tx_busy)
+    {
+        USART2_TxStart();
+    }
+    __enable_irq();
+}
+
+/*
+ *  @brief 非阻塞发送一组缓冲区(scatter list), 首尾相接发出
+ *  @param vec: 缓冲区列表, 每个缓冲区在回调之前必须保持有效; vec本身调用后即可释放
+ *  @param cnt: 缓冲区个数
+ *  @param done: 全部发完后在USART2_TxPoll中调用, 可为NULL
+ *  @retval 0成功; -1缓冲区个数超过队列长度
+ *  @note  队列满时等待空位, 其余情况立即返回
+ */
+int32_t USART2_WriteV(const USART2_TxVec *vec, uint32_t cnt, USART2_TxDone done, void *arg)
 {
     uint32_t i;
-    USART_ClearFlag(USARTx, USART_FLAG_TC);
-    for(i = 0; i < len; i++)
+    uint32_t need = 0;
+    uint32_t last = 0;
+    uint32_t off, n;
+
+    /*DMA一次最多65535字节, 超长的拆成多项*/
+    for(i = 0; i < cnt; i++)
+    {
+        need += (vec[i].len + 0xFFFF - 1) / 0xFFFF;
+        if(vec[i].len)
+        {
+            last = i;
+        }
+    }
+    if(need > USART2_TX_QUEUE_LEN - 1)
+    {
+        return -1;
+    }
+    USART2_TxPoll();
+    while(USART2_TxFree() < need)
+    {
+        USART2_TxPoll();
+    }
+    for(i = 0; i < cnt; i++)
+    {
+        for(off = 0; off < vec[i].len; off += n)
+        {
+            n = vec[i].len - off;
+            if(n > 0xFFFF)
+            {
+                n = 0xFFFF;
+            }
+            /*只有整组的最后一段带回调*/
+            if(i == last && off + n == vec[i].len)
+            {
+                USART2_TxPut(vec[i].buf + off, n, done, arg);
+            }
+            else
+            {
+                USART2_TxPut(vec[i].buf + off, n, NULL, NULL);
+            }
+        }
+    }
+    if(need == 0 && done)
+    {
+        usart2_tx_cycle = USART2_CYCCNT;
+        done(arg);  /*没有数据要发*/
+    }
+    return 0;
+}
+
+/*
+ *  @brief 非阻塞发送一个缓冲区, 见USART2_WriteV
+ */
+int32_t USART2_WriteAsync(const uint8_t *buf, uint32_t len, USART2_TxDone done, void *arg)
+{
+    USART2_TxVec vec;
+
+    vec.buf = buf;
+    vec.len = len;
+    return USART2_WriteV(&vec, 1, done, arg);
+}
+
+/*
+ *  @brief 等待队列全部发出(含最后一个字节的停止位)并执行完回调
+ */
+void USART2_TxFlush(void)
+{
+    while(usart2_tx_busy || usart2_tx_done != usart2_tx_tail)
     {
-        USART_SendData(USARTx, *Data++);
-        while( USART_GetFlagStatus(USARTx, USART_FLAG_TC) == RESET );
+        USART2_TxPoll();
     }
+    while(USART_GetFlagStatus(USART2, USART_FLAG_TC) == RESET);
+    USART2_TxPoll();
+}
+
+/*
+*  @brief USART2串口发送api, 阻塞到发完, Data可以是栈上的缓冲区
+*/
+void USART2_Write(USART_TypeDef* USARTx, uint8_t *Data, uint32_t len)
+{
+    USART2_WriteAsync(Data, len, NULL, NULL);
+    USART2_TxFlush();
 }
 /*
  *  @brief USART2串口发送AT命令用
  */
 void SendCmd(int8_t* cmd, int8_t* result, int32_t timeOut)
 {
+    char *found;
+
     while(1)
     {
-        memset(usart2_rcv_buf, 0, strlen(usart2_rcv_buf));
-        usart2_rcv_len = 0;
+        USART2_RcvClear();
 
         USART2_Write(USART2, cmd, strlen(cmd));
         mDelay(timeOut);
+        found = USART2_RcvFind(result);
         printf("%s %d cmd:%s,rsp:%s\n", __func__, __LINE__, cmd, usart2_rcv_buf);
-        if((NULL != strstr(usart2_rcv_buf, result)))
+        if(NULL != found)
         {
             break;
         }
@@ -96,18 +400,58 @@ void SendCmd(int8_t* cmd, int8_t* result, int32_t timeOut)
  */
 uint32_t USART2_GetRcvNum(void)
 {
-    return usart2_rcv_len;
+    return Ring_Count(&usart2_rcv_ring);
+}
+/*
+ *  @brief 上次调用以来是否收到过数据且线路随后空闲, 即一段连续数据已完整收到
+ */
+uint8_t USART2_RcvIdle(void)
+{
+    if(usart2_rcv_idle)
+    {
+        usart2_rcv_idle = 0;
+        return 1;
+    }
+    return 0;
 }
 /*
- *  @brief 返回USART2已接收的数据到buf，长度为rcv_len
+ *  @brief 取走USART2已接收的rcv_len字节到buf, buf为NULL时直接丢掉
+ *         只取走这么多, 拷贝期间新到的数据留给下次, 不会丢
  */
 void  USART2_GetRcvData(uint8_t *buf, uint32_t rcv_len)
 {
+    uint32_t n = Ring_Count(&usart2_rcv_ring);
+
+    if(rcv_len > n)
+    {
+        rcv_len = n;
+    }
     if(buf)
     {
-        memcpy(buf, usart2_rcv_buf, rcv_len);
+        Ring_Get(&usart2_rcv_ring, buf, rcv_len);
+    }
+    else
+    {
+        Ring_Consume(&usart2_rcv_ring, rcv_len);
     }
-    memset(usart2_rcv_buf, 0, strlen(usart2_rcv_buf));
-    usart2_rcv_len = 0;
+}
+/*
+ *  @brief 丢掉已接收的全部数据, 发AT命令前调用
+ */
+void USART2_RcvClear(void)
+{
+    Ring_Flush(&usart2_rcv_ring);
+    usart2_rcv_idle = 0;
+}
+/*
+ *  @brief 在已接收的数据(最多前MAX_RCV_LEN-1字节)中查找字符串, 不取走数据
+ *  @retval 找到时返回副本usart2_rcv_buf中的位置, 否则NULL
+ */
+char *USART2_RcvFind(const char *str)
+{
+    uint32_t n = Ring_Peek(&usart2_rcv_ring, 0, usart2_rcv_buf, MAX_RCV_LEN - 1);
+
+    usart2_rcv_buf[n] = 0;
+    return strstr((char *)usart2_rcv_buf, str);
 }
 #endif
@@ -3,19 +3,93 @@
 #include "stdio.h"
 #include "stdlib.h"
 #include "string.h"
-#define MAX_RCV_LEN 256
+#include "ring.h"
+#define MAX_RCV_LEN 256         /*查找AT应答时最多看的字节数*/
+#define USART2_RCV_RING_LEN 512 /*接收环形缓冲区, 必须是2的幂*/
+#define USART2_DMA_LEN 512      /*DMA循环接收区, 半满中断要在另一半写满前处理完*/
+#define USART2_TX_QUEUE_LEN 8   /*DMA发送队列长度, 最多排队7个缓冲区*/
+
+#define USART2_BAUD_DEFAULT 115200  /*模组上电后的波特率*/
+/*
+ * 与模组协商时依次尝试的波特率. APB1为36MHz, 这几个都能精确分频, 最高可到2250000;
+ * 线短、接触好时可以把2000000加在最前面.
+ */
+#define USART2_BAUD_LIST    {921600, 460800, 230400}
+/*
+ * 1: 启用RTS/CTS硬件流控, PA1(RTS)接模组GPIO13(CTS), PA0(CTS)接模组GPIO15(RTS).
+ * 接收走DMA, 单片机的RTS基本不会撤销, 流控主要防止发太快把模组的缓冲区写满.
+ */
+#ifndef USART2_FLOW_CTRL
+#define USART2_FLOW_CTRL    0
+#endif
+
+/*发送完成回调, 在USART2_TxPoll中(主循环上下文)调用*/
+typedef void (*USART2_TxDone)(void *arg);
+
+typedef struct
+{
+    const uint8_t *buf;
+    uint32_t len;
+} USART2_TxVec;
 
 /*
  *  @brief USART2初始化函数
  */
 extern void USART2_Init(void);
 /*
- *  @brief USART2串口发送api
+ *  @brief 修改USART2的波特率和硬件流控, 先等发送队列发完, 丢掉已接收的数据
+ */
+extern void USART2_SetBaud(uint32_t baud, uint8_t flow);
+/*
+ *  @brief USART2串口发送api, 阻塞到发完
  */
 extern void USART2_Write(USART_TypeDef* USARTx, uint8_t *Data, uint32_t len);
-extern uint8_t  usart2_rcv_buf[MAX_RCV_LEN];
-
-extern volatile uint32_t   usart2_rcv_len;
+/*
+ *  @brief 非阻塞发送, 缓冲区交给DMA后立即返回(队列满时等空位), 发完后调用done
+ *         缓冲区在done被调用之前必须保持有效
+ */
+extern int32_t USART2_WriteAsync(const uint8_t *buf, uint32_t len, USART2_TxDone done, void *arg);
+/*
+ *  @brief 非阻塞发送一组缓冲区(scatter list), 全部发完后调用一次done
+ */
+extern int32_t USART2_WriteV(const USART2_TxVec *vec, uint32_t cnt, USART2_TxDone done, void *arg);
+/*
+ *  @brief 执行已发完项的回调, 主循环中定期调用
+ */
+extern void USART2_TxPoll(void);
+/*
+ *  @brief 完成回调中调用: 数据实际发完(DMA中断)时的DWT周期计数, 不含等待USART2_TxPoll的时间
+ */
+extern uint32_t USART2_TxDoneCycle(void);
+/*
+ *  @brief 阻塞等待发送队列清空, 关机/复位模组前调用
+ */
+extern void USART2_TxFlush(void);
+/*
+ *  @brief DMA1通道7发送完成中断中调用
+ */
+extern void USART2_TxComplete(void);
+/*
+ *  接收数据: 中断写入, 主循环读取. usart2_rcv_ring.overflow为缓冲区满被丢掉的字节数
+ */
+extern Ring usart2_rcv_ring;
+extern volatile uint32_t   usart2_rcv_errors;      /*硬件溢出/噪声/帧错误次数*/
+/*
+ *  @brief 把DMA接收区中新到的数据搬到usart2_rcv_ring, 中断中调用
+ */
+void USART2_RcvUpdate(uint8_t idle);
+/*
+ *  @brief 一段连续数据是否已完整收到(线路空闲), 读后清除
+ */
+uint8_t USART2_RcvIdle(void);
+/*
+ *  @brief 丢掉已接收的全部数据, 发AT命令前调用
+ */
+void USART2_RcvClear(void);
+/*
+ *  @brief 在已接收的数据(最多前MAX_RCV_LEN-1字节)中查找字符串, 不取走数据
+ */
+char *USART2_RcvFind(const char *str);
 /*
  *  @brief USART2串口发送AT命令用
  */
@@ -25,7 +99,7 @@ void SendCmd(int8_t* cmd, int8_t* result, int32_t timeOut);
  */
 uint32_t USART2_GetRcvNum(void);
 /*
- *  @brief 返回USART2已接收的数据到buf，长度为rcv_len
+ *  @brief 取走USART2已接收的rcv_len字节到buf, buf为NULL时直接丢掉, 之后到达的数据不受影响
  */
 void  USART2_GetRcvData(uint8_t *buf, uint32_t rcv_len);
 #endif
@@ -2,6 +2,94 @@
 
 uint32_t ESP8266_SendData(int8_t * buf, uint32_t len);
 
+/**
+  * @brief  发一条AT命令, 在timeOut毫秒内等待预期的应答, 不重试
+  * @retval 1收到预期应答, 0超时
+  **/
+static uint8_t ESP8266_Cmd(const char *cmd, const char *result, uint32_t timeOut)
+{
+    USART2_RcvClear();
+    USART2_Write(USART2, (uint8_t *)cmd, strlen(cmd));
+    while(timeOut >= 10)
+    {
+        mDelay(10);
+        if(NULL != USART2_RcvFind(result))
+        {
+            return 1;
+        }
+        timeOut -= 10;
+    }
+    return 0;
+}
+
+/**
+  * @brief  校验当前波特率下收发都不出错: 回显要逐字节一致, 模组也要能解析出命令
+  * @retval 1通过, 0失败
+  **/
+static uint8_t ESP8266_EchoTest(void)
+{
+    uint8_t i;
+
+    ESP8266_Cmd(AT, "OK", 100);     /*冲掉模组命令解析器里切换时残留的半行*/
+    for(i = 0; i < ECHO_ROUNDS; i++)
+    {
+        if(!ESP8266_Cmd(ECHO_TEST, "ERROR", 200))
+        {
+            return 0;
+        }
+        if(NULL == USART2_RcvFind("AT+ECHO=" ECHO_PATTERN))
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+  * @brief  用AT+UART_CUR把模组和USART2切到更高的波特率, 依次尝试USART2_BAUD_LIST,
+  *         回显校验不通过时两边退回USART2_BAUD_DEFAULT再试下一个.
+  *         AT+UART_CUR不写flash, 模组复位后回到默认波特率, 所以要在AT+RST之后调用
+  * @retval 最终使用的波特率
+  **/
+uint32_t ESP8266_SetBaud(void)
+{
+    static const uint32_t baud_list[] = USART2_BAUD_LIST;
+    char cmd[40];
+    uint8_t i;
+
+    for(i = 0; i < sizeof(baud_list) / sizeof(baud_list[0]); i++)
+    {
+        /*最后一个参数是流控: 0不用, 3 RTS和CTS都用*/
+        sprintf(cmd, "AT+UART_CUR=%lu,8,1,0,%d\r\n", (unsigned long)baud_list[i], USART2_FLOW_CTRL ? 3 : 0);
+        if(!ESP8266_Cmd(cmd, "OK", 500))
+        {
+            continue;   /*模组不接受, 仍在原波特率*/
+        }
+        mDelay(20);     /*模组回完OK才切换*/
+        USART2_SetBaud(baud_list[i], USART2_FLOW_CTRL);
+        if(ESP8266_EchoTest())
+        {
+            printf("%s %d baud %lu\n", __func__, __LINE__, (unsigned long)baud_list[i]);
+            return baud_list[i];
+        }
+
+        /*新波特率下不可靠, 在新波特率下让模组退回, 单片机也退回*/
+        sprintf(cmd, "AT+UART_CUR=%lu,8,1,0,0\r\n", (unsigned long)USART2_BAUD_DEFAULT);
+        ESP8266_Cmd(cmd, "OK", 500);
+        mDelay(20);
+        USART2_SetBaud(USART2_BAUD_DEFAULT, 0);
+        if(!ESP8266_Cmd(AT, "OK", 500))
+        {
+            /*模组没收到退回命令, 只能留在新波特率, 至少AT命令是通的*/
+            USART2_SetBaud(baud_list[i], USART2_FLOW_CTRL);
+            printf("%s %d echo test failed, stay at %lu\n", __func__, __LINE__, (unsigned long)baud_list[i]);
+            return baud_list[i];
+        }
+    }
+    printf("%s %d baud %lu\n", __func__, __LINE__, (unsigned long)USART2_BAUD_DEFAULT);
+    return USART2_BAUD_DEFAULT;
+}
+
 /**
   * @brief  初始化ESP8266，并配置路由器和连接服务器
   * @param  server:按AT命令配置的服务器地址和端口字符串
@@ -15,14 +103,14 @@ void ESP8266_Init(int8_t * server, int8_t * ssid_pwd)
     SendCmd(CWMODE, "OK", 1000);
     SendCmd(RST, "OK", 2000);   /*重置模组式*/
     SendCmd(CIFSR, "OK", 1000); /*查询设备IP，可放在需要的位置*/
+    ESP8266_SetBaud();  /*复位后才切波特率, 之后的命令和数据都走高波特率*/
     SendCmd(ssid_pwd, "OK", 2000);  /*配置要连接的路由器SSID和密码*/
     SendCmd(server, "OK", 2000); /*与服务器建立TCP连接*/
     SendCmd(CIPMODE, "OK", 1000); /*透传模式*/
-    memset(usart2_rcv_buf, 0, strlen(usart2_rcv_buf)); /*先清除接收缓冲区*/
-    usart2_rcv_len = 0;
+    USART2_RcvClear(); /*先清除接收缓冲区*/
     USART2_Write(USART2, CIPSEND, strlen(CIPSEND)); /*开始透传*/
     mDelay(500);
-    if((NULL != strstr(usart2_rcv_buf, "ERROR")))
+    if((NULL != USART2_RcvFind("ERROR")))
     {
         return;
     }
@@ -36,8 +124,7 @@ void ESP8266_Init(int8_t * server, int8_t * ssid_pwd)
   **/
 uint32_t ESP8266_SendData(int8_t * buf, uint32_t len)
 {
-    memset(usart2_rcv_buf, 0, strlen(usart2_rcv_buf));
-    usart2_rcv_len = 0;
+    USART2_RcvClear();
     USART2_Write(USART2, buf, len);
     mDelay(100);
 }
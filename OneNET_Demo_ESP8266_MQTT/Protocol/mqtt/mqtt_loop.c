@@ -18,6 +18,7 @@
 #include <time.h>
 
 #include "usart2.h"
+#include "log.h"
 #include "mqtt_loop.h"
 
 unsigned char send_buf[MAX_MQTT_LEN];
@@ -57,21 +58,20 @@ static const struct Command commands[] =
 #endif
 static int MqttSample_RecvPkt(unsigned char *buf)
 {
-    int bytes;
-    int timeout = 200;
-
-    int i = 0;
+    int bytes = 0;
+    int timeout = 20000;
 
     while(1)
     {
-        mDelay(100);
-        bytes = USART2_GetRcvNum();
-        //USART2_GetRcvData(buf, bytes);
-        if(bytes > 0)
+        /*线路空闲说明这一段数据已收完, 不用再靠延时猜*/
+        if(USART2_RcvIdle())
         {
-					  mDelay(50);
-						bytes = USART2_GetRcvNum();
-						USART2_GetRcvData(buf, bytes);
+            bytes = USART2_GetRcvNum();
+            if(bytes > MAX_RCV_LEN)
+            {
+                bytes = MAX_RCV_LEN;
+            }
+            USART2_GetRcvData(buf, bytes);
             break;
         }
         if(timeout == 0)
@@ -79,18 +79,12 @@ static int MqttSample_RecvPkt(unsigned char *buf)
 
             break;
         }
+        Log_Poll();
+        mDelay(1);
         timeout--;
     }
-    printf("bytes=%d\n", bytes);
-    if(bytes > 0)
-    {
-        printf("\r\n----------\r\n");
-        for(i = 0; i < bytes; i++)
-        {
-            printf("0x%x ", ((unsigned char *)buf)[i]);
-        }
-        printf("\r\n----------\r\n");
-    }
+    LOG_D(LOG_MOD_MQTT, "recv bytes=%d", bytes);
+    LOG_HEX(LOG_LEVEL_DEBUG, LOG_MOD_MQTT, "recv", buf, bytes);
     return bytes;
 }
 
@@ -100,7 +94,13 @@ static int MqttSample_SendPkt(void *arg, const struct iovec *iov, int iovcnt)
     int bytes = 0;
     int i = 0, j = 0;
     struct iovec *tmp;
-    memset(send_buf, 0, MAX_MQTT_LEN);
+    USART2_TxVec vec[USART2_TX_QUEUE_LEN - 1];
+
+    /*上一包可能还在DMA发送中, 等它发完才能复用send_buf*/
+    USART2_TxFlush();
+    /*丢掉之前残留的接收数据, 之后收到的就是这一包的应答*/
+    USART2_RcvClear();
+
     for(i = 0; i < iovcnt; i++)
     {
         tmp = (struct iovec *)(&iov[i]);
@@ -109,10 +109,27 @@ static int MqttSample_SendPkt(void *arg, const struct iovec *iov, int iovcnt)
 
     if(bytes > MAX_MQTT_LEN)
     {
-        printf("%s too much data to send\n", __func__);
-        return -1;
+        /*放不进send_buf的大包直接用iov发, 不拷贝; iov返回后就会被释放, 所以要等发完*/
+        if(iovcnt > USART2_TX_QUEUE_LEN - 1)
+        {
+            LOG_E(LOG_MOD_MQTT, "%s too much data to send", __func__);
+            return -1;
+        }
+        for(i = 0; i < iovcnt; i++)
+        {
+            vec[i].buf = (const uint8_t *)iov[i].iov_base;
+            vec[i].len = iov[i].iov_len;
+        }
+        LOG_D(LOG_MOD_MQTT, "send bytes=%d", bytes);
+        if(USART2_WriteV(vec, iovcnt, NULL, NULL) < 0)
+        {
+            return -1;
+        }
+        USART2_TxFlush();
+        return bytes;
     }
 
+    memset(send_buf, 0, MAX_MQTT_LEN);
     for(i = 0; i < iovcnt; i++)
     {
         tmp = (struct iovec *)(&iov[i]);
@@ -120,13 +137,10 @@ static int MqttSample_SendPkt(void *arg, const struct iovec *iov, int iovcnt)
         j += tmp->iov_len;
     }
 
-    printf("\r\n*****bytes=%d******\r\n",bytes);
-    for(i=0;i<bytes;i++)
-    {
-      printf("0x%x ",send_buf[i]);
-    }
-    printf("\r\n*********\r\n");
-    bytes = USART2_SendData(send_buf, bytes);
+    LOG_D(LOG_MOD_MQTT, "send bytes=%d", bytes);
+    LOG_HEX(LOG_LEVEL_DEBUG, LOG_MOD_MQTT, "send", send_buf, bytes);
+    /*交给DMA后立即返回, 应答由MqttSample_RecvPkt等待*/
+    USART2_WriteAsync(send_buf, bytes, NULL, NULL);
     return bytes;
 }
 
@@ -183,7 +197,7 @@ static int MqttSample_HandlePubComp(void *arg, uint16_t pkt_id)
 {
 
     printf("Recv the publish comp, packet id is %d.\n", pkt_id);
-    printf("%s %d\n", __func__, __LINE__);
+    LOG_D(LOG_MOD_MQTT, "%s %d", __func__, __LINE__);
     printf("!!!!!!!!!!!!!!!!!!\n");
     smpctx->publish_state = 0;
     return 0;
@@ -192,7 +206,7 @@ static int MqttSample_HandlePubComp(void *arg, uint16_t pkt_id)
 static int MqttSample_HandleSubAck(void *arg, uint16_t pkt_id, const char *codes, uint32_t count)
 {
     uint32_t i;
-    printf("%s %d\n", __func__, __LINE__);
+    LOG_D(LOG_MOD_MQTT, "%s %d", __func__, __LINE__);
     printf("Recv the subscribe ack, packet id is %d, return code count is %d:.\n", pkt_id, count);
     for(i = 0; i < count; ++i)
     {
@@ -267,13 +281,13 @@ static int MqttSample_CmdConnect(struct MqttSampleContext *ctx)
 {
     int err;
     int bytes = 0;
-    printf("%s %d\n", __func__, __LINE__);
+    LOG_D(LOG_MOD_MQTT, "%s %d", __func__, __LINE__);
     err = Mqtt_PackConnectPkt(ctx->mqttbuf, 0, ctx->devid, 1, "WillTopic",
                               "will message-test", 17, MQTT_QOS_LEVEL0, 0, ctx->proid,
                               ctx->apikey, strlen(ctx->apikey));
     if(MQTTERR_NOERROR != err)
     {
-        printf("Failed to pack the MQTT CONNECT PACKET, errcode is %d.\n", err);
+        LOG_E(LOG_MOD_MQTT, "Failed to pack the MQTT CONNECT PACKET, errcode is %d.\n", err);
         return -1;
     }
     bytes = Mqtt_SendPkt(ctx->mqttctx, ctx->mqttbuf, 0);
@@ -289,11 +303,11 @@ static int MqttSample_CmdPing(struct MqttSampleContext *ctx)
 {
     int err;
     int bytes = 0;
-    printf("%s %d\n", __func__, __LINE__);
+    LOG_D(LOG_MOD_MQTT, "%s %d", __func__, __LINE__);
     err = Mqtt_PackPingReqPkt(ctx->mqttbuf);
     if(MQTTERR_NOERROR != err)
     {
-        printf("Critical bug: failed to pack the ping request packet.err=%d\n", err);
+        LOG_E(LOG_MOD_MQTT, "Critical bug: failed to pack the ping request packet.err=%d\n", err);
         return -1;
     }
     bytes = Mqtt_SendPkt(ctx->mqttctx, ctx->mqttbuf, 0);
@@ -313,7 +327,7 @@ static int MqttSample_CmdPublish(struct MqttSampleContext *ctx)
     static unsigned char count = 0;
     int64_t ts = 0; //no time
     uint16_t temprature[1], rh[1];
-    printf("%s %d,count=%d,cause=%d\n", __func__, __LINE__, count, cause);
+    LOG_D(LOG_MOD_MQTT, "%s %d,count=%d,cause=%d", __func__, __LINE__, count, cause);
     // ts = (int64_t)time(NULL) * 1000;
 
     SHT2x_MeasureHM(SHT20_Measurement_RH_HM, temprature);
@@ -362,7 +376,7 @@ static int MqttSample_CmdPublish(struct MqttSampleContext *ctx)
     err |= Mqtt_PackDataPointFinish(ctx->mqttbuf);
     if(err)
     {
-        printf("Failed to pack data point package.err=%d\n", err);
+        LOG_E(LOG_MOD_MQTT, "Failed to pack data point package.err=%d\n", err);
         return -1;
     }
     bytes = Mqtt_SendPkt(ctx->mqttctx, ctx->mqttbuf, 0);
@@ -392,7 +406,7 @@ static int MqttSample_CmdPublishNormal(struct MqttSampleContext *ctx, uint8_t ca
         return -1;
     }
     ctx->publish_state = 1;
-    printf("%s %d,count=%d,cause=%d\n", __func__, __LINE__, count, cause);
+    LOG_D(LOG_MOD_MQTT, "%s %d,count=%d,cause=%d", __func__, __LINE__, count, cause);
     // ts = (int64_t)time(NULL) * 1000;
     SHT2x_MeasureHM(SHT20_Measurement_RH_HM, temprature);
     mDelay(1500);
@@ -473,7 +487,7 @@ static int MqttSample_CmdPublishNormal(struct MqttSampleContext *ctx, uint8_t ca
 
     if(err)
     {
-        printf("Failed to pack data point package.err=%d\n", err);
+        LOG_E(LOG_MOD_MQTT, "Failed to pack data point package.err=%d\n", err);
         return -1;
     }
     err = Mqtt_AppendLength(ctx->mqttbuf, ext->len);
@@ -496,20 +510,20 @@ static int MqttSample_CmdSubscribe(struct MqttSampleContext *ctx)
 {
     int err;
     int bytes = 0;
-    printf("%s %d\n", __func__, __LINE__);
+    LOG_D(LOG_MOD_MQTT, "%s %d", __func__, __LINE__);
     err = Mqtt_PackSubscribePkt(ctx->mqttbuf, 1, TOPIC_TO_SUB, MQTT_QOS_LEVEL1);
     if(err != MQTTERR_NOERROR)
     {
-        printf("Critical bug: failed to pack the subscribe packet.\n");
+        LOG_E(LOG_MOD_MQTT, "Critical bug: failed to pack the subscribe packet.\n");
         return -1;
     }
 
-    printf("%s %d\n", __func__, __LINE__);
+    LOG_D(LOG_MOD_MQTT, "%s %d", __func__, __LINE__);
     /* err = Mqtt_AppendSubscribeTopic(ctx->mqttbuf, "433223/Bs04OCJioNgpmvjRphRak15j7Z8=/25267/test-2", MQTT_QOS_LEVEL2); */
     if(err != MQTTERR_NOERROR)
     {
-        printf("Critical bug: failed to append the topic to the "
-               "subscribe packet.\n");
+        LOG_E(LOG_MOD_MQTT, "Critical bug: failed to append the topic to the "
+              "subscribe packet.\n");
         return -1;
     }
     bytes = Mqtt_SendPkt(ctx->mqttctx, ctx->mqttbuf, 0);
@@ -525,19 +539,19 @@ static int MqttSample_CmdUnsubscribe(struct MqttSampleContext *ctx)
 {
     int err;
     int bytes = 0;
-    printf("%s %d\n", __func__, __LINE__);
+    LOG_D(LOG_MOD_MQTT, "%s %d", __func__, __LINE__);
     err = Mqtt_PackUnsubscribePkt(ctx->mqttbuf, PACK_FALG_UNSUB, TOPIC_TO_UNSUB);
     if(err != MQTTERR_NOERROR)
     {
-        printf("Critical bug: failed to pack the unsubscribe packet.\n");
+        LOG_E(LOG_MOD_MQTT, "Critical bug: failed to pack the unsubscribe packet.\n");
         return -1;
     }
 
     err = Mqtt_AppendUnsubscribeTopic(ctx->mqttbuf, TOPIC_TO_UNSUB);
     if(err != MQTTERR_NOERROR)
     {
-        printf("Critical bug: failed to append the topic to the "
-               "unsubscribe packet.\n");
+        LOG_E(LOG_MOD_MQTT, "Critical bug: failed to append the topic to the "
+              "unsubscribe packet.\n");
         return -1;
     }
     bytes = Mqtt_SendPkt(ctx->mqttctx, ctx->mqttbuf, 0);
@@ -553,11 +567,11 @@ static int MqttSample_CmdUnsubscribe(struct MqttSampleContext *ctx)
 static int MqttSample_CmdDisconnect(struct MqttSampleContext *ctx)
 {
     int err;
-    printf("%s %d\n", __func__, __LINE__);
+    LOG_D(LOG_MOD_MQTT, "%s %d", __func__, __LINE__);
     err = Mqtt_PackDisconnectPkt(ctx->mqttbuf);
     if(MQTTERR_NOERROR != err)
     {
-        printf("Critical bug: failed to pack the disconnect packet.\n");
+        LOG_E(LOG_MOD_MQTT, "Critical bug: failed to pack the disconnect packet.\n");
         return -1;
     }
     Mqtt_SendPkt(ctx->mqttctx, ctx->mqttbuf, 0);
@@ -569,12 +583,12 @@ static int MqttSample_CmdCmdRet(struct MqttSampleContext *ctx)
 {
     int err;
     int bytes = 0;
-    printf("%s %d\n", __func__, __LINE__);
+    LOG_D(LOG_MOD_MQTT, "%s %d", __func__, __LINE__);
     err = Mqtt_PackCmdRetPkt(ctx->mqttbuf, 1, ctx->cmdid,
                              "dkdkkxiiii", 11, 0);
     if(MQTTERR_NOERROR != err)
     {
-        printf("Critical bug: failed to pack the cmd ret packet.\n");
+        LOG_E(LOG_MOD_MQTT, "Critical bug: failed to pack the cmd ret packet.\n");
         return -1;
     }
     bytes = Mqtt_SendPkt(ctx->mqttctx, ctx->mqttbuf, 0);
@@ -608,7 +622,7 @@ static int MqttSample_Init(struct MqttSampleContext *ctx)
     err = Mqtt_InitContext(ctx->mqttctx, 1 << 8);
     if(MQTTERR_NOERROR != err)
     {
-        printf("Failed to init the MQTT context errcode is %d", err);
+        LOG_E(LOG_MOD_MQTT, "Failed to init the MQTT context errcode is %d", err);
         return -1;
     }
 
@@ -694,7 +708,7 @@ void MQTT_Loop(void)
 				{
 					 smpctx->publish_state=0;
 				}
-				printf("\r\n");
+        Log_Poll();
         mDelay(100);
     }
     /*reclaim the resource防止内存泄露*/
@@ -30,13 +30,18 @@
 #include "usart1.h"
 #include "usart2.h"
 #include "utils.h"
+#include "log.h"
 #include "esp8266.h"
 #include "hal_i2c.h"
 #include "mqtt_loop.h"
 
 int main(void)
 {
+    /*1ms节拍, mDelay按它计时*/
+    SystickTime_Init();
     USART1_Init();
+    /*日志经USART1的DMA输出*/
+    Log_Init();
     USART2_Init();
     mDelay(1000);
     Hal_I2C_Init();
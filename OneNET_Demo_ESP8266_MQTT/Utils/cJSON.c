@@ -33,6 +33,7 @@
 #include "cJSON.h"
 
 static const char *ep;
+static int parse_insitu;    /* set while cJSON_ParseInSitu runs: strings are unescaped into the source buffer */
 
 const char *cJSON_GetErrorPtr(void)
 {
@@ -74,10 +75,70 @@ void cJSON_InitHooks(cJSON_Hooks* hooks)
     cJSON_free   = (hooks->free_fn) ? hooks->free_fn : free;
 }
 
+/* Arena mode: nodes and their strings are bump-allocated from one caller-supplied block. */
+#define CJSON_ARENA_ALIGN 8
+static char *arena_base = 0;
+static size_t arena_size = 0;
+static size_t arena_used = 0;
+static size_t arena_peak = 0;
+static unsigned arena_live = 0;     /* blocks handed out and not yet freed */
+
+void cJSON_InitArena(void *buf, size_t size)
+{
+    arena_base = (char*)buf;
+    arena_size = buf ? size : 0;
+    arena_used = 0;
+    arena_peak = 0;
+    arena_live = 0;
+}
+
+size_t cJSON_ArenaPeak(void)
+{
+    return arena_peak;
+}
+
+/* Allocator for tree nodes and key/value strings. Printed text keeps using cJSON_malloc. */
+static void *cJSON_node_malloc(size_t sz)
+{
+    size_t need = (sz + CJSON_ARENA_ALIGN - 1) & ~(size_t)(CJSON_ARENA_ALIGN - 1);
+    void *ptr;
+
+    if (arena_base && arena_size - arena_used >= need)
+    {
+        ptr = arena_base + arena_used;
+        arena_used += need;
+        if (arena_used > arena_peak) arena_peak = arena_used;
+        arena_live++;
+        return ptr;
+    }
+    return cJSON_malloc(sz);    /* no arena, or arena full: fall back to the heap */
+}
+
+static void cJSON_node_free(void *ptr)
+{
+    if (arena_base && (char*)ptr >= arena_base && (char*)ptr < arena_base + arena_size)
+    {
+        if (--arena_live == 0) arena_used = 0;  /* last document freed: rewind the arena */
+        return;
+    }
+    cJSON_free(ptr);
+}
+
+static char* cJSON_node_strdup(const char* str)
+{
+    size_t len;
+    char* copy;
+
+    len = strlen(str) + 1;
+    if (!(copy = (char*)cJSON_node_malloc(len))) return 0;
+    memcpy(copy, str, len);
+    return copy;
+}
+
 /* Internal constructor. */
 static cJSON *cJSON_New_Item(void)
 {
-    cJSON* node = (cJSON*)cJSON_malloc(sizeof(cJSON));
+    cJSON* node = (cJSON*)cJSON_node_malloc(sizeof(cJSON));
     if (node) memset(node, 0, sizeof(cJSON));
     return node;
 }
@@ -89,17 +150,28 @@ void cJSON_Delete(cJSON *c)
     while (c)
     {
         next = c->next;
+#if CJSON_OBJECT_INDEX
+        if (!(c->type & cJSON_IsReference) && c->index) cJSON_free(c->index);
+#endif
         if (!(c->type & cJSON_IsReference) && c->child) cJSON_Delete(c->child);
-        if (!(c->type & cJSON_IsReference) && c->valuestring) cJSON_free(c->valuestring);
-        if (!(c->type & cJSON_StringIsConst) && c->string) cJSON_free(c->string);
-        cJSON_free(c);
+        if (!(c->type & (cJSON_IsReference | cJSON_ValueIsConst)) && c->valuestring) cJSON_node_free(c->valuestring);
+        if (!(c->type & cJSON_StringIsConst) && c->string) cJSON_node_free(c->string);
+        cJSON_node_free(c);
         c = next;
     }
 }
 
 /* Parse the input text to generate a number, and populate the result into item. */
+/* Powers of ten that are exactly representable as doubles. */
+static const double pow10_tab[23] =
+{
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
 static const char *parse_number(cJSON *item, const char *num)
 {
+    const char *start = num;
     double n = 0, sign = 1, scale = 0;
     int subscale = 0, signsubscale = 1;
 
@@ -121,7 +193,15 @@ static const char *parse_number(cJSON *item, const char *num)
         while (*num >= '0' && *num <= '9') subscale = (subscale * 10) + (*num++ - '0'); /* Number? */
     }
 
-    n = sign * n * pow(10.0, (scale + subscale * signsubscale)); /* number = +/- number.fraction * 10^+/- exponent */
+    scale += subscale * signsubscale;
+    /* number = +/- number.fraction * 10^+/- exponent. While the digits fit 2^53 and 10^|exponent| is exact this is one
+       correctly rounded operation; otherwise let strtod round, so every number print_number writes reads back exactly. */
+    if (n < 9007199254740992.0 && scale >= -22 && scale <= 22)
+    {
+        if (scale < 0)  n = sign * n / pow10_tab[(int)-scale];
+        else            n = sign * n * pow10_tab[(int)scale];
+    }
+    else n = strtod(start, 0);
 
     item->valuedouble = n;
     item->valueint = (int)n;
@@ -145,6 +225,7 @@ typedef struct
     char *buffer;
     int length;
     int offset;
+    int noalloc;    /* buffer belongs to the caller: fail instead of growing it */
 } printbuffer;
 
 static char* ensure(printbuffer *p, int needed)
@@ -154,6 +235,11 @@ static char* ensure(printbuffer *p, int needed)
     if (!p || !p->buffer) return 0;
     needed += p->offset;
     if (needed <= p->length) return p->buffer + p->offset;
+    if (p->noalloc)
+    {
+        p->length = 0, p->buffer = 0;
+        return 0;
+    }
 
     newsize = pow2gt(needed);
     newbuffer = (char*)cJSON_malloc(newsize);
@@ -178,34 +264,101 @@ static int update(printbuffer *p)
     return p->offset + strlen(str);
 }
 
-/* Render the number nicely from the given item into a string. */
-static char *print_number(cJSON *item, printbuffer *p)
+/* Write v in decimal, return the number of chars. 64-bit division only while v does not fit 32 bits. */
+static int print_uint(char *str, unsigned long long v)
 {
-    char *str = 0;
-    double d = item->valuedouble;
-    if (d == 0)
+    char tmp[20];
+    unsigned long v32;
+    int n = 0, i;
+
+    while (v > 0xFFFFFFFFUL)
     {
-        if (p)  str = ensure(p, 2);
-        else    str = (char*)cJSON_malloc(2); /* special case for 0. */
-        if (str) strcpy(str, "0");
+        tmp[n++] = (char)('0' + v % 10);
+        v /= 10;
     }
-    else if (fabs(((double)item->valueint) - d) <= DBL_EPSILON && d <= INT_MAX && d >= INT_MIN)
+    v32 = (unsigned long)v;
+    do
     {
-        if (p)  str = ensure(p, 21);
-        else    str = (char*)cJSON_malloc(21);  /* 2^64+1 can be represented in 21 chars. */
-        if (str)    sprintf(str, "%d", item->valueint);
+        tmp[n++] = (char)('0' + v32 % 10);
+        v32 /= 10;
     }
-    else
+    while (v32);
+    for (i = 0; i < n; i++) str[i] = tmp[n - 1 - i];
+    str[n] = 0;
+    return n;
+}
+
+/* Shortest "int.frac" form of d (d not integral) that reads back as exactly d; 0 if it needs more than 15 decimals.
+   n/10^k is a single correctly rounded division, so if it equals d the k-decimal text names d exactly. */
+static int print_fixed(char *str, double d)
+{
+    char *s = str;
+    double a = d < 0 ? -d : d;
+    unsigned long long n, scale;
+    unsigned long frac;
+    int k, i;
+
+    for (k = 1; k < 16 && a * pow10_tab[k] < 9.0e15; k++)    /* keep n below 2^53 */
     {
-        if (p)  str = ensure(p, 64);
-        else    str = (char*)cJSON_malloc(64);  /* This is a nice tradeoff. */
-        if (str)
+        n = (unsigned long long)(a * pow10_tab[k] + 0.5);
+        if ((double)n / pow10_tab[k] != a) continue;
+
+        while (n % 10 == 0) n /= 10, k--;   /* a rounded-up guess may carry a trailing zero */
+        scale = (unsigned long long)pow10_tab[k];
+        if (d < 0) *s++ = '-';
+        s += print_uint(s, n / scale);
+        *s++ = '.';
+        n %= scale;
+        for (i = k - 1; i >= 0; i--)
         {
-            if (fabs(floor(d) - d) <= DBL_EPSILON && fabs(d) < 1.0e60)sprintf(str, "%.0f", d);
-            else if (fabs(d) < 1.0e-6 || fabs(d) > 1.0e9)           sprintf(str, "%e", d);
-            else                                                sprintf(str, "%f", d);
+            frac = (unsigned long)(n % 10);
+            s[i] = (char)('0' + frac);
+            n /= 10;
         }
+        s += k;
+        *s = 0;
+        return (int)(s - str);
+    }
+    return 0;
+}
+
+/* Format d into str (at least 64 chars), return the length. */
+static int format_number(char *str, double d)
+{
+    int prec;
+
+    if (d == 0)
+    {
+        strcpy(str, "0");    /* special case for 0. */
+        return 1;
     }
+    if (d > -9.0e18 && d < 9.0e18 && (double)(long long)d == d)
+    {
+        if (d > 0) return print_uint(str, (unsigned long long)d);
+        str[0] = '-';
+        return 1 + print_uint(str + 1, (unsigned long long)(-d));
+    }
+    prec = print_fixed(str, d);
+    if (prec) return prec;
+    /* Very large, very small or long-fraction values: shortest %.15g..%.17g that reads back exactly. */
+    for (prec = 15; prec < 17; prec++)
+    {
+        sprintf(str, "%.*g", prec, d);
+        if (strtod(str, 0) == d) return (int)strlen(str);
+    }
+    return sprintf(str, "%.17g", d);
+}
+
+/* Render the number nicely from the given item into a string. */
+static char *print_number(cJSON *item, printbuffer *p)
+{
+    char tmp[64];
+    char *str;
+    int len = format_number(tmp, item->valuedouble);
+
+    if (p)  str = ensure(p, len + 1);
+    else    str = (char*)cJSON_malloc(len + 1);    /* exactly the length */
+    if (str) memcpy(str, tmp, len + 1);
     return str;
 }
 
@@ -237,6 +390,12 @@ static unsigned parse_hex4(const char *str)
     return h;
 }
 
+/* True if 4 more characters follow before the terminator; never reads past it. */
+static int has_hex4(const char *str)
+{
+    return str[0] && str[1] && str[2] && str[3];
+}
+
 /* Parse the input text into an unescaped cstring, and populate item. */
 static const unsigned char firstByteMark[7] = { 0x00, 0x00, 0xC0, 0xE0, 0xF0, 0xF8, 0xFC };
 static const char *parse_string(cJSON *item, const char *str)
@@ -245,6 +404,8 @@ static const char *parse_string(cJSON *item, const char *str)
     char *ptr2;
     char *out;
     int len = 0;
+    int closed;
+    int bad = 0;
     unsigned uc, uc2;
     if (*str != '\"')
     {
@@ -252,19 +413,31 @@ static const char *parse_string(cJSON *item, const char *str)
         return 0;
     }
 
-    while (*ptr != '\"' && *ptr && ++len) if (*ptr++ == '\\') ptr++; /* Skip escaped quotes. */
+    if (parse_insitu)
+    {
+        out = (char*)str + 1;   /* unescaping never grows the text, so write over the source */
+    }
+    else
+    {
+        while (*ptr != '\"' && *ptr && ++len) if (*ptr++ == '\\' && *ptr) ptr++; /* Skip escaped quotes. */
 
-    out = (char*)cJSON_malloc(len + 1); /* This is how long we need for the string, roughly. */
-    if (!out) return 0;
+        out = (char*)cJSON_node_malloc(len + 1); /* This is how long we need for the string, roughly. */
+        if (!out) return 0;
+    }
 
     ptr = str + 1;
     ptr2 = out;
-    while (*ptr != '\"' && *ptr)
+    while (!bad && *ptr != '\"' && *ptr)
     {
         if (*ptr != '\\') *ptr2++ = *ptr++;
         else
         {
             ptr++;
+            if (!*ptr)
+            {
+                bad = 1;    /* '\\' right before the terminator */
+                break;
+            }
             switch (*ptr)
             {
                 case 'b':
@@ -283,6 +456,11 @@ static const char *parse_string(cJSON *item, const char *str)
                     *ptr2++ = '\t';
                     break;
                 case 'u':    /* transcode utf16 to utf8. */
+                    if (!has_hex4(ptr + 1))
+                    {
+                        bad = 1;    /* truncated unicode escape */
+                        break;
+                    }
                     uc = parse_hex4(ptr + 1);
                     ptr += 4;  /* get the unicode char. */
 
@@ -291,6 +469,11 @@ static const char *parse_string(cJSON *item, const char *str)
                     if (uc >= 0xD800 && uc <= 0xDBFF) /* UTF16 surrogate pairs.   */
                     {
                         if (ptr[1] != '\\' || ptr[2] != 'u')    break; /* missing second-half of surrogate.    */
+                        if (!has_hex4(ptr + 3))
+                        {
+                            bad = 1;    /* truncated second half */
+                            break;
+                        }
                         uc2 = parse_hex4(ptr + 3);
                         ptr += 6;
                         if (uc2 < 0xDC00 || uc2 > 0xDFFF)       break; /* invalid second-half of surrogate.    */
@@ -326,10 +509,18 @@ static const char *parse_string(cJSON *item, const char *str)
             ptr++;
         }
     }
+    closed = (*ptr == '\"');  /* test before terminating: in situ the NUL may land on the quote */
+    if (bad || !closed)
+    {
+        /* truncated escape or unterminated string; in situ the NUL would land on the sentinel */
+        if (!parse_insitu) cJSON_node_free(out);
+        ep = str;
+        return 0;
+    }
     *ptr2 = 0;
-    if (*ptr == '\"') ptr++;
+    ptr++;
     item->valuestring = out;
-    item->type = cJSON_String;
+    item->type = cJSON_String | (parse_insitu ? cJSON_ValueIsConst : 0);
     return ptr;
 }
 
@@ -475,6 +666,19 @@ cJSON *cJSON_Parse(const char *value)
     return cJSON_ParseWithOpts(value, 0, 0);
 }
 
+cJSON *cJSON_ParseInSitu(char *buf, size_t len)
+{
+    cJSON *c;
+    char saved = buf[len];
+
+    buf[len] = 0;       /* sentinel, restored below: the tree's strings end before it */
+    parse_insitu = 1;
+    c = cJSON_ParseWithOpts(buf, 0, 1);
+    parse_insitu = 0;
+    buf[len] = saved;
+    return c;
+}
+
 /* Render a cJSON item/entity/structure to text. */
 char *cJSON_Print(cJSON *item)
 {
@@ -491,10 +695,79 @@ char *cJSON_PrintBuffered(cJSON *item, int prebuffer, int fmt)
     p.buffer = (char*)cJSON_malloc(prebuffer);
     p.length = prebuffer;
     p.offset = 0;
+    p.noalloc = 0;
     return print_value(item, 0, fmt, &p);
     return p.buffer;
 }
 
+/* Exact length print_value would produce for item, without writing it anywhere. */
+static int measure_value(cJSON *item, int depth, int fmt)
+{
+    char num[64];
+    printbuffer p;
+    const unsigned char *ptr;
+    cJSON *child;
+    int len, i;
+
+    switch ((item->type) & 255)
+    {
+        case cJSON_NULL:
+        case cJSON_True:
+            return 4;
+        case cJSON_False:
+            return 5;
+        case cJSON_Number:
+            p.buffer = num, p.length = sizeof(num), p.offset = 0, p.noalloc = 1;
+            if (!print_number(item, &p)) return -1;
+            return strlen(num);
+        case cJSON_String:
+            len = 2;
+            if (!item->valuestring) return len;
+            for (ptr = (const unsigned char*)item->valuestring; *ptr; ptr++)
+            {
+                if (strchr("\"\\\b\f\n\r\t", *ptr)) len += 2;
+                else if (*ptr < 32) len += 6;
+                else len++;
+            }
+            return len;
+        case cJSON_Array:
+            len = 2;
+            for (child = item->child; child; child = child->next)
+            {
+                if ((i = measure_value(child, depth + 1, fmt)) < 0) return -1;
+                len += i + (child->next ? (fmt ? 2 : 1) : 0);
+            }
+            return len;
+        case cJSON_Object:
+            if (!item->child) return fmt && depth > 1 ? depth + 2 : (fmt ? 3 : 2);
+            len = fmt ? 3 + depth : 2;
+            depth++;
+            for (child = item->child; child; child = child->next)
+            {
+                cJSON key;
+                key.type = cJSON_String;
+                key.valuestring = child->string;
+                if ((i = measure_value(child, depth, fmt)) < 0) return -1;
+                len += i + measure_value(&key, depth, fmt) + (fmt ? depth + 3 : 1) + (child->next ? 1 : 0);
+            }
+            return len;
+    }
+    return -1;
+}
+
+int cJSON_PrintToBuffer(cJSON *item, char *buf, int size, int fmt)
+{
+    printbuffer p;
+    if (!item) return -1;
+    if (!buf) return measure_value(item, 0, fmt);
+    p.buffer = buf;
+    p.length = size;
+    p.offset = 0;
+    p.noalloc = 1;
+    if (!print_value(item, 0, fmt, &p) || !p.buffer) return -1;
+    return update(&p);
+}
+
 
 /* Parser core - when encountering text, process appropriately. */
 static const char *parse_value(cJSON *item, const char *value)
@@ -769,12 +1042,14 @@ static const char *parse_object(cJSON *item, const char *value)
     if (!value) return 0;
     child->string = child->valuestring;
     child->valuestring = 0;
+    if (parse_insitu) child->type = cJSON_StringIsConst;
     if (*value != ':')
     {
         ep = value;    /* fail! */
         return 0;
     }
     value = skip(parse_value(child, skip(value + 1))); /* skip any spacing, get the value. */
+    if (parse_insitu) child->type |= cJSON_StringIsConst;
     if (!value) return 0;
 
     while (*value == ',')
@@ -788,12 +1063,14 @@ static const char *parse_object(cJSON *item, const char *value)
         if (!value) return 0;
         child->string = child->valuestring;
         child->valuestring = 0;
+        if (parse_insitu) child->type = cJSON_StringIsConst;
         if (*value != ':')
         {
             ep = value;    /* fail! */
             return 0;
         }
         value = skip(parse_value(child, skip(value + 1))); /* skip any spacing, get the value. */
+        if (parse_insitu) child->type |= cJSON_StringIsConst;
         if (!value) return 0;
     }
 
@@ -970,13 +1247,120 @@ cJSON *cJSON_GetArrayItem(cJSON *array, int item)
     while (c && item > 0) item--, c = c->next;
     return c;
 }
-cJSON *cJSON_GetObjectItem(cJSON *object, const char *string)
+
+#if CJSON_OBJECT_INDEX
+/* Hash index of object members. Built on the first lookup that walks at least CJSON_INDEX_MIN_ITEMS members,
+   kept in sync by the add/detach/replace functions, dropped (and later rebuilt) when members are reordered.
+   Linear probing in member order, so the first match found is the first in the list, as without an index. */
+#define CJSON_INDEX_MIN_ITEMS 8
+
+struct cJSON_Index
+{
+    unsigned mask;      /* slot count - 1, slot count is a power of two */
+    unsigned used;      /* members plus tombstones */
+    cJSON *slot[1];
+};
+
+static cJSON index_tombstone;   /* left in place of a detached member so probe chains stay intact */
+
+/* Case-folded FNV-1a: one index serves both case-insensitive and case-sensitive lookups. */
+static unsigned cJSON_hash(const char *str)
 {
-    cJSON *c = object->child;
-    while (c && cJSON_strcasecmp(c->string, string)) c = c->next;
+    unsigned h = 2166136261u;
+    while (*str) h = (h ^ (unsigned)tolower(*(const unsigned char *)str++)) * 16777619u;
+    return h;
+}
+
+static void index_drop(cJSON *object)
+{
+    if (object->index) cJSON_free(object->index);
+    object->index = 0;
+}
+
+static void index_put(cJSON_Index *idx, cJSON *item)
+{
+    unsigned i = cJSON_hash(item->string) & idx->mask;
+    while (idx->slot[i]) i = (i + 1) & idx->mask;   /* tombstones are not reused: that would break member order */
+    idx->slot[i] = item;
+    idx->used++;
+}
+
+static void index_build(cJSON *object)
+{
+    unsigned count = 0, size = 16;
+    cJSON_Index *idx;
+    cJSON *c;
+
+    index_drop(object);
+    for (c = object->child; c; c = c->next) count++;
+    while (size < count * 2) size <<= 1;
+    idx = (cJSON_Index*)cJSON_malloc(sizeof(cJSON_Index) + (size - 1) * sizeof(cJSON*));
+    if (!idx) return;   /* no index: lookups stay linear */
+    memset(idx->slot, 0, size * sizeof(cJSON*));
+    idx->mask = size - 1;
+    idx->used = 0;
+    for (c = object->child; c; c = c->next) if (c->string) index_put(idx, c);
+    object->index = idx;
+}
+
+/* item has just been linked at the end of object. */
+static void index_add(cJSON *object, cJSON *item)
+{
+    if (!object->index || !item->string) return;
+    if ((object->index->used + 1) * 2 > object->index->mask + 1) index_build(object);
+    else index_put(object->index, item);
+}
+
+static cJSON **index_slot(cJSON *object, cJSON *item)
+{
+    cJSON_Index *idx = object->index;
+    unsigned i;
+    if (!idx || !item->string) return 0;
+    for (i = cJSON_hash(item->string) & idx->mask; idx->slot[i]; i = (i + 1) & idx->mask)
+        if (idx->slot[i] == item) return &idx->slot[i];
+    return 0;
+}
+#else
+#define index_drop(object)      ((void)0)
+#define index_add(object, item) ((void)0)
+#endif
+
+static int key_match(const char *key, const char *string, int case_sensitive)
+{
+    if (case_sensitive) return key && string && !strcmp(key, string);
+    return !cJSON_strcasecmp(key, string);
+}
+
+static cJSON *object_find(cJSON *object, const char *string, int case_sensitive)
+{
+    cJSON *c;
+#if CJSON_OBJECT_INDEX
+    cJSON_Index *idx = object->index;
+    unsigned i, n = 0;
+
+    if (idx && string)
+    {
+        for (i = cJSON_hash(string) & idx->mask; (c = idx->slot[i]) != 0; i = (i + 1) & idx->mask)
+            if (c != &index_tombstone && key_match(c->string, string, case_sensitive)) return c;
+        return 0;
+    }
+    for (c = object->child; c && !key_match(c->string, string, case_sensitive); c = c->next) n++;
+    if (n >= CJSON_INDEX_MIN_ITEMS && !(object->type & cJSON_IsReference)) index_build(object);
+#else
+    for (c = object->child; c && !key_match(c->string, string, case_sensitive); c = c->next);
+#endif
     return c;
 }
 
+cJSON *cJSON_GetObjectItem(cJSON *object, const char *string)
+{
+    return object_find(object, string, 0);
+}
+cJSON *cJSON_GetObjectItemCaseSensitive(cJSON *object, const char *string)
+{
+    return object_find(object, string, 1);
+}
+
 /* Utility for array list handling. */
 static void suffix_object(cJSON *prev, cJSON *item)
 {
@@ -990,6 +1374,9 @@ static cJSON *create_reference(cJSON *item)
     if (!ref) return 0;
     memcpy(ref, item, sizeof(cJSON));
     ref->string = 0;
+#if CJSON_OBJECT_INDEX
+    ref->index = 0;     /* the index belongs to item */
+#endif
     ref->type |= cJSON_IsReference;
     ref->next = ref->prev = 0;
     return ref;
@@ -1009,18 +1396,20 @@ void   cJSON_AddItemToArray(cJSON *array, cJSON *item)
         while (c && c->next) c = c->next;
         suffix_object(c, item);
     }
+    index_add(array, item);
 }
 void   cJSON_AddItemToObject(cJSON *object, const char *string, cJSON *item)
 {
     if (!item) return;
-    if (item->string) cJSON_free(item->string);
-    item->string = cJSON_strdup(string);
+    if (!(item->type & cJSON_StringIsConst) && item->string) cJSON_node_free(item->string);
+    item->string = cJSON_node_strdup(string);
+    item->type &= ~cJSON_StringIsConst;
     cJSON_AddItemToArray(object, item);
 }
 void   cJSON_AddItemToObjectCS(cJSON *object, const char *string, cJSON *item)
 {
     if (!item) return;
-    if (!(item->type & cJSON_StringIsConst) && item->string) cJSON_free(item->string);
+    if (!(item->type & cJSON_StringIsConst) && item->string) cJSON_node_free(item->string);
     item->string = (char*)string;
     item->type |= cJSON_StringIsConst;
     cJSON_AddItemToArray(object, item);
@@ -1034,15 +1423,23 @@ void    cJSON_AddItemReferenceToObject(cJSON *object, const char *string, cJSON
     cJSON_AddItemToObject(object, string, create_reference(item));
 }
 
+static void detach_item(cJSON *parent, cJSON *c)
+{
+#if CJSON_OBJECT_INDEX
+    cJSON **slot = index_slot(parent, c);
+    if (slot) *slot = &index_tombstone;
+#endif
+    if (c->prev) c->prev->next = c->next;
+    if (c->next) c->next->prev = c->prev;
+    if (c == parent->child) parent->child = c->next;
+    c->prev = c->next = 0;
+}
 cJSON *cJSON_DetachItemFromArray(cJSON *array, int which)
 {
     cJSON *c = array->child;
     while (c && which > 0) c = c->next, which--;
     if (!c) return 0;
-    if (c->prev) c->prev->next = c->next;
-    if (c->next) c->next->prev = c->prev;
-    if (c == array->child) array->child = c->next;
-    c->prev = c->next = 0;
+    detach_item(array, c);
     return c;
 }
 void   cJSON_DeleteItemFromArray(cJSON *array, int which)
@@ -1051,11 +1448,9 @@ void   cJSON_DeleteItemFromArray(cJSON *array, int which)
 }
 cJSON *cJSON_DetachItemFromObject(cJSON *object, const char *string)
 {
-    int i = 0;
-    cJSON *c = object->child;
-    while (c && cJSON_strcasecmp(c->string, string)) i++, c = c->next;
-    if (c) return cJSON_DetachItemFromArray(object, i);
-    return 0;
+    cJSON *c = object_find(object, string, 0);
+    if (c) detach_item(object, c);
+    return c;
 }
 void   cJSON_DeleteItemFromObject(cJSON *object, const char *string)
 {
@@ -1077,29 +1472,37 @@ void   cJSON_InsertItemInArray(cJSON *array, int which, cJSON *newitem)
     c->prev = newitem;
     if (c == array->child) array->child = newitem;
     else newitem->prev->next = newitem;
+    index_drop(array);  /* member order changed */
 }
-void   cJSON_ReplaceItemInArray(cJSON *array, int which, cJSON *newitem)
+static void replace_item(cJSON *parent, cJSON *c, cJSON *newitem)
 {
-    cJSON *c = array->child;
-    while (c && which > 0) c = c->next, which--;
-    if (!c) return;
+#if CJSON_OBJECT_INDEX
+    cJSON **slot = index_slot(parent, c);
+    if (slot && newitem->string && !cJSON_strcasecmp(c->string, newitem->string)) *slot = newitem;
+    else if (parent->index) index_drop(parent);
+#endif
     newitem->next = c->next;
     newitem->prev = c->prev;
     if (newitem->next) newitem->next->prev = newitem;
-    if (c == array->child) array->child = newitem;
+    if (c == parent->child) parent->child = newitem;
     else newitem->prev->next = newitem;
     c->next = c->prev = 0;
     cJSON_Delete(c);
 }
+void   cJSON_ReplaceItemInArray(cJSON *array, int which, cJSON *newitem)
+{
+    cJSON *c = array->child;
+    while (c && which > 0) c = c->next, which--;
+    if (!c) return;
+    replace_item(array, c, newitem);
+}
 void   cJSON_ReplaceItemInObject(cJSON *object, const char *string, cJSON *newitem)
 {
-    int i = 0;
-    cJSON *c = object->child;
-    while(c && cJSON_strcasecmp(c->string, string))i++, c = c->next;
+    cJSON *c = object_find(object, string, 0);
     if(c)
     {
-        newitem->string = cJSON_strdup(string);
-        cJSON_ReplaceItemInArray(object, i, newitem);
+        newitem->string = cJSON_node_strdup(string);
+        replace_item(object, c, newitem);
     }
 }
 
@@ -1145,7 +1548,7 @@ cJSON *cJSON_CreateString(const char *string)
     if(item)
     {
         item->type = cJSON_String;
-        item->valuestring = cJSON_strdup(string);
+        item->valuestring = cJSON_node_strdup(string);
     }
     return item;
 }
@@ -1226,10 +1629,10 @@ cJSON *cJSON_Duplicate(cJSON *item, int recurse)
     newitem = cJSON_New_Item();
     if (!newitem) return 0;
     /* Copy over all vars */
-    newitem->type = item->type & (~cJSON_IsReference), newitem->valueint = item->valueint, newitem->valuedouble = item->valuedouble;
+    newitem->type = item->type & (~(cJSON_IsReference | cJSON_StringIsConst | cJSON_ValueIsConst)), newitem->valueint = item->valueint, newitem->valuedouble = item->valuedouble;
     if (item->valuestring)
     {
-        newitem->valuestring = cJSON_strdup(item->valuestring);
+        newitem->valuestring = cJSON_node_strdup(item->valuestring);
         if (!newitem->valuestring)
         {
             cJSON_Delete(newitem);
@@ -1238,7 +1641,7 @@ cJSON *cJSON_Duplicate(cJSON *item, int recurse)
     }
     if (item->string)
     {
-        newitem->string = cJSON_strdup(item->string);
+        newitem->string = cJSON_node_strdup(item->string);
         if (!newitem->string)
         {
             cJSON_Delete(newitem);
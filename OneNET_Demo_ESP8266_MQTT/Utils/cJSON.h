@@ -39,6 +39,17 @@ extern "C"
 	
 #define cJSON_IsReference 256
 #define cJSON_StringIsConst 512
+#define cJSON_ValueIsConst 1024
+
+/* Member hash index for large objects (see cJSON_GetObjectItem). Costs one pointer per node;
+   define CJSON_OBJECT_INDEX 0 to leave it out and keep lookups linear. */
+#ifndef CJSON_OBJECT_INDEX
+#define CJSON_OBJECT_INDEX 1
+#endif
+
+#if CJSON_OBJECT_INDEX
+typedef struct cJSON_Index cJSON_Index;
+#endif
 
 /* The cJSON structure: */
 typedef struct cJSON {
@@ -52,6 +63,10 @@ typedef struct cJSON {
 	double valuedouble;			/* The item's number, if type==cJSON_Number */
 
 	char *string;				/* The item's name string, if this item is the child of, or is in the list of subitems of an object. */
+
+#if CJSON_OBJECT_INDEX
+	cJSON_Index *index;			/* Member hash index of a large object, built and owned by cJSON. Do not rename members of an indexed object in place. */
+#endif
 } cJSON;
 
 typedef struct cJSON_Hooks {
@@ -62,6 +77,14 @@ typedef struct cJSON_Hooks {
 /* Supply malloc, realloc and free functions to cJSON */
 extern void cJSON_InitHooks(cJSON_Hooks* hooks);
 
+/* Arena mode: nodes and key/value strings of parsed or built documents are bump-allocated from buf
+   (8-byte aligned) instead of the heap; printed text still comes from the hooks above.
+   cJSON_Delete of the last live document rewinds the arena. When it is full, allocation falls back
+   to the heap. buf=0 turns arena mode off; only switch when no arena document is alive. */
+extern void cJSON_InitArena(void *buf, size_t size);
+/* High-water mark of the arena in bytes, for sizing buf. */
+extern size_t cJSON_ArenaPeak(void);
+
 
 /* Supply a block of JSON, and this returns a cJSON object you can interrogate. Call cJSON_Delete when finished. */
 extern cJSON *cJSON_Parse(const char *value);
@@ -71,6 +94,9 @@ extern char  *cJSON_Print(cJSON *item);
 extern char  *cJSON_PrintUnformatted(cJSON *item);
 /* Render a cJSON entity to text using a buffered strategy. prebuffer is a guess at the final size. guessing well reduces reallocation. fmt=0 gives unformatted, =1 gives formatted */
 extern char *cJSON_PrintBuffered(cJSON *item,int prebuffer,int fmt);
+/* Render a cJSON entity into buf (size bytes, including the terminating NUL) without allocating. Returns the length of the text, or -1 if it does not fit.
+   With buf=0 nothing is written and the exact length is returned, so the caller can size buf as length+1 first. fmt as for cJSON_PrintBuffered. */
+extern int cJSON_PrintToBuffer(cJSON *item,char *buf,int size,int fmt);
 /* Delete a cJSON entity and all subentities. */
 extern void   cJSON_Delete(cJSON *c);
 
@@ -80,6 +106,8 @@ extern int	  cJSON_GetArraySize(cJSON *array);
 extern cJSON *cJSON_GetArrayItem(cJSON *array,int item);
 /* Get item "string" from object. Case insensitive. */
 extern cJSON *cJSON_GetObjectItem(cJSON *object,const char *string);
+/* Get item "string" from object, matching case exactly (cheaper compare). */
+extern cJSON *cJSON_GetObjectItemCaseSensitive(cJSON *object,const char *string);
 
 /* For analysing failed parses. This returns a pointer to the parse error. You'll probably need to look a few chars back to make sense of it. Defined when cJSON_Parse() returns 0. 0 when cJSON_Parse() succeeds. */
 extern const char *cJSON_GetErrorPtr(void);
@@ -128,6 +156,11 @@ The item->next and ->prev pointers are always zero on return from Duplicate. */
 /* ParseWithOpts allows you to require (and check) that the JSON is null terminated, and to retrieve the pointer to the final byte parsed. */
 extern cJSON *cJSON_ParseWithOpts(const char *value,const char **return_parse_end,int require_null_terminated);
 
+/* Parse len bytes of buf in place, without copying: strings are unescaped inside buf and the returned
+   tree points into it, so buf must outlive the tree. buf need not be NUL-terminated but buf[len] must be
+   writable; it is used as a sentinel during the parse and restored. Only whitespace may follow the value. */
+extern cJSON *cJSON_ParseInSitu(char *buf, size_t len);
+
 extern void cJSON_Minify(char *json);
 
 /* Macros for creating things quickly. */
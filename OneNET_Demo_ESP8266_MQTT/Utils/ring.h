@@ -0,0 +1,56 @@
+#ifndef __RING_HEADER__
+#define __RING_HEADER__
+#include <stdint.h>
+
+/*
+ * 单生产者/单消费者环形缓冲区, 用于中断(生产者)和主循环(消费者)之间传递字节流.
+ * head只由生产者修改, tail只由消费者修改, 双方不需要关中断.
+ * head/tail是自由增长的计数, 取下标时与(size-1)相与, 所以size必须是2的幂.
+ */
+typedef struct
+{
+    uint8_t *buf;
+    uint32_t size;                  /*2的幂*/
+    volatile uint32_t head;         /*已写入的字节总数*/
+    volatile uint32_t tail;         /*已取走的字节总数*/
+    volatile uint32_t overflow;     /*满时被丢掉的字节数, 生产者计数*/
+} Ring;
+
+/*
+ *  @brief 初始化, size必须是2的幂
+ */
+void Ring_Init(Ring *r, uint8_t *buf, uint32_t size);
+
+/*两边都可调用*/
+uint32_t Ring_Count(const Ring *r);
+uint32_t Ring_Free(const Ring *r);
+
+/*
+ *  生产者: 写入数据, 放不下的部分丢掉并计入overflow, 返回写入的字节数
+ */
+uint32_t Ring_Put(Ring *r, const uint8_t *data, uint32_t len);
+uint32_t Ring_PutByte(Ring *r, uint8_t data);
+/*
+ *  生产者: 取得可直接写入的连续空间, 写完后用Ring_Commit提交, 适合DMA
+ */
+uint32_t Ring_WriteSpan(const Ring *r, uint8_t **p);
+void Ring_Commit(Ring *r, uint32_t len);
+
+/*
+ *  消费者: 从第offset个未读字节开始拷贝最多len字节, 不取走
+ */
+uint32_t Ring_Peek(const Ring *r, uint32_t offset, uint8_t *dst, uint32_t len);
+/*
+ *  消费者: 取得可直接读取的连续数据, 用完后用Ring_Consume取走
+ */
+uint32_t Ring_ReadSpan(const Ring *r, const uint8_t **p);
+void Ring_Consume(Ring *r, uint32_t len);
+/*
+ *  消费者: 拷贝并取走最多len字节
+ */
+uint32_t Ring_Get(Ring *r, uint8_t *dst, uint32_t len);
+/*
+ *  消费者: 丢掉全部未读数据
+ */
+void Ring_Flush(Ring *r);
+#endif
@@ -1,3 +1,4 @@
+#include "stm32f10x.h"
 #include "utils.h"
 
 /*
@@ -105,9 +106,51 @@ uint16_t   usMBCRC16( uint8_t * pucFrame, uint16_t  usLen )
 }
 
 
+static volatile uint32_t systick_ms = 0;
+
+/*
+ *  @brief SysTick毫秒计时, 1ms中断一次
+ */
+void SystickTime_Init(void)
+{
+    SysTick_Config(SystemCoreClock / 1000);
+}
+
+/*
+ *  @brief SysTick_Handler中调用
+ */
+void SystickTime_Increase(void)
+{
+    systick_ms++;
+}
+
+/*
+ *  @brief 上电以来的毫秒数
+ */
+uint32_t SystickTime_Get(void)
+{
+    return systick_ms;
+}
+
+/*
+ *  @brief 毫秒延时. SysTick已启动并且在主循环中(非中断、未关中断)调用时按SysTick计时,
+ *         等待期间WFI睡眠; SystickTime_Init之前或在中断里调用时退回空循环
+ */
 void mDelay(uint32_t i)
 {
+    uint32_t start = systick_ms;
     uint32_t j = 0;
+
+    if((SysTick->CTRL & SysTick_CTRL_ENABLE_Msk) && __get_PRIMASK() == 0 &&
+       (SCB->ICSR & SCB_ICSR_VECTACTIVE_Msk) == 0)
+    {
+        /*start可能正好在一个节拍的末尾, 多等一个节拍保证至少i毫秒*/
+        while(i > 0 && systick_ms - start <= i)
+        {
+            __WFI();
+        }
+        return;
+    }
     for(; i > 0; i--)
     {
         for(j = 0; j < 2000; j++);
@@ -8,8 +8,9 @@
 #include "stdlib.h"
 #include "string.h"
 
-uint8_t  usart2_rcv_buf[MAX_RCV_LEN];
-volatile uint32_t   usart2_rcv_len = 0;
+Ring usart2_rcv_ring;
+static uint8_t usart2_rcv_mem[USART2_RCV_RING_LEN];
+static uint8_t usart2_rcv_buf[MAX_RCV_LEN];     /*USART2_RcvFind用的字符串副本*/
 
 /*
  *  @brief USART2初始化函数
@@ -20,6 +21,8 @@ void USART2_Init(void)
     USART_InitTypeDef USART_InitStructure;
     NVIC_InitTypeDef NVIC_InitStructure;
 
+    Ring_Init(&usart2_rcv_ring, usart2_rcv_mem, USART2_RCV_RING_LEN);
+
     /* config USART2 clock */
     RCC_APB2PeriphClockCmd(RCC_APB2Periph_GPIOA , ENABLE);
     RCC_APB1PeriphClockCmd(RCC_APB1Periph_USART2, ENABLE);
@@ -72,21 +75,23 @@ void USART2_Write(USART_TypeDef* USARTx, uint8_t *Data, uint32_t len)
  */
 void SendCmd(int8_t* cmd, int8_t* result, int32_t timeOut)
 {
+    char *found;
+
     while(1)
     {
-        memset(usart2_rcv_buf, 0, strlen(usart2_rcv_buf));
-        usart2_rcv_len = 0;
+        USART2_RcvClear();
 
         USART2_Write(USART2, cmd, strlen(cmd));
         mDelay(timeOut);
+        found = USART2_RcvFind(result);
         printf("%s %d cmd:%s,rsp:%s\n", __func__, __LINE__, cmd, usart2_rcv_buf);
 			
-        if((NULL != strstr(usart2_rcv_buf, "ERROR")))
+        if((NULL != strstr((char *)usart2_rcv_buf, "ERROR")))
         {
             continue;
         }
 				
-        if((NULL != strstr(usart2_rcv_buf, result)))
+        if((NULL != found))
         {
             break;
         }
@@ -102,18 +107,45 @@ void SendCmd(int8_t* cmd, int8_t* result, int32_t timeOut)
  */
 uint32_t USART2_GetRcvNum(void)
 {
-    return usart2_rcv_len;
+    return Ring_Count(&usart2_rcv_ring);
 }
 /*
- *  @brief 返回USART2已接收的数据到buf，长度为rcv_len
+ *  @brief 取走USART2已接收的rcv_len字节到buf, buf为NULL时直接丢掉
+ *         只取走这么多, 拷贝期间新到的数据留给下次, 不会丢
  */
 void  USART2_GetRcvData(uint8_t *buf, uint32_t rcv_len)
 {
+    uint32_t n = Ring_Count(&usart2_rcv_ring);
+
+    if(rcv_len > n)
+    {
+        rcv_len = n;
+    }
     if(buf)
     {
-        memcpy(buf, usart2_rcv_buf, rcv_len);
+        Ring_Get(&usart2_rcv_ring, buf, rcv_len);
+    }
+    else
+    {
+        Ring_Consume(&usart2_rcv_ring, rcv_len);
     }
-    memset(usart2_rcv_buf, 0, strlen(usart2_rcv_buf));
-    usart2_rcv_len = 0;
+}
+/*
+ *  @brief 丢掉已接收的全部数据, 发AT命令前调用
+ */
+void USART2_RcvClear(void)
+{
+    Ring_Flush(&usart2_rcv_ring);
+}
+/*
+ *  @brief 在已接收的数据(最多前MAX_RCV_LEN-1字节)中查找字符串, 不取走数据
+ *  @retval 找到时返回副本usart2_rcv_buf中的位置, 否则NULL
+ */
+char *USART2_RcvFind(const char *str)
+{
+    uint32_t n = Ring_Peek(&usart2_rcv_ring, 0, usart2_rcv_buf, MAX_RCV_LEN - 1);
+
+    usart2_rcv_buf[n] = 0;
+    return strstr((char *)usart2_rcv_buf, str);
 }
 #endif
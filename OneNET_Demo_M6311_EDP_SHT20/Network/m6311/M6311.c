@@ -47,8 +47,7 @@ void M6311_Init(void)
 int32_t M6311_SendData(uint8_t * buf,uint32_t len)
 {
 	int32_t ret=0,i=0;
-	memset(usart2_rcv_buf,0,strlen(usart2_rcv_buf));
-	usart2_rcv_len=0;
+	USART2_RcvClear();
 	USART2_Write(USART2,buf,len);	
 	mDelay(20);	
 }
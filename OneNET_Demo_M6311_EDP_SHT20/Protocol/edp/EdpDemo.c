@@ -126,8 +126,7 @@ void EDP_Loop(void)
     mDelay(2000);
     while(1)
     {   
-			  memset(usart2_rcv_buf, 0, strlen(usart2_rcv_buf));
-        usart2_rcv_len = 0;
+        USART2_RcvClear();
         Connect_RequestType1(src_dev, src_api_key);
         mDelay(200);
         Recv_Thread_Func();
@@ -209,6 +208,10 @@ void Recv_Thread_Func(void)
 				}
 				mDelay(50);
 				rcv_len = USART2_GetRcvNum();
+        if (rcv_len > sizeof(buffer))
+        {
+            rcv_len = sizeof(buffer);   /*其余的留到下一轮*/
+        }
         USART2_GetRcvData(buffer, rcv_len);
         printf("recv from server, bytes: %d\r\n", rcv_len);
         /* wululu test print send bytes */
@@ -116,6 +116,17 @@ typedef struct Buffer
  *          返回值为空 生成Buffer失败, 内存不够
  */
 EDPKIT_DLL Buffer* NewBuffer(void);
+/*
+ * 函数名:  NewBufferSize
+ * 功能:    生成初始容量为size字节的Buffer
+ * 说明:    打包函数在已知包总长时用它一次申请到位, 避免从BUFFER_SIZE开始
+ *          成倍扩容和拷贝; 同样需要用DeleteBuffer销毁
+ * 参数:    size    Buffer的初始容量
+ * 返回值:  类型 (Buffer*)
+ *          返回值非空 生成Buffer成功, 返回这个Buffer的指针
+ *          返回值为空 生成Buffer失败, 内存不够
+ */
+EDPKIT_DLL Buffer* NewBufferSize(uint32_t size);
 /*
  * 函数名:  DeleteBuffer
  * 功能:    销毁Buffer
@@ -57,6 +57,8 @@ uint8_t con[]={
 int main(void)
 {
 	#if 1
+    /*1ms节拍, mDelay按它计时*/
+    SystickTime_Init();
     /*GPIO初始化*/
     GpioInit();
     /*MT6331上电*/
@@ -25,6 +25,7 @@
 #include "stm32f10x_it.h"
 #include "usart1.h"
 #include "usart2.h"
+#include "utils.h"
 
 extern uint32_t SystickTime;
 extern __IO uint32_t TimeDisplay;
@@ -139,8 +140,7 @@ void PendSV_Handler(void)
   */
 void SysTick_Handler(void)
 {
-    //SystickTime_Increase();
-    //SystickTime++;
+    SystickTime_Increase();
 }
 
 /******************************************************************************/
@@ -201,7 +201,7 @@ void USART2_IRQHandler(void)
 		if(USART2->SR & USART_FLAG_RXNE)   //Receive Data Reg Full Flag
     {		//GPIO_SetBits(GPIOC,GPIO_Pin_0|GPIO_Pin_1|GPIO_Pin_2|GPIO_Pin_3);
         data = USART2->DR;
-				usart2_rcv_buf[usart2_rcv_len++]=data;
+				Ring_PutByte(&usart2_rcv_ring, data);	//ʱ, overflow
     }
 		else
 		{
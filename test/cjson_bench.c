@@ -0,0 +1,95 @@
+/*
+ * cJSON数字输出的主机基准测试
+ * 打印一个全是传感器读数的文档, 与原版print_number的格式化方式(浮点比较+sprintf)对比
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <limits.h>
+#include <time.h>
+#include "cJSON.h"
+
+#define NUMS    200
+#define ROUNDS  2000
+
+static double now_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/* 原版print_number的格式化部分 */
+static int legacy_format(char *str, double d)
+{
+    int valueint = (int)d;
+
+    if (d == 0)
+        return sprintf(str, "0");
+    if (fabs(((double)valueint) - d) <= DBL_EPSILON && d <= INT_MAX && d >= INT_MIN)
+        return sprintf(str, "%d", valueint);
+    if (fabs(floor(d) - d) <= DBL_EPSILON && fabs(d) < 1.0e60)
+        return sprintf(str, "%.0f", d);
+    if (fabs(d) < 1.0e-6 || fabs(d) > 1.0e9)
+        return sprintf(str, "%e", d);
+    return sprintf(str, "%f", d);
+}
+
+int main(void)
+{
+    double vals[NUMS];
+    char buf[64];
+    cJSON *doc;
+    char *out;
+    double t0, t_new, t_old;
+    size_t sink = 0;
+    int i, r;
+
+    srand(1);
+    doc = cJSON_CreateArray();
+    for (i = 0; i < NUMS; i++)
+    {
+        /* 温湿度、光照这类带两位小数的读数, 夹杂一些整数 */
+        vals[i] = (i % 4 == 0) ? (double)(rand() % 1000) : (rand() % 100000) / 100.0;
+        cJSON_AddItemToArray(doc, cJSON_CreateNumber(vals[i]));
+    }
+
+    t0 = now_us();
+    for (r = 0; r < ROUNDS; r++)
+    {
+        out = cJSON_PrintUnformatted(doc);
+        sink += strlen(out);
+        free(out);
+    }
+    t_new = now_us() - t0;
+
+    /* 原版: 每个数字格式化一次, 再拼成同样的数组文本 */
+    t0 = now_us();
+    for (r = 0; r < ROUNDS; r++)
+    {
+        char *p, *doc_text = (char *)malloc(NUMS * 64 + 2);
+
+        p = doc_text;
+        *p++ = '[';
+        for (i = 0; i < NUMS; i++)
+        {
+            legacy_format(buf, vals[i]);
+            p += sprintf(p, i ? ",%s" : "%s", buf);
+        }
+        *p++ = ']';
+        *p = 0;
+        sink += p - doc_text;
+        free(doc_text);
+    }
+    t_old = now_us() - t0;
+
+    printf("cjson_bench: %d numbers x %d rounds\n", NUMS, ROUNDS);
+    printf("  cJSON_PrintUnformatted : %8.1f us/doc\n", t_new / ROUNDS);
+    printf("  legacy print_number    : %8.1f us/doc\n", t_old / ROUNDS);
+    printf("  speedup                : %8.2fx  (%zu)\n", t_old / t_new, sink % 10);
+    cJSON_Delete(doc);
+    return 0;
+}
@@ -0,0 +1,550 @@
+/*
+ * cJSON主机测试: 原地解析的边界检查, 数字输出的往返和最短形式
+ * 所有demo的Utils/cJSON.c是同一份, 这里编译EDP_Sensors中的那份
+ * 带成员索引和CJSON_OBJECT_INDEX=0各编译一次, 查找结果必须相同
+ * cJSON_PrintToBuffer: 量出的长度和cJSON_Print相同, 缓存短一个字节就失败且不越界
+ * cJSON_Sax: 路径匹配在任意切分下结果相同, 不要的长字符串不受CJSON_SAX_TOKEN_MAX限制
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "cJSON.h"
+#include "cJSON_Sax.h"
+
+static int failed = 0;
+
+#define CHECK(cond) do { if (!(cond)) { fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #cond); failed++; } } while (0)
+
+/*
+ *  @brief 像GetEdpPacket那样只多申请1字节作为哨兵, 把text原地解析
+ *  @retval 解析结果, 失败为NULL
+ */
+static cJSON *parse_insitu(const char *text, char **keep)
+{
+    size_t len = strlen(text);
+    char *buf = (char *)malloc(len + 1);
+
+    memcpy(buf, text, len);
+    buf[len] = 'X';             /* 哨兵位置原本是包里的其他数据 */
+    *keep = buf;
+    return cJSON_ParseInSitu(buf, len);
+}
+
+/* 截断的转义必须解析失败, 并且不能越过哨兵读写 */
+static void test_truncated_escape(void)
+{
+    static const char *bad[] =
+    {
+        "{\"a\":\"ab\\",
+        "{\"a\":\"ab\\u",
+        "{\"a\":\"ab\\u12",
+        "{\"a\":\"ab\\ud83d\\",
+        "{\"a\":\"ab\\ud83d\\u",
+        "{\"a\":\"ab\\ud83d\\ude0",
+        "{\"a\":\"ab",
+        "\"\\",
+    };
+    unsigned i;
+    char *buf;
+    cJSON *json;
+
+    for (i = 0; i < sizeof(bad) / sizeof(bad[0]); i++)
+    {
+        json = parse_insitu(bad[i], &buf);
+        CHECK(json == NULL);
+        CHECK(buf[strlen(bad[i])] == 'X');     /* 哨兵已恢复 */
+        cJSON_Delete(json);
+        free(buf);
+        /* 非原地解析走同样的路径 */
+        json = cJSON_Parse(bad[i]);
+        CHECK(json == NULL);
+        cJSON_Delete(json);
+    }
+}
+
+/* 完整的转义照常解码 */
+static void test_escapes(void)
+{
+    static const char text[] = "{\"a\":\"x\\n\\u00e9\\ud83d\\ude00\\\"\"}";
+    static const char want[] = "x\n\xc3\xa9\xf0\x9f\x98\x80\"";
+    char *buf;
+    cJSON *json, *a;
+
+    json = parse_insitu(text, &buf);
+    CHECK(json != NULL);
+    a = cJSON_GetObjectItem(json, "a");
+    CHECK(a != NULL && a->valuestring && strcmp(a->valuestring, want) == 0);
+    cJSON_Delete(json);
+    free(buf);
+
+    json = cJSON_Parse(text);
+    a = cJSON_GetObjectItem(json, "a");
+    CHECK(a != NULL && a->valuestring && strcmp(a->valuestring, want) == 0);
+    cJSON_Delete(json);
+}
+
+/*
+ *  @brief 打印一个数字, 返回malloc的文本
+ */
+static char *print_double(double d)
+{
+    cJSON *num = cJSON_CreateNumber(d);
+    char *out = cJSON_PrintUnformatted(num);
+
+    cJSON_Delete(num);
+    return out;
+}
+
+/* 典型值输出最短的文本 */
+static void test_number_text(void)
+{
+    static const struct { double d; const char *text; } cases[] =
+    {
+        { 0, "0" },
+        { -3, "-3" },
+        { 4294967296.0, "4294967296" },
+        { 9007199254740993.0, "9007199254740992" },
+        { 23.45, "23.45" },
+        { -0.5, "-0.5" },
+        { 0.1, "0.1" },
+        { 0.7999999999999999, "0.7999999999999999" },
+        { 0.30000000000000004, "0.30000000000000004" },
+        { 1e300, "1e+300" },
+        { 1.5e-7, "0.00000015" },
+        { 1e-20, "1e-20" },
+    };
+    unsigned i;
+    char *out;
+
+    for (i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+    {
+        out = print_double(cases[i].d);
+        if (out == NULL || strcmp(out, cases[i].text) != 0)
+        {
+            fprintf(stderr, "print %.17g: got %s, want %s\n", cases[i].d, out ? out : "NULL", cases[i].text);
+            failed++;
+        }
+        free(out);
+    }
+}
+
+/* 随机double打印后再解析, 必须逐位相同 */
+static void test_number_roundtrip(void)
+{
+    uint64_t x = 88172645463325252ULL, bits, back_bits;
+    double d, back;
+    cJSON *json;
+    char *out;
+    int i, bad = 0;
+
+    for (i = 0; i < 200000; i++)
+    {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        if (i & 1)
+        {
+            bits = x;
+            memcpy(&d, &bits, sizeof(d));
+            if (d != d || d - d != 0) continue;     /* NaN/Inf不是合法JSON */
+        }
+        else
+        {
+            d = (double)(int32_t)x / 100;           /* 传感器读数 */
+        }
+        out = print_double(d);
+        json = cJSON_Parse(out);
+        back = json ? json->valuedouble : 0;
+        memcpy(&bits, &d, sizeof(d));
+        memcpy(&back_bits, &back, sizeof(back));
+        if (json == NULL || (bits != back_bits && !(d == 0 && back == 0)))
+        {
+            if (bad++ < 5) fprintf(stderr, "roundtrip %.17g -> %s\n", d, out);
+        }
+        cJSON_Delete(json);
+        free(out);
+    }
+    CHECK(bad == 0);
+}
+
+/* 计数的内存钩子, heap_fail时模拟堆耗尽 */
+static int heap_allocs, heap_frees, heap_fail;
+
+static void *count_malloc(size_t sz)
+{
+    if (heap_fail)
+        return NULL;
+    heap_allocs++;
+    return malloc(sz);
+}
+
+static void count_free(void *ptr)
+{
+    heap_frees++;
+    free(ptr);
+}
+
+static void hooks_on(void)
+{
+    cJSON_Hooks hooks = { count_malloc, count_free };
+
+    heap_allocs = heap_frees = heap_fail = 0;
+    cJSON_InitHooks(&hooks);
+}
+
+static const char arena_doc[] = "{\"datastreams\":[{\"id\":\"temperature\",\"datapoints\":[{\"value\":23.5}]},"
+                                "{\"id\":\"humidity\",\"datapoints\":[{\"value\":61}]}]}";
+
+/* 文档全在arena里: 不碰堆, Delete不调用free, 最后一个文档删掉后从头重用 */
+static void test_arena_reuse(void)
+{
+    static double arena[4096 / sizeof(double)];
+    cJSON *a, *b, *c;
+
+    hooks_on();
+    cJSON_InitArena(arena, sizeof(arena));
+
+    a = cJSON_Parse(arena_doc);
+    CHECK(a != NULL && (void *)a == (void *)arena);
+    CHECK(cJSON_ArenaPeak() > 0);
+    b = cJSON_Parse(arena_doc);
+    CHECK(b != NULL && (char *)b > (char *)arena);
+    CHECK(heap_allocs == 0);
+
+    /* 还有文档存活时不回绕 */
+    cJSON_Delete(a);
+    c = cJSON_Parse("[1]");
+    CHECK(c != NULL && (char *)c > (char *)b);
+    cJSON_Delete(c);
+    cJSON_Delete(b);
+    CHECK(heap_frees == 0);
+
+    /* 全部删掉后回到开头, 解析结果不受上次内容影响 */
+    a = cJSON_Parse(arena_doc);
+    CHECK(a != NULL && (void *)a == (void *)arena);
+    CHECK(cJSON_GetArraySize(cJSON_GetObjectItem(a, "datastreams")) == 2);
+    cJSON_Delete(a);
+    CHECK(heap_allocs == 0 && heap_frees == 0);
+
+    cJSON_InitArena(0, 0);
+    cJSON_InitHooks(NULL);
+}
+
+/* arena用完退回到堆; 堆也没有时解析干净地失败, arena随后可继续用 */
+static void test_arena_exhausted(void)
+{
+    static double arena[256 / sizeof(double)];
+    cJSON *json;
+
+    hooks_on();
+    cJSON_InitArena(arena, sizeof(arena));
+
+    json = cJSON_Parse(arena_doc);
+    CHECK(json != NULL && (void *)json == (void *)arena);
+    CHECK(heap_allocs > 0);
+    CHECK(cJSON_ArenaPeak() <= sizeof(arena));
+    cJSON_Delete(json);
+    CHECK(heap_frees == heap_allocs);       /* 堆上的节点照常释放 */
+
+    heap_fail = 1;
+    json = cJSON_Parse(arena_doc);
+    CHECK(json == NULL);
+    heap_fail = 0;
+
+    /* 失败时已分配的arena节点都还回来了, 下一个文档从头开始 */
+    json = cJSON_Parse("{\"a\":1}");
+    CHECK(json != NULL && (void *)json == (void *)arena);
+    cJSON_Delete(json);
+    CHECK(heap_frees == heap_allocs);
+
+    cJSON_InitArena(0, 0);
+    cJSON_InitHooks(NULL);
+}
+
+/* 按成员顺序逐个比较, 作为查找的参照 */
+static cJSON *linear_find(cJSON *object, const char *key, int case_sensitive)
+{
+    cJSON *c;
+
+    for (c = object->child; c; c = c->next)
+        if (case_sensitive ? !strcmp(c->string, key) : !strcasecmp(c->string, key))
+            return c;
+    return NULL;
+}
+
+/* 查找所有 "k0".."k<n-1>" 及其大写形式和一个不存在的键, 结果和逐个比较的一致 */
+static void check_lookups(cJSON *object, int n)
+{
+    char key[16];
+    int i;
+
+    for (i = 0; i < n; i++)
+    {
+        sprintf(key, "k%d", i);
+        CHECK(cJSON_GetObjectItem(object, key) == linear_find(object, key, 0));
+        CHECK(cJSON_GetObjectItemCaseSensitive(object, key) == linear_find(object, key, 1));
+        key[0] = 'K';
+        CHECK(cJSON_GetObjectItem(object, key) == linear_find(object, key, 0));
+        CHECK(cJSON_GetObjectItemCaseSensitive(object, key) == NULL);
+    }
+    CHECK(cJSON_GetObjectItem(object, "missing") == NULL);
+    CHECK(cJSON_GetObjectItemCaseSensitive(object, "missing") == NULL);
+}
+
+/* 大对象的查找, 中途增删成员; 有索引时第一次查找后建好索引并随增删更新 */
+static void test_object_lookup(void)
+{
+    cJSON *object = cJSON_CreateObject();
+    char key[16];
+    int i;
+
+    for (i = 0; i < 20; i++)
+    {
+        sprintf(key, "k%d", i);
+        cJSON_AddNumberToObject(object, key, i);
+    }
+    check_lookups(object, 20);
+#if CJSON_OBJECT_INDEX
+    CHECK(object->index != NULL);
+#endif
+    CHECK(cJSON_GetObjectItem(object, "k19")->valueint == 19);
+
+    /* 同名成员: 仍然返回排在前面的那个 */
+    cJSON_AddNumberToObject(object, "k5", 100);
+    CHECK(cJSON_GetObjectItem(object, "K5")->valueint == 5);
+
+    /* 加到索引需要重建之后 */
+    for (i = 20; i < 60; i++)
+    {
+        sprintf(key, "k%d", i);
+        cJSON_AddNumberToObject(object, key, i);
+    }
+    check_lookups(object, 60);
+    CHECK(cJSON_GetObjectItem(object, "k59")->valueint == 59);
+
+    cJSON_DeleteItemFromObject(object, "k3");
+    cJSON_DeleteItemFromObject(object, "K5");
+    cJSON_DeleteItemFromObject(object, "k59");
+    check_lookups(object, 60);
+    CHECK(cJSON_GetObjectItem(object, "k3") == NULL);
+    CHECK(cJSON_GetObjectItem(object, "k5")->valueint == 100);     /* 后面的同名成员露出来 */
+    CHECK(cJSON_GetObjectItem(object, "k59") == NULL);
+    CHECK(cJSON_GetArraySize(object) == 58);
+
+    /* 删掉后再加回同名成员 */
+    cJSON_AddNumberToObject(object, "k3", 300);
+    check_lookups(object, 60);
+    CHECK(cJSON_GetObjectItem(object, "k3")->valueint == 300);
+
+    cJSON_Delete(object);
+}
+
+static const char *const print_docs[] =
+{
+    arena_doc,
+    "{\"s\":\"quote\\\" back\\\\ tab\\t nl\\n ctl\\u0001 \\u00e9\",\"n\":[0,-1,1.5,1e+30,-2.5e-7,123456789],"
+    "\"t\":true,\"f\":false,\"z\":null,\"e\":\"\"}",
+    "{\"empty\":{},\"arr\":[],\"deep\":{\"a\":{\"b\":{},\"c\":[{},[],[{}]]}},\"\":0}",
+    "[[1,[2,[3]]],{\"k\":{\"k\":{}}}]",
+    "{}",
+    "[]",
+    "\"only a string\"",
+    "-0.125",
+};
+
+/* 每个文档分别测格式化和不格式化的输出 */
+static void test_print_to_buffer(void)
+{
+    unsigned i;
+    int fmt, len, size, over;
+    cJSON *json;
+    char *text, *buf;
+
+    for (i = 0; i < sizeof(print_docs) / sizeof(print_docs[0]); i++)
+    {
+        json = cJSON_Parse(print_docs[i]);
+        CHECK(json != NULL);
+        if (!json)
+            continue;
+        for (fmt = 0; fmt <= 1; fmt++)
+        {
+            text = fmt ? cJSON_Print(json) : cJSON_PrintUnformatted(json);
+            len = cJSON_PrintToBuffer(json, NULL, 0, fmt);
+            CHECK(len == (int)strlen(text));
+
+            /* 刚好放得下 */
+            buf = (char *)malloc(len + 1);
+            CHECK(cJSON_PrintToBuffer(json, buf, len + 1, fmt) == len && !strcmp(buf, text));
+            free(buf);
+
+            /* 每一种放不下的大小都失败, 堆上刚好大小的缓存让越界写由ASan发现 */
+            over = 0;
+            for (size = 1; size <= len; size++)
+            {
+                buf = (char *)malloc(size);
+                if (cJSON_PrintToBuffer(json, buf, size, fmt) != -1)
+                    over++;
+                free(buf);
+            }
+            CHECK(over == 0);
+            free(text);
+        }
+        cJSON_Delete(json);
+    }
+}
+
+/* SAX扫描记录: 每个匹配pattern的值按 "路径序号=文本;" 追加到out */
+typedef struct
+{
+    const char *const *patterns;
+    int wanted_only;            /* 过滤器只要匹配pattern的文本 */
+    char out[512];
+} SaxLog;
+
+static const char *const sax_patterns[] =
+{
+    "datastreams[1].datapoints[0].value",
+    "datastreams[0].datapoints[*].at",
+    "*[*].id",
+    "*[1].a_very_long_key_that_is[2]",     /* 键按CJSON_SAX_KEY_MAX截断后匹配 */
+    "",
+    NULL
+};
+
+static const char sax_doc[] =
+    "{\"note\":\"this description is far longer than CJSON_SAX_TOKEN_MAX and nobody asked for it, "
+    "so it must be skipped without being buffered......................................\","
+    " \"datastreams\":[{\"id\":\"temperature\",\"datapoints\":[{\"at\":\"2016-10-18 08:49:37\",\"value\":23.5},"
+    "{\"at\":\"2016-10-18 08:50:37\",\"value\":-1.25e1}]},"
+    "{\"id\":\"humidity\",\"a_very_long_key_that_is_not_wanted_and_gets_truncated_for_paths\":[1,2,3],"
+    "\"datapoints\":[{\"value\":61}]}],"
+    "\"flag\":true,\"none\":null}";
+
+static const char sax_expect[] =
+    "2=temperature;1=2016-10-18 08:49:37;1=2016-10-18 08:50:37;"
+    "2=humidity;3=3;0=61;";
+
+static int sax_match(const cJSON_SaxParser *p, const SaxLog *log)
+{
+    int i;
+
+    for (i = 0; log->patterns[i]; i++)
+        if (cJSON_SaxPathMatch(p, log->patterns[i]))
+            return i;
+    return -1;
+}
+
+static int sax_filter(const cJSON_SaxParser *p, int event, void *arg)
+{
+    SaxLog *log = (SaxLog *)arg;
+
+    return event != cJSON_SaxKey && sax_match(p, log) >= 0;
+}
+
+static int sax_handler(cJSON_SaxParser *p, int event, const char *text, size_t len, void *arg)
+{
+    SaxLog *log = (SaxLog *)arg;
+    size_t used = strlen(log->out);
+    int i;
+
+    if (event != cJSON_SaxString && event != cJSON_SaxNumber)
+        return 0;
+    i = sax_match(p, log);
+    if (log->wanted_only)
+        CHECK((i >= 0) == (text != NULL));
+    if (i >= 0 && text)
+    {
+        CHECK(strlen(text) == len);
+        snprintf(log->out + used, sizeof(log->out) - used, "%d=%s;", i, text);
+    }
+    return 0;
+}
+
+/* 按切分点喂入, 每段都复制到刚好大小的堆缓存里 */
+static int sax_parse(SaxLog *log, const char *text, size_t cut1, size_t cut2)
+{
+    static cJSON_SaxParser p;
+    size_t cuts[3] = { cut1, cut2, strlen(text) }, from = 0;
+    char *piece;
+    int i, rc = CJSON_SAX_MORE;
+
+    log->out[0] = 0;
+    cJSON_SaxInit(&p, sax_handler, log);
+    if (log->wanted_only)
+        cJSON_SaxSetFilter(&p, sax_filter);
+    for (i = 0; i < 3; i++)
+    {
+        piece = (char *)malloc(cuts[i] - from + 1);
+        memcpy(piece, text + from, cuts[i] - from);
+        rc = cJSON_SaxFeed(&p, piece, cuts[i] - from);
+        free(piece);
+        from = cuts[i];
+    }
+    return rc;
+}
+
+static void test_sax_path_match(void)
+{
+    SaxLog log = { sax_patterns, 1, "" };
+    size_t len = strlen(sax_doc), a, b;
+    int bad = 0;
+
+    CHECK(sax_parse(&log, sax_doc, len, len) == CJSON_SAX_DONE);
+    CHECK(!strcmp(log.out, sax_expect));
+
+    /* 两个切分点走遍所有位置(步长错开), 每个字节单独成段的情况也覆盖到 */
+    for (a = 0; a <= len; a++)
+    {
+        for (b = a; b <= len; b += 1 + a % 7)
+        {
+            if (sax_parse(&log, sax_doc, a, b) != CJSON_SAX_DONE || strcmp(log.out, sax_expect))
+                bad++;
+        }
+    }
+    CHECK(bad == 0);
+
+    /* 没有过滤器时所有文本都要缓存, 长字符串超出上限 */
+    log.wanted_only = 0;
+    CHECK(sax_parse(&log, sax_doc, len, len) == CJSON_SAX_ERR_TOKEN);
+}
+
+/* 要取的文本仍以CJSON_SAX_TOKEN_MAX为限 */
+static void sax_long_id(char *doc, size_t n)
+{
+    size_t len;
+
+    strcpy(doc, "{\"id\":\"");
+    len = strlen(doc);
+    memset(doc + len, 'x', n);
+    strcpy(doc + len + n, "\"}");
+}
+
+static void test_sax_wanted_too_long(void)
+{
+    static const char *const patterns[] = { "id", NULL };
+    SaxLog log = { patterns, 1, "" };
+    char doc[CJSON_SAX_TOKEN_MAX + 16];
+
+    sax_long_id(doc, CJSON_SAX_TOKEN_MAX);
+    CHECK(sax_parse(&log, doc, 0, 0) == CJSON_SAX_ERR_TOKEN);
+    sax_long_id(doc, CJSON_SAX_TOKEN_MAX - 1);
+    CHECK(sax_parse(&log, doc, 0, 0) == CJSON_SAX_DONE);
+    CHECK(strlen(log.out) == 2 + CJSON_SAX_TOKEN_MAX - 1 + 1);
+}
+
+int main(void)
+{
+    test_truncated_escape();
+    test_escapes();
+    test_number_text();
+    test_number_roundtrip();
+    test_arena_reuse();
+    test_arena_exhausted();
+    test_object_lookup();
+    test_print_to_buffer();
+    test_sax_path_match();
+    test_sax_wanted_too_long();
+    fprintf(stderr, "cjson_test%s: %s\n", CJSON_OBJECT_INDEX ? "" : " (no index)", failed ? "FAILED" : "ok");
+    return failed != 0;
+}
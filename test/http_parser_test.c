@@ -0,0 +1,216 @@
+/*
+ * HTTP_Parser主机测试: 录下来的响应在每个字节位置切成两段喂入, 再逐字节喂入,
+ * 结果必须和一次喂完相同
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "HTTP_Parser.h"
+
+static int failed = 0;
+
+#define MAX_RESP    4
+
+/* 一次解析的结果, 流水线上的多个响应依次记录 */
+typedef struct
+{
+    int num;
+    int error;                  /* 以HTTP_PARSE_ERROR结束 */
+    uint16_t status[MAX_RESP];
+    int32_t err_no[MAX_RESP];
+    uint8_t has_errno[MAX_RESP];
+    uint32_t date[MAX_RESP];
+    int success[MAX_RESP];
+} Result;
+
+typedef struct
+{
+    const char *name;
+    const char *text;
+    Result expect;
+} Case;
+
+static const Case cases[] =
+{
+    {
+        "content-length",
+        "HTTP/1.1 200 OK\r\n"
+        "Date: Tue, 18 Oct 2016 08:49:37 GMT\r\n"
+        "Content-Type: application/json\r\n"
+        "Content-Length: 26\r\n"
+        "Connection: keep-alive\r\n"
+        "Server: OneNET\r\n"
+        "\r\n"
+        "{\"errno\":0,\"error\":\"succ\"}",
+        { 1, 0, { 200 }, { 0 }, { 1 }, { 1476780577 }, { 1 } }
+    },
+    {
+        "chunked-errno",
+        "HTTP/1.1 200 OK\r\n"
+        "transfer-encoding:  Chunked\r\n"
+        "\r\n"
+        "a;ext=1\r\n"
+        "{\"errno\": \r\n"
+        "1a\r\n"
+        "-12,\"error\":\"auth failed\"}\r\n"
+        "0\r\n"
+        "X-Trailer: 1\r\n"
+        "\r\n",
+        { 1, 0, { 200 }, { -12 }, { 1 }, { 0 }, { 0 } }
+    },
+    {
+        "continue-then-no-content",
+        "HTTP/1.1 100 Continue\r\n"
+        "\r\n"
+        "HTTP/1.1 204 No Content\r\n"
+        "Content-Length: 0\r\n"
+        "\r\n",
+        { 1, 0, { 204 }, { 0 }, { 0 }, { 0 }, { 1 } }
+    },
+    {
+        "pipelined",
+        "HTTP/1.1 200 OK\r\nContent-Length: 11\r\n\r\n{\"errno\":0}"
+        "\r\n"
+        "HTTP/1.1 403 Forbidden\r\nContent-Length: 28\r\n\r\n{\"errno\":3,\"error\":\"forbid\"}"
+        "HTTP/1.1 200 OK\r\nContent-Length: 10\r\n\r\n{\"errno\":7",
+        { 3, 0, { 200, 403, 200 }, { 0, 3, 7 }, { 1, 1, 1 }, { 0, 0, 0 }, { 1, 0, 0 } }
+    },
+    {
+        "errno-overflow",
+        "HTTP/1.1 200 OK\r\nContent-Length: 38\r\n\r\n"
+        "{\"errno\":999999999999999999999999999,}",
+        { 1, 0, { 200 }, { INT32_MAX }, { 1 }, { 0 }, { 0 } }
+    },
+    {
+        "long-header-line",
+        "HTTP/1.1 200 OK\r\n"
+        "X-Padding: aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa\r\n"
+        "Content-Length: 2\r\n"
+        "\r\n"
+        "{}",
+        { 1, 0, { 200 }, { 0 }, { 0 }, { 0 }, { 1 } }
+    },
+    {
+        "bad-status",
+        "HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\n{}"
+        "garbage\r\n",
+        { 1, 1, { 200 }, { 0 }, { 0 }, { 0 }, { 1 } }
+    },
+};
+
+/* 喂一段数据, 解析完的响应记入r后重新开始 */
+static void feed(HTTP_Parser *p, Result *r, const char *data, uint32_t len)
+{
+    uint32_t n;
+
+    while (len > 0 && !r->error)
+    {
+        n = HTTP_ParserFeed(p, data, len);
+        data += n;
+        len -= n;
+        if (p->state == HTTP_PARSE_ERROR)
+        {
+            r->error = 1;
+        }
+        else if (p->state == HTTP_PARSE_DONE)
+        {
+            if (r->num < MAX_RESP)
+            {
+                r->status[r->num] = p->status;
+                r->err_no[r->num] = p->err_no;
+                r->has_errno[r->num] = p->has_errno;
+                r->date[r->num] = p->date;
+                r->success[r->num] = HTTP_ParserSuccess(p);
+            }
+            r->num++;
+            HTTP_ParserInit(p);
+        }
+    }
+}
+
+static int same(const Result *a, const Result *b)
+{
+    int i;
+
+    if (a->num != b->num || a->error != b->error)
+        return 0;
+    for (i = 0; i < a->num && i < MAX_RESP; i++)
+    {
+        if (a->status[i] != b->status[i] || a->err_no[i] != b->err_no[i] || a->has_errno[i] != b->has_errno[i]
+            || a->date[i] != b->date[i] || a->success[i] != b->success[i])
+            return 0;
+    }
+    return 1;
+}
+
+/*
+ *  @brief 按切分点喂入, 每段都复制到刚好大小的堆缓存里, 越界读由ASan发现
+ *  @param cuts: 切分点, 升序, 以len结束
+ */
+static void parse_split(const char *text, const uint32_t *cuts, int ncut, Result *r)
+{
+    HTTP_Parser p;
+    uint32_t from = 0;
+    char *piece;
+    int i;
+
+    memset(r, 0, sizeof(Result));
+    HTTP_ParserInit(&p);
+    for (i = 0; i < ncut; i++)
+    {
+        piece = (char *)malloc(cuts[i] - from);
+        memcpy(piece, text + from, cuts[i] - from);
+        feed(&p, r, piece, cuts[i] - from);
+        free(piece);
+        from = cuts[i];
+    }
+}
+
+static void test_case(const Case *c)
+{
+    uint32_t len = strlen(c->text);
+    uint32_t cuts[2], k;
+    uint32_t *bytes;
+    Result r;
+
+    cuts[0] = len;
+    parse_split(c->text, cuts, 1, &r);
+    if (!same(&r, &c->expect))
+    {
+        fprintf(stderr, "%s: whole\n", c->name);
+        failed++;
+        return;
+    }
+    for (k = 0; k <= len; k++)
+    {
+        cuts[0] = k;
+        cuts[1] = len;
+        parse_split(c->text, cuts, 2, &r);
+        if (!same(&r, &c->expect))
+        {
+            fprintf(stderr, "%s: split at %u\n", c->name, (unsigned)k);
+            failed++;
+        }
+    }
+    bytes = (uint32_t *)malloc(len * sizeof(uint32_t));
+    for (k = 0; k < len; k++)
+        bytes[k] = k + 1;
+    parse_split(c->text, bytes, len, &r);
+    free(bytes);
+    if (!same(&r, &c->expect))
+    {
+        fprintf(stderr, "%s: byte by byte\n", c->name);
+        failed++;
+    }
+}
+
+int main(void)
+{
+    unsigned i;
+
+    for (i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+        test_case(&cases[i]);
+    fprintf(stderr, "http_parser_test: %s\n", failed ? "FAILED" : "ok");
+    return failed != 0;
+}
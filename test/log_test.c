@@ -0,0 +1,187 @@
+/*
+ * log主机测试: Log_Write记下的参数经Log_Format输出, 必须与printf直接格式化的结果相同;
+ * 参数过多、输出缓冲区太小时截断而不越界; Log_Poll按行拼好交给DMA
+ * 直接包含log.c以便读取其中的记录缓冲区, DMA和USART1用stub/里的替身
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "log.c"
+
+static int failed = 0;
+
+#define CHECK(cond) do { if (!(cond)) { fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #cond); failed++; } } while (0)
+
+/* 取出缓冲区中的下一条记录并格式化, out为刚好size字节的堆缓存, 越界写由ASan发现 */
+static uint32_t next_line(char *line, uint32_t size)
+{
+    uint8_t rec[LOG_REC_MAX];
+    char *out;
+    uint32_t len;
+
+    line[0] = 0;
+    if(Ring_Peek(&log_ring, 0, rec, 1) != 1)
+    {
+        return 0;
+    }
+    Ring_Get(&log_ring, rec, rec[0]);
+    out = (char *)malloc(size);
+    len = Log_Format(rec, out, size);
+    CHECK(len == strlen(out));
+    strcpy(line, out);
+    free(out);
+    return len;
+}
+
+/* 同一组参数分别交给Log_Write和snprintf, 输出必须是prefix加上snprintf的结果(去掉结尾换行) */
+#define EXPECT(level, mod, prefix, ...) \
+    do { \
+        char want[LOG_LINE_MAX], got[LOG_LINE_MAX]; \
+        uint32_t n = snprintf(want, sizeof(want) - strlen(prefix), __VA_ARGS__); \
+        while(n > 0 && (want[n - 1] == '\n' || want[n - 1] == '\r')) want[--n] = 0; \
+        memmove(want + strlen(prefix), want, n + 1); \
+        memcpy(want, prefix, strlen(prefix)); \
+        Log_Write(level, mod, __VA_ARGS__); \
+        next_line(got, LOG_LINE_MAX); \
+        if(strcmp(got, want)) \
+        { \
+            fprintf(stderr, "%s:%d: got \"%s\", want \"%s\"\n", __FILE__, __LINE__, got, want); \
+            failed++; \
+        } \
+    } while(0)
+
+static void test_format(void)
+{
+    const char *null_str = NULL;
+
+    EXPECT(LOG_LEVEL_INFO, LOG_MOD_APP, "[I][APP] ", "plain text\r\n");
+    EXPECT(LOG_LEVEL_ERROR, LOG_MOD_NET, "[E][NET] ", "%d %i %u %x %X %o %c", -42, 7, 3000000000u, 0xbeef, 0xBEEF, 8, 'z');
+    EXPECT(LOG_LEVEL_WARN, LOG_MOD_MQTT, "[W][MQTT] ", "%ld %lu %lld %llx", -123456L, 654321UL, -1234567890123LL, 0x1234567890ULL);
+    EXPECT(LOG_LEVEL_DEBUG, LOG_MOD_EDP, "[D][EDP] ", "%f %.2f %e %g", 3.5, -2.125, 12345.678, 0.0001);
+    EXPECT(LOG_LEVEL_DEBUG, LOG_MOD_EDP, "[D][EDP] ", "%10.3f|%-8.1f|%G", 1.0 / 3, 2.25, 1e-10);
+    EXPECT(LOG_LEVEL_INFO, LOG_MOD_SENSOR, "[I][SENSOR] ", "%s|%5s|%-5s|%.2s|%s", __func__, "ab", "cd", "efgh", "");
+    EXPECT(LOG_LEVEL_INFO, LOG_MOD_MODBUS, "[I][MODBUS] ", "%*d|%-*d|%.*f", 6, 42, 4, 7, 3, 3.14159);
+    EXPECT(LOG_LEVEL_INFO, LOG_MOD_MODBUS, "[I][MODBUS] ", "%05d|%+d|% d|%#x", 42, 5, 5, 255);
+    EXPECT(LOG_LEVEL_INFO, LOG_MOD_APP, "[I][APP] ", "100%% done, %hd", 12);
+    EXPECT(LOG_LEVEL_INFO, LOG_MOD_APP | LOG_MOD_NET, "[I][APP] ", "first module wins");
+    EXPECT(LOG_LEVEL_INFO, 0, "[I][MODBUS] ", "no module: last name");
+    EXPECT(9, LOG_MOD_APP, "[-][APP] ", "bad level");
+
+    /* %s的空指针 */
+    Log_Write(LOG_LEVEL_INFO, LOG_MOD_APP, "[%s]", null_str);
+    {
+        char got[LOG_LINE_MAX];
+        next_line(got, sizeof(got));
+        CHECK(!strcmp(got, "[I][APP] [(null)]"));
+    }
+}
+
+/* 参数超过LOG_ARG_BYTES时只输出保存下来的部分 */
+static void test_too_many_args(void)
+{
+    char got[LOG_LINE_MAX];
+
+    Log_Write(LOG_LEVEL_INFO, LOG_MOD_APP, "%d %d %d %d %d %d %d %d %d %d", 1, 2, 3, 4, 5, 6, 7, 8, 9, 10);
+    next_line(got, sizeof(got));
+    CHECK(!strcmp(got, "[I][APP] 1 2 3 4 5 6 7 8 "));
+
+    Log_Write(LOG_LEVEL_INFO, LOG_MOD_APP, "%f %f %f %f %f", 1.0, 2.0, 3.0, 4.0, 5.0);
+    next_line(got, sizeof(got));
+    CHECK(!strcmp(got, "[I][APP] 1.000000 2.000000 3.000000 4.000000 "));
+}
+
+/* 输出缓冲区太小: 截断并以0结尾, 每种大小都不越界 */
+static void test_small_output(void)
+{
+    static const char full[] = "[W][NET] value=12345 name=abcdefgh pi=3.14";
+    char got[LOG_LINE_MAX];
+    uint32_t size;
+
+    for(size = 1; size <= sizeof(full) + 4; size++)
+    {
+        Log_Write(LOG_LEVEL_WARN, LOG_MOD_NET, "value=%d name=%s pi=%.2f", 12345, "abcdefgh", 3.14159);
+        next_line(got, size);
+        CHECK(strlen(got) == (size <= sizeof(full) ? size - 1 : sizeof(full) - 1));
+        CHECK(!strncmp(got, full, strlen(got)));
+    }
+}
+
+static void test_hex(void)
+{
+    uint8_t data[LOG_HEX_MAX + 8];
+    char got[LOG_LINE_MAX], want[LOG_LINE_MAX];
+    uint32_t i, o;
+
+    Log_Hex(LOG_LEVEL_DEBUG, LOG_MOD_NET, "rx", (const uint8_t *)"\x01\xab\xff", 3);
+    next_line(got, sizeof(got));
+    CHECK(!strcmp(got, "[D][NET] rx 3: 01 ab ff"));
+
+    Log_Hex(LOG_LEVEL_DEBUG, LOG_MOD_NET, "empty", data, 0);
+    next_line(got, sizeof(got));
+    CHECK(!strcmp(got, "[D][NET] empty 0:"));
+
+    /* 超过LOG_HEX_MAX的部分截掉 */
+    for(i = 0; i < sizeof(data); i++)
+    {
+        data[i] = (uint8_t)i;
+    }
+    Log_Hex(LOG_LEVEL_DEBUG, LOG_MOD_NET, "long", data, sizeof(data));
+    next_line(got, sizeof(got));
+    o = sprintf(want, "[D][NET] long %u:", (unsigned)LOG_HEX_MAX);
+    for(i = 0; i < LOG_HEX_MAX && o + 4 < sizeof(want); i++)
+    {
+        o += sprintf(want + o, " %02x", (unsigned)i);
+    }
+    CHECK(!strcmp(got, want));
+}
+
+/* Log_Poll: 每条一行, 丢弃计数先报告; 低于LOG_LEVEL的宏在编译期去掉, 参数不求值 */
+static int side_effects = 0;
+
+static int touch(void)
+{
+    return ++side_effects;
+}
+
+static void test_poll(void)
+{
+    uint32_t started = host_dma_started, n = 0;
+
+    Log_Write(LOG_LEVEL_INFO, LOG_MOD_APP, "one %d", 1);
+    Log_Write(LOG_LEVEL_WARN, LOG_MOD_EDP, "two\n");
+    LOG_D(LOG_MOD_APP, "compiled out %d", touch());
+    Log_Poll();
+    CHECK(host_dma_started == started + 1);
+    CHECK(host_dma_len == strlen("[I][APP] one 1\r\n[W][EDP] two\r\n"));
+    CHECK(!memcmp(log_tx_buf, "[I][APP] one 1\r\n[W][EDP] two\r\n", host_dma_len));
+    CHECK(side_effects == 0);
+
+    /* 缓冲区写满后丢弃, 下一批先报告丢了多少条 */
+    while(log_dropped == 0)
+    {
+        Log_Write(LOG_LEVEL_INFO, LOG_MOD_APP, "fill %d", (int)n++);
+    }
+    Log_Write(LOG_LEVEL_INFO, LOG_MOD_APP, "fill %d", (int)n++);
+    Log_Poll();
+    CHECK(!strncmp(log_tx_buf, "[W][LOG] 2 dropped\r\n[I][APP] fill 0\r\n", 37));
+    CHECK(host_dma_len <= LOG_TX_LEN);
+    while(Ring_Count(&log_ring) > 0)
+    {
+        Log_Poll();
+        CHECK(host_dma_len <= LOG_TX_LEN);
+    }
+    Log_Poll();
+    CHECK(host_dma_len <= LOG_TX_LEN);
+}
+
+int main(void)
+{
+    Log_Init();
+    test_format();
+    test_too_many_args();
+    test_small_output();
+    test_hex();
+    test_poll();
+    fprintf(stderr, "log_test: %s\n", failed ? "FAILED" : "ok");
+    return failed != 0;
+}
@@ -0,0 +1,144 @@
+/*
+ * Ring主机压力测试: 一个线程当生产者(串口中断), 一个线程当消费者(主循环),
+ * 两边随机混用各个接口, 消费者按顺序核对收到的每一个字节
+ * 所有demo的Utils/ring.c是同一份, 这里编译EDP_Sensors中的那份
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sched.h>
+#include "ring.h"
+
+static int failed = 0;
+
+#define CHECK(cond) do { if (!(cond)) { fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #cond); failed++; } } while (0)
+
+#define TOTAL       (8u * 1024 * 1024)  /* 传递的总字节数 */
+#define RING_SIZE   64                  /* 小缓冲区, 经常满和绕回 */
+
+static Ring ring;
+static uint8_t ring_buf[RING_SIZE];
+static uint32_t dropped;                /* 生产者统计的被丢弃字节数, 应与overflow相同 */
+
+/* 第i个字节的内容, 周期不是2的幂, 错位、重复、丢字节都能发现 */
+static uint8_t pattern(uint32_t i)
+{
+    return (uint8_t)(i ^ (i >> 8) ^ (i % 251));
+}
+
+/* 线程各用各的随机数, rand()不可重入 */
+static uint32_t next_rand(uint32_t *s)
+{
+    *s ^= *s << 13;
+    *s ^= *s >> 17;
+    *s ^= *s << 5;
+    return *s;
+}
+
+static void *producer(void *arg)
+{
+    uint8_t chunk[RING_SIZE * 2];
+    uint32_t seed = 1, sent = 0, len, done, i;
+    uint8_t *p;
+
+    (void)arg;
+    while (sent < TOTAL)
+    {
+        len = next_rand(&seed) % sizeof(chunk) + 1;
+        if (len > TOTAL - sent)
+            len = TOTAL - sent;
+        switch (next_rand(&seed) % 3)
+        {
+        case 0:         /* 整块写入, 满了丢掉剩下的, 下次从丢掉的位置重发 */
+            for (i = 0; i < len; i++)
+                chunk[i] = pattern(sent + i);
+            done = Ring_Put(&ring, chunk, len);
+            dropped += len - done;
+            break;
+        case 1:         /* 逐字节, 同接收中断 */
+            done = Ring_PutByte(&ring, pattern(sent));
+            dropped += 1 - done;
+            break;
+        default:        /* 直接写入连续空间再提交, 同DMA */
+            done = Ring_WriteSpan(&ring, &p);
+            if (done > len)
+                done = len;
+            for (i = 0; i < done; i++)
+                p[i] = pattern(sent + i);
+            Ring_Commit(&ring, done);
+            break;
+        }
+        sent += done;
+        /* 满了或随机让出CPU: 单核主机上消费者才能运行, 两边也不会总在同一位置交替 */
+        if (done == 0 || next_rand(&seed) % 4 == 0)
+            sched_yield();
+    }
+    return NULL;
+}
+
+static void *consumer(void *arg)
+{
+    uint8_t chunk[RING_SIZE * 2];
+    uint32_t seed = 2, got = 0, len, n, i, off;
+    const uint8_t *p;
+    uint32_t *bad = (uint32_t *)arg;
+
+    while (got < TOTAL)
+    {
+        len = next_rand(&seed) % sizeof(chunk) + 1;
+        switch (next_rand(&seed) % 3)
+        {
+        case 0:
+            n = Ring_Get(&ring, chunk, len);
+            for (i = 0; i < n; i++)
+                *bad += chunk[i] != pattern(got + i);
+            break;
+        case 1:         /* 先跳过offset字节偷看, 再按连续区取走 */
+            off = next_rand(&seed) % 8;
+            n = Ring_Peek(&ring, off, chunk, len);
+            for (i = 0; i < n; i++)
+                *bad += chunk[i] != pattern(got + off + i);
+            n = Ring_ReadSpan(&ring, &p);
+            if (n > len)
+                n = len;
+            for (i = 0; i < n; i++)
+                *bad += p[i] != pattern(got + i);
+            Ring_Consume(&ring, n);
+            break;
+        default:
+            n = Ring_Count(&ring);
+            if (n > len)
+                n = len;
+            n = Ring_Get(&ring, chunk, n);
+            for (i = 0; i < n; i++)
+                *bad += chunk[i] != pattern(got + i);
+            break;
+        }
+        got += n;
+        if (n == 0 || next_rand(&seed) % 4 == 0)
+            sched_yield();
+    }
+    return NULL;
+}
+
+int main(void)
+{
+    pthread_t prod, cons;
+    uint32_t bad = 0;
+
+    Ring_Init(&ring, ring_buf, RING_SIZE);
+    pthread_create(&cons, NULL, consumer, &bad);
+    pthread_create(&prod, NULL, producer, NULL);
+    pthread_join(prod, NULL);
+    pthread_join(cons, NULL);
+
+    CHECK(bad == 0);
+    CHECK(Ring_Count(&ring) == 0);
+    CHECK(ring.head == TOTAL && ring.tail == TOTAL);
+    CHECK(ring.overflow == dropped);
+    CHECK(dropped > 0);         /* 确实跑到了满的情况 */
+    fprintf(stderr, "ring_test: %s\n", failed ? "FAILED" : "ok");
+    return failed != 0;
+}
@@ -0,0 +1,13 @@
+/*
+ * sched.c的主机模拟时钟, 编译sched.c时用-include引入, 并定义
+ * SCHED_NOW()=sim_now, SCHED_IDLE(ms)=sim_idle(ms)
+ */
+#ifndef __SCHED_SIM_H__
+#define __SCHED_SIM_H__
+
+#include <stdint.h>
+
+extern uint32_t sim_now;
+void sim_idle(uint32_t ms);
+
+#endif
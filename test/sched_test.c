@@ -0,0 +1,150 @@
+/*
+ * 调度器主机测试: sched.c用模拟时钟编译, 时钟从32位回绕前开始
+ * 只有EDP_Sensors用到调度器
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "sched_sim.h"
+#include "sched.h"
+
+static int failed = 0;
+
+#define CHECK(cond) do { if (!(cond)) { fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #cond); failed++; } } while (0)
+
+uint32_t sim_now = 0xFFFFF000u;
+static int idle_bad = 0;
+
+/* 空闲时直接把时钟拨到下一个任务到点 */
+void sim_idle(uint32_t ms)
+{
+    if (ms == 0 || ms == SCHED_STOP)
+        idle_bad++;
+    sim_now += ms;
+}
+
+/* 运行调度器直到模拟时钟走过ms毫秒 */
+static void run_for(uint32_t ms)
+{
+    uint32_t start = sim_now, next;
+
+    while (sim_now - start < ms)
+    {
+        next = Sched_RunOnce();
+        if (next == SCHED_STOP)
+            break;
+        if (next > 0)
+            sim_idle(next);
+    }
+}
+
+/* 记录每次运行的时刻, 运行本身耗时cost毫秒, 返回period */
+typedef struct
+{
+    uint32_t cost;
+    uint32_t period;
+    int limit;          /* 运行这么多次后返回SCHED_STOP, 0不限 */
+    int n;
+    uint32_t at[64];
+} Probe;
+
+static uint32_t probe_func(void *arg)
+{
+    Probe *p = (Probe *)arg;
+
+    if (p->n < 64)
+        p->at[p->n] = sim_now;
+    p->n++;
+    sim_now += p->cost;
+    return (p->limit && p->n == p->limit) ? SCHED_STOP : p->period;
+}
+
+/* 任务自身耗时和被别的任务推迟都不会让周期漂移 */
+static void test_no_drift(void)
+{
+    static SchedTask ta, tb;
+    Probe a = { 3, 100, 0 }, b = { 30, 70, 0 };
+    uint32_t base = sim_now;
+    int i;
+
+    Sched_Start(&ta, probe_func, &a, 0);
+    Sched_Start(&tb, probe_func, &b, 0);
+    run_for(3000);
+    Sched_Stop(&ta);
+    Sched_Stop(&tb);
+
+    CHECK(a.n == 30);
+    for (i = 0; i < a.n && i < 64; i++)
+    {
+        /* 可能被b推迟, 但不超过b的一次运行时间, 并且不累积 */
+        CHECK(a.at[i] - (base + i * 100) <= 30);
+    }
+    CHECK(a.at[0] == base);
+    CHECK(b.n == 43);
+}
+
+/* 运行时间超过周期: 马上再运行, 但不补跑错过的次数 */
+static void test_overrun(void)
+{
+    static SchedTask tc;
+    Probe c = { 250, 100, 6 };
+    int i;
+
+    Sched_Start(&tc, probe_func, &c, 0);
+    run_for(5000);
+    CHECK(c.n == 6);
+    for (i = 1; i < c.n; i++)
+        CHECK(c.at[i] - c.at[i - 1] == 250);
+}
+
+static SchedTask td, te;
+static Probe d = { 0, 1000, 0 };
+
+static uint32_t stop_other(void *arg)
+{
+    (void)arg;
+    Sched_Stop(&td);
+    return SCHED_STOP;
+}
+
+/* 停止、唤醒和重新启动 */
+static void test_control(void)
+{
+    Probe f = { 0, 500, 0 };
+    uint32_t t0;
+
+    Sched_Start(&td, probe_func, &d, 100000);
+    CHECK(Sched_RunOnce() == 100000);
+    CHECK(d.n == 0);
+
+    /* 提前唤醒, 之后的周期从唤醒运行时算起 */
+    sim_now += 10;
+    t0 = sim_now;
+    Sched_Wake(&td);
+    CHECK(Sched_RunOnce() == 1000);
+    CHECK(d.n == 1 && d.at[0] == t0);
+
+    /* 一个任务停止另一个 */
+    Sched_Start(&te, stop_other, NULL, 0);
+    Sched_RunOnce();
+    CHECK(Sched_RunOnce() == SCHED_STOP);
+
+    /* 停止后重新启动, 控制块不会重复挂进链表 */
+    Sched_Start(&td, probe_func, &f, 0);
+    Sched_Start(&td, probe_func, &f, 0);
+    CHECK(Sched_RunOnce() == 500);
+    CHECK(f.n == 1);
+    Sched_Stop(&td);
+    CHECK(Sched_RunOnce() == SCHED_STOP);
+}
+
+int main(void)
+{
+    test_no_drift();
+    test_overrun();
+    test_control();
+    CHECK(idle_bad == 0);
+    fprintf(stderr, "sched_test: %s\n", failed ? "FAILED" : "ok");
+    return failed != 0;
+}
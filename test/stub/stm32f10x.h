@@ -0,0 +1,54 @@
+/*
+ * 主机测试用的stm32f10x.h替身: 只提供被测模块用到的寄存器和内核函数,
+ * SysTick未启动, 中断相关操作为空
+ */
+#ifndef __STM32F10x_H
+#define __STM32F10x_H
+
+#include <stdint.h>
+
+typedef struct
+{
+    volatile uint32_t CTRL;
+} SysTick_Type;
+
+typedef struct
+{
+    volatile uint32_t ICSR;
+} SCB_Type;
+
+static SysTick_Type host_systick __attribute__((unused));
+static SCB_Type host_scb __attribute__((unused));
+
+#define SysTick                     (&host_systick)
+#define SCB                         (&host_scb)
+#define SysTick_CTRL_ENABLE_Msk     1UL
+#define SCB_ICSR_VECTACTIVE_Msk     0x1FFUL
+
+#define SystemCoreClock             72000000UL
+#define __get_PRIMASK()             0
+#define __set_PRIMASK(x)            ((void)(x))
+#define __disable_irq()             ((void)0)
+#define __enable_irq()              ((void)0)
+#define __WFI()                     ((void)0)
+#define __nop()                     ((void)0)
+
+static inline uint32_t SysTick_Config(uint32_t ticks)
+{
+    (void)ticks;
+    return 0;
+}
+
+/* 时钟开关在主机上没有意义 */
+#define RCC_AHBPeriph_DMA1          0x01UL
+#define ENABLE                      1
+#define DISABLE                     0
+#define SET                         1
+#define RESET                       0
+static inline void RCC_AHBPeriphClockCmd(uint32_t periph, int state)
+{
+    (void)periph;
+    (void)state;
+}
+
+#endif
@@ -0,0 +1,34 @@
+/*
+ * 主机测试用的stm32f10x_usart.h替身: 发送寄存器总是空的
+ */
+#ifndef __STM32F10x_USART_H
+#define __STM32F10x_USART_H
+
+#include "stm32f10x.h"
+
+typedef struct
+{
+    volatile uint16_t DR;
+} USART_TypeDef;
+
+static USART_TypeDef host_usart1 __attribute__((unused));
+
+#define USART1                  (&host_usart1)
+#define USART_DMAReq_Tx         0x80
+#define USART_FLAG_TXE          0x80
+
+static inline void USART_DMACmd(USART_TypeDef *usart, uint16_t req, int state)
+{
+    (void)usart;
+    (void)req;
+    (void)state;
+}
+
+static inline int USART_GetFlagStatus(USART_TypeDef *usart, uint16_t flag)
+{
+    (void)usart;
+    (void)flag;
+    return SET;
+}
+
+#endif